@@ -15,6 +15,7 @@
 #include "commit.h"
 #include "tag.h"
 #include "alloc.h"
+#include "mem-pool.h"
 
 #define BLOCKING 1024
 
@@ -51,10 +52,17 @@ void clear_alloc_state(struct alloc_state *s)
 	FREE_AND_NULL(s->slabs);
 }
 
-static inline void *alloc_node(struct alloc_state *s, size_t node_size)
+static inline void *alloc_node(struct repository *r, struct alloc_state *s,
+			       size_t node_size)
 {
 	void *ret;
 
+	if (r->parsed_objects->scope_pool) {
+		s->count++;
+		return mem_pool_calloc(r->parsed_objects->scope_pool,
+				       1, node_size);
+	}
+
 	if (!s->nr) {
 		s->nr = BLOCKING;
 		s->p = xmalloc(BLOCKING * node_size);
@@ -73,28 +81,28 @@ static inline void *alloc_node(struct alloc_state *s, size_t node_size)
 
 void *alloc_blob_node(struct repository *r)
 {
-	struct blob *b = alloc_node(r->parsed_objects->blob_state, sizeof(struct blob));
+	struct blob *b = alloc_node(r, r->parsed_objects->blob_state, sizeof(struct blob));
 	b->object.type = OBJ_BLOB;
 	return b;
 }
 
 void *alloc_tree_node(struct repository *r)
 {
-	struct tree *t = alloc_node(r->parsed_objects->tree_state, sizeof(struct tree));
+	struct tree *t = alloc_node(r, r->parsed_objects->tree_state, sizeof(struct tree));
 	t->object.type = OBJ_TREE;
 	return t;
 }
 
 void *alloc_tag_node(struct repository *r)
 {
-	struct tag *t = alloc_node(r->parsed_objects->tag_state, sizeof(struct tag));
+	struct tag *t = alloc_node(r, r->parsed_objects->tag_state, sizeof(struct tag));
 	t->object.type = OBJ_TAG;
 	return t;
 }
 
 void *alloc_object_node(struct repository *r)
 {
-	struct object *obj = alloc_node(r->parsed_objects->object_state, sizeof(union any_object));
+	struct object *obj = alloc_node(r, r->parsed_objects->object_state, sizeof(union any_object));
 	obj->type = OBJ_NONE;
 	return obj;
 }
@@ -106,7 +114,7 @@ unsigned int alloc_commit_index(struct repository *r)
 
 void *alloc_commit_node(struct repository *r)
 {
-	struct commit *c = alloc_node(r->parsed_objects->commit_state, sizeof(struct commit));
+	struct commit *c = alloc_node(r, r->parsed_objects->commit_state, sizeof(struct commit));
 	c->object.type = OBJ_COMMIT;
 	c->index = alloc_commit_index(r);
 	c->graph_pos = COMMIT_NOT_FROM_GRAPH;
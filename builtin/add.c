@@ -17,6 +17,7 @@
 #include "diffcore.h"
 #include "revision.h"
 #include "bulk-checkin.h"
+#include "parallel-checkin.h"
 #include "argv-array.h"
 #include "submodule.h"
 
@@ -69,11 +70,68 @@ static int fix_unmerged_status(struct diff_filepair *p,
 		return DIFF_STATUS_MODIFIED;
 }
 
+/*
+ * Hash the files among "paths" (NULL ones are skipped) in parallel
+ * before they are added one by one with add_one_file().  Returns an
+ * array parallel to "paths", or NULL if nothing was hashed.
+ */
+static struct checkin_entry *prepare_checkin(const char **paths, int nr,
+					     int flags)
+{
+	struct checkin_entry *entries;
+	int i, hashed = 0;
+
+	if (nr < 2 || (flags & (ADD_CACHE_PRETEND | ADD_CACHE_INTENT |
+				HASH_RENORMALIZE)))
+		return NULL;
+
+	entries = xcalloc(nr, sizeof(*entries));
+	for (i = 0; i < nr; i++) {
+		struct checkin_entry *e = &entries[i];
+
+		if (!paths[i] || lstat(paths[i], &e->st))
+			continue; /* st_mode is 0, so it is left alone */
+		e->path = e->attr_path = paths[i];
+	}
+	parallel_checkin(&the_index, entries, nr, HASH_WRITE_OBJECT);
+	for (i = 0; i < nr; i++)
+		hashed += entries[i].hashed;
+	if (!hashed)
+		FREE_AND_NULL(entries);
+	return entries;
+}
+
+static int add_one_file(const char *path, struct checkin_entry *e, int flags)
+{
+	if (e && e->hashed)
+		return add_hashed_to_index(&the_index, path, &e->st, &e->oid,
+					   flags);
+	return add_file_to_index(&the_index, path, flags);
+}
+
 static void update_callback(struct diff_queue_struct *q,
 			    struct diff_options *opt, void *cbdata)
 {
 	int i;
 	struct update_callback_data *data = cbdata;
+	struct checkin_entry *entries;
+	const char **paths;
+
+	ALLOC_ARRAY(paths, q->nr);
+	for (i = 0; i < q->nr; i++) {
+		struct diff_filepair *p = q->queue[i];
+
+		switch (fix_unmerged_status(p, data)) {
+		case DIFF_STATUS_MODIFIED:
+		case DIFF_STATUS_TYPE_CHANGED:
+			paths[i] = p->one->path;
+			break;
+		default:
+			paths[i] = NULL;
+		}
+	}
+	entries = prepare_checkin(paths, q->nr, data->flags);
+	free(paths);
 
 	for (i = 0; i < q->nr; i++) {
 		struct diff_filepair *p = q->queue[i];
@@ -83,7 +141,8 @@ static void update_callback(struct diff_queue_struct *q,
 			die(_("unexpected diff status %c"), p->status);
 		case DIFF_STATUS_MODIFIED:
 		case DIFF_STATUS_TYPE_CHANGED:
-			if (add_file_to_index(&the_index, path,	data->flags)) {
+			if (add_one_file(path, entries ? &entries[i] : NULL,
+					 data->flags)) {
 				if (!(data->flags & ADD_CACHE_IGNORE_ERRORS))
 					die(_("updating files failed"));
 				data->add_errors++;
@@ -99,6 +158,7 @@ static void update_callback(struct diff_queue_struct *q,
 			break;
 		}
 	}
+	free(entries);
 }
 
 int add_files_to_cache(const char *prefix,
@@ -363,6 +423,8 @@ static void check_embedded_repo(const char *path)
 static int add_files(struct dir_struct *dir, int flags)
 {
 	int i, exit_status = 0;
+	struct checkin_entry *entries;
+	const char **paths;
 
 	if (dir->ignored_nr) {
 		fprintf(stderr, _(ignore_error));
@@ -372,14 +434,22 @@ static int add_files(struct dir_struct *dir, int flags)
 		exit_status = 1;
 	}
 
+	ALLOC_ARRAY(paths, dir->nr);
+	for (i = 0; i < dir->nr; i++)
+		paths[i] = dir->entries[i]->name;
+	entries = prepare_checkin(paths, dir->nr, flags);
+	free(paths);
+
 	for (i = 0; i < dir->nr; i++) {
 		check_embedded_repo(dir->entries[i]->name);
-		if (add_file_to_index(&the_index, dir->entries[i]->name, flags)) {
+		if (add_one_file(dir->entries[i]->name,
+				 entries ? &entries[i] : NULL, flags)) {
 			if (!ignore_add_errors)
 				die(_("adding files failed"));
 			exit_status = 1;
 		}
 	}
+	free(entries);
 	return exit_status;
 }
 
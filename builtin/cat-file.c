@@ -420,16 +420,31 @@ static void batch_one_object(const char *obj_name,
 	batch_object_write(obj_name, scratch, opt, data);
 }
 
+/* how many objects to ask the object store to read ahead at once */
+#define BATCH_PREFETCH 256
+
 struct object_cb_data {
 	struct batch_options *opt;
 	struct expand_data *expand;
 	struct oidset *seen;
 	struct strbuf *scratch;
+	/* objects we will be called for, in order, and how far we read ahead */
+	struct oid_array *prefetch;
+	size_t prefetched, nr;
 };
 
 static int batch_object_cb(const struct object_id *oid, void *vdata)
 {
 	struct object_cb_data *data = vdata;
+
+	if (data->prefetch && data->nr++ >= data->prefetched) {
+		size_t n = data->prefetch->nr - data->prefetched;
+		if (n > BATCH_PREFETCH)
+			n = BATCH_PREFETCH;
+		prefetch_packed_objects(the_repository,
+					data->prefetch->oid + data->prefetched, n);
+		data->prefetched += n;
+	}
 	oidcpy(&data->expand->oid, oid);
 	batch_object_write(NULL, data->scratch, data->opt, data->expand);
 	return 0;
@@ -477,6 +492,26 @@ static int batch_unordered_packed(const struct object_id *oid,
 	return batch_unordered_object(oid, data);
 }
 
+static void batch_one_line(struct strbuf *input, struct strbuf *output,
+			   struct batch_options *opt, struct expand_data *data)
+{
+	if (data->split_on_whitespace) {
+		/*
+		 * Split at first whitespace, tying off the beginning
+		 * of the string and saving the remainder (or NULL) in
+		 * data->rest.
+		 */
+		char *p = strpbrk(input->buf, " \t");
+		if (p) {
+			while (*p && strchr(" \t", *p))
+				*p++ = '\0';
+		}
+		data->rest = p;
+	}
+
+	batch_one_object(input->buf, output, opt, data);
+}
+
 static int batch_objects(struct batch_options *opt)
 {
 	struct strbuf input = STRBUF_INIT;
@@ -523,6 +558,8 @@ static int batch_objects(struct batch_options *opt)
 		cb.opt = opt;
 		cb.expand = &data;
 		cb.scratch = &output;
+		cb.prefetch = NULL;
+		cb.prefetched = cb.nr = 0;
 
 		if (opt->unordered) {
 			struct oidset seen = OIDSET_INIT;
@@ -540,6 +577,12 @@ static int batch_objects(struct batch_options *opt)
 			for_each_loose_object(collect_loose_object, &sa, 0);
 			for_each_packed_object(collect_packed_object, &sa, 0);
 
+			/*
+			 * Sorted by name the objects are all over the packs;
+			 * read their contents ahead of ourselves in pack order.
+			 */
+			if (opt->print_contents)
+				cb.prefetch = &sa;
 			oid_array_for_each_unique(&sa, batch_object_cb, &cb);
 
 			oid_array_clear(&sa);
@@ -559,22 +602,45 @@ static int batch_objects(struct batch_options *opt)
 	save_warning = warn_on_object_refname_ambiguity;
 	warn_on_object_refname_ambiguity = 0;
 
-	while (strbuf_getline(&input, stdin) != EOF) {
-		if (data.split_on_whitespace) {
-			/*
-			 * Split at first whitespace, tying off the beginning
-			 * of the string and saving the remainder (or NULL) in
-			 * data.rest.
-			 */
-			char *p = strpbrk(input.buf, " \t");
-			if (p) {
-				while (*p && strchr(" \t", *p))
-					*p++ = '\0';
+	/*
+	 * When the output is buffered nobody is waiting for an answer
+	 * before sending the next request, so we can read a few lines
+	 * ahead and have the objects whose contents we print prefetched.
+	 */
+	if (opt->buffer_output && opt->print_contents) {
+		struct string_list lines = STRING_LIST_INIT_DUP;
+		struct oid_array oids = OID_ARRAY_INIT;
+		int eof = 0;
+
+		while (!eof) {
+			struct string_list_item *item;
+
+			while (lines.nr < BATCH_PREFETCH) {
+				struct object_id oid;
+				const char *end;
+
+				if (strbuf_getline(&input, stdin) == EOF) {
+					eof = 1;
+					break;
+				}
+				string_list_append(&lines, input.buf);
+				if (!parse_oid_hex(input.buf, &oid, &end) &&
+				    (!*end || isspace(*end)))
+					oid_array_append(&oids, &oid);
 			}
-			data.rest = p;
-		}
+			prefetch_packed_objects(the_repository, oids.oid, oids.nr);
 
-		batch_one_object(input.buf, &output, opt, &data);
+			for_each_string_list_item(item, &lines) {
+				strbuf_reset(&input);
+				strbuf_addstr(&input, item->string);
+				batch_one_line(&input, &output, opt, &data);
+			}
+			string_list_clear(&lines, 0);
+			oid_array_clear(&oids);
+		}
+	} else {
+		while (strbuf_getline(&input, stdin) != EOF)
+			batch_one_line(&input, &output, opt, &data);
 	}
 
 	strbuf_release(&input);
@@ -12,6 +12,7 @@
 #include "builtin.h"
 #include "utf8.h"
 #include "gpg-interface.h"
+#include "bulk-checkin.h"
 
 static const char commit_tree_usage[] = "git commit-tree [(-p <sha1>)...] [-S[<keyid>]] [-m <message>] [-F <file>] <sha1>";
 
@@ -120,11 +121,14 @@ int cmd_commit_tree(int argc, const char **argv, const char *prefix)
 			die_errno("git commit-tree: failed to read");
 	}
 
+	plug_bulk_checkin();
 	if (commit_tree(buffer.buf, buffer.len, &tree_oid, parents, &commit_oid,
 			NULL, sign_commit)) {
+		unplug_bulk_checkin();
 		strbuf_release(&buffer);
 		return 1;
 	}
+	unplug_bulk_checkin();
 
 	printf("%s\n", oid_to_hex(&commit_oid));
 	strbuf_release(&buffer);
@@ -280,8 +280,8 @@ static uint64_t estimate_repack_memory(struct packed_git *pack)
 	 * usually insignificant)
 	 */
 	heap += sizeof(struct tree) * nr_objects / 2;
-	/* and then obj_hash[], underestimated in fact */
-	heap += sizeof(struct object *) * nr_objects;
+	/* and then the object hash table and its tags, underestimated in fact */
+	heap += (sizeof(struct object *) + 1) * nr_objects;
 	/* revindex is used also */
 	heap += sizeof(struct revindex_entry) * nr_objects;
 	/*
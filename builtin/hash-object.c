@@ -11,6 +11,7 @@
 #include "quote.h"
 #include "parse-options.h"
 #include "exec-cmd.h"
+#include "parallel-checkin.h"
 
 /*
  * This is to create corrupt objects for debugging and as such it
@@ -58,23 +59,95 @@ static void hash_object(const char *path, const char *type, const char *vpath,
 	hash_fd(fd, type, vpath, flags, literally);
 }
 
+static void hash_paths(const char **paths, int nr, const char *type,
+		       int no_filters, unsigned flags, int literally)
+{
+	struct checkin_entry *entries = NULL;
+	int i;
+
+	if (!literally && nr > 1 && type_from_string(type) == OBJ_BLOB) {
+		entries = xcalloc(nr, sizeof(*entries));
+		for (i = 0; i < nr; i++) {
+			struct checkin_entry *e = &entries[i];
+
+			if (stat(paths[i], &e->st))
+				continue; /* left for hash_object() to report */
+			e->path = paths[i];
+			e->attr_path = no_filters ? NULL : paths[i];
+		}
+		parallel_checkin(&the_index, entries, nr, flags);
+	}
+
+	for (i = 0; i < nr; i++) {
+		if (entries && entries[i].hashed) {
+			printf("%s\n", oid_to_hex(&entries[i].oid));
+			maybe_flush_or_die(stdout, "hash to stdout");
+		} else {
+			hash_object(paths[i], type,
+				    no_filters ? NULL : paths[i], flags,
+				    literally);
+		}
+	}
+	free(entries);
+}
+
+/*
+ * Paths are hashed in batches of whatever complete lines a single
+ * read() returns, so that a caller writing one path at a time and
+ * waiting for its object name (like git-svn does) is answered right
+ * away, while a long list piped in is hashed in parallel.
+ */
 static void hash_stdin_paths(const char *type, int no_filters, unsigned flags,
 			     int literally)
 {
-	struct strbuf buf = STRBUF_INIT;
+	struct strbuf in = STRBUF_INIT;
+	struct string_list paths = STRING_LIST_INIT_DUP;
 	struct strbuf unquoted = STRBUF_INIT;
+	int eof = 0;
+
+	while (!eof) {
+		const char **batch;
+		char *line, *end;
+		ssize_t got;
+		int i;
+
+		strbuf_grow(&in, 65536);
+		got = xread(0, in.buf + in.len, 65536);
+		if (got < 0)
+			die_errno("unable to read paths from stdin");
+		if (!got) {
+			eof = 1;
+			if (in.len && in.buf[in.len - 1] != '\n')
+				strbuf_addch(&in, '\n');
+		} else {
+			strbuf_setlen(&in, in.len + got);
+		}
 
-	while (strbuf_getline(&buf, stdin) != EOF) {
-		if (buf.buf[0] == '"') {
-			strbuf_reset(&unquoted);
-			if (unquote_c_style(&unquoted, buf.buf, NULL))
-				die("line is badly quoted");
-			strbuf_swap(&buf, &unquoted);
+		line = in.buf;
+		while ((end = memchr(line, '\n', in.buf + in.len - line))) {
+			*end = '\0';
+			if (end > line && end[-1] == '\r')
+				end[-1] = '\0';
+			if (*line == '"') {
+				strbuf_reset(&unquoted);
+				if (unquote_c_style(&unquoted, line, NULL))
+					die("line is badly quoted");
+				string_list_append(&paths, unquoted.buf);
+			} else {
+				string_list_append(&paths, line);
+			}
+			line = end + 1;
 		}
-		hash_object(buf.buf, type, no_filters ? NULL : buf.buf, flags,
-			    literally);
+		strbuf_remove(&in, 0, line - in.buf);
+
+		ALLOC_ARRAY(batch, paths.nr);
+		for (i = 0; i < paths.nr; i++)
+			batch[i] = paths.items[i].string;
+		hash_paths(batch, paths.nr, type, no_filters, flags, literally);
+		free(batch);
+		string_list_clear(&paths, 0);
 	}
-	strbuf_release(&buf);
+	strbuf_release(&in);
 	strbuf_release(&unquoted);
 }
 
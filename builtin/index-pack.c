@@ -100,9 +100,10 @@ static struct thread_local *thread_data;
 static int nr_dispatched;
 static int threads_active;
 
-static pthread_mutex_t read_mutex;
-#define read_lock()		lock_mutex(&read_mutex)
-#define read_unlock()		unlock_mutex(&read_mutex)
+/* Protect the parsed objects while checking them */
+static pthread_mutex_t parse_mutex;
+#define parse_lock()		lock_mutex(&parse_mutex)
+#define parse_unlock()		unlock_mutex(&parse_mutex)
 
 static pthread_mutex_t counter_mutex;
 #define counter_lock()		lock_mutex(&counter_mutex)
@@ -140,7 +141,8 @@ static inline void unlock_mutex(pthread_mutex_t *mutex)
 static void init_thread(void)
 {
 	int i;
-	init_recursive_mutex(&read_mutex);
+	init_recursive_mutex(&parse_mutex);
+	enable_obj_read_lock();
 	pthread_mutex_init(&counter_mutex, NULL);
 	pthread_mutex_init(&work_mutex, NULL);
 	pthread_mutex_init(&type_cas_mutex, NULL);
@@ -163,7 +165,8 @@ static void cleanup_thread(void)
 	if (!threads_active)
 		return;
 	threads_active = 0;
-	pthread_mutex_destroy(&read_mutex);
+	pthread_mutex_destroy(&parse_mutex);
+	disable_obj_read_lock();
 	pthread_mutex_destroy(&counter_mutex);
 	pthread_mutex_destroy(&work_mutex);
 	pthread_mutex_destroy(&type_cas_mutex);
@@ -769,31 +772,26 @@ static void sha1_object(const void *data, struct object_entry *obj_entry,
 
 	assert(data || obj_entry);
 
-	if (startup_info->have_repository) {
-		read_lock();
+	if (startup_info->have_repository)
 		collision_test_needed =
 			has_sha1_file_with_flags(oid->hash, OBJECT_INFO_QUICK);
-		read_unlock();
-	}
 
 	if (collision_test_needed && !data) {
-		read_lock();
+		obj_read_lock();
 		if (!check_collison(obj_entry))
 			collision_test_needed = 0;
-		read_unlock();
+		obj_read_unlock();
 	}
 	if (collision_test_needed) {
 		void *has_data;
 		enum object_type has_type;
 		unsigned long has_size;
-		read_lock();
 		has_type = oid_object_info(the_repository, oid, &has_size);
 		if (has_type < 0)
 			die(_("cannot read existing object info %s"), oid_to_hex(oid));
 		if (has_type != type || has_size != size)
 			die(_("SHA1 COLLISION FOUND WITH %s !"), oid_to_hex(oid));
 		has_data = read_object_file(oid, &has_type, &has_size);
-		read_unlock();
 		if (!data)
 			data = new_data = get_data_from_pack(obj_entry);
 		if (!has_data)
@@ -805,7 +803,7 @@ static void sha1_object(const void *data, struct object_entry *obj_entry,
 	}
 
 	if (strict || do_fsck_object) {
-		read_lock();
+		parse_lock();
 		if (type == OBJ_BLOB) {
 			struct blob *blob = lookup_blob(the_repository, oid);
 			if (blob)
@@ -849,7 +847,7 @@ static void sha1_object(const void *data, struct object_entry *obj_entry,
 			}
 			obj->flags |= FLAG_CHECKED;
 		}
-		read_unlock();
+		parse_unlock();
 	}
 
 	free(new_data);
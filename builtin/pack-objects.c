@@ -67,6 +67,7 @@ static uint32_t write_layer;
 
 static int non_empty;
 static int reuse_delta = 1, reuse_object = 1;
+static enum git_zcodec pack_codec = GIT_ZCODEC_UNKNOWN;
 static int keep_unreachable, unpack_unreachable, include_tag;
 static timestamp_t unpack_unreachable_expiration;
 static int pack_loose_unreachable;
@@ -174,7 +175,8 @@ static unsigned long do_compress(void **pptr, unsigned long size)
 	void *in, *out;
 	unsigned long maxsize;
 
-	git_deflate_init(&stream, pack_compression_level);
+	git_deflate_init_codec(&stream, pack_compression_level, pack_codec);
+	git_deflate_set_size(&stream, size);
 	maxsize = git_deflate_bound(&stream, size);
 
 	in = *pptr;
@@ -201,7 +203,7 @@ static unsigned long write_large_blob_data(struct git_istream *st, struct hashfi
 	unsigned char obuf[1024 * 16];
 	unsigned long olen = 0;
 
-	git_deflate_init(&stream, pack_compression_level);
+	git_deflate_init_codec(&stream, pack_compression_level, pack_codec);
 
 	for (;;) {
 		ssize_t readlen;
@@ -262,6 +264,60 @@ static int check_pack_inflate(struct packed_git *p,
 		stream.total_in == len) ? 0 : -1;
 }
 
+/*
+ * A repository that stores objects with zstd may still be asked for a
+ * zlib pack (to send to somebody who did not ask for zstd); entries
+ * that we would otherwise copy verbatim then need to be recompressed.
+ */
+static int pack_data_needs_transcoding(struct packed_git *p,
+				       struct pack_window **w_curs,
+				       off_t offset)
+{
+	unsigned char *in;
+	unsigned long avail;
+
+	if (pack_codec != GIT_ZCODEC_ZLIB ||
+	    repository_format_object_compression == GIT_ZCODEC_ZLIB)
+		return 0;
+	/* the pack trailer guarantees there are two bytes to look at */
+	in = use_pack(p, w_curs, offset, &avail);
+	return in[0] == 0x28 && in[1] == 0xB5;
+}
+
+/*
+ * Inflate the data of an in-pack entry as stored, i.e. without
+ * resolving deltas, so that it can be compressed again with pack_codec.
+ */
+static void *inflate_pack_data(struct packed_git *p,
+			       struct pack_window **w_curs,
+			       off_t offset,
+			       unsigned long size)
+{
+	git_zstream stream;
+	unsigned char *buf, *in;
+	int st;
+
+	buf = xmallocz(size);
+	memset(&stream, 0, sizeof(stream));
+	stream.next_out = buf;
+	stream.avail_out = size + 1;
+	git_inflate_init(&stream);
+	do {
+		in = use_pack(p, w_curs, offset, &stream.avail_in);
+		stream.next_in = in;
+		st = git_inflate(&stream, Z_FINISH);
+		if (!stream.avail_out)
+			break;
+		offset += stream.next_in - in;
+	} while (st == Z_OK || st == Z_BUF_ERROR);
+	git_inflate_end(&stream);
+	if (st != Z_STREAM_END || stream.total_out != size) {
+		free(buf);
+		return NULL;
+	}
+	return buf;
+}
+
 static void copy_pack_data(struct hashfile *f,
 		struct packed_git *p,
 		struct pack_window **w_curs,
@@ -407,6 +463,7 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 	unsigned hdrlen;
 	const unsigned hashsz = the_hash_algo->rawsz;
 	unsigned long entry_size = SIZE(entry);
+	void *zbuf = NULL;
 
 	if (DELTA(entry))
 		type = (allow_ofs_delta && DELTA(entry)->idx.offset) ?
@@ -436,6 +493,17 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 		return write_no_reuse_object(f, entry, limit, usable_delta);
 	}
 
+	if (pack_data_needs_transcoding(p, &w_curs, offset)) {
+		zbuf = inflate_pack_data(p, &w_curs, offset, entry_size);
+		if (!zbuf) {
+			error(_("corrupt packed object for %s"),
+			      oid_to_hex(&entry->idx.oid));
+			unuse_pack(&w_curs);
+			return write_no_reuse_object(f, entry, limit, usable_delta);
+		}
+		datalen = do_compress(&zbuf, entry_size);
+	}
+
 	if (type == OBJ_OFS_DELTA) {
 		off_t ofs = entry->idx.offset - DELTA(entry)->idx.offset;
 		unsigned pos = sizeof(dheader) - 1;
@@ -444,6 +512,7 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 			dheader[--pos] = 128 | (--ofs & 127);
 		if (limit && hdrlen + sizeof(dheader) - pos + datalen + hashsz >= limit) {
 			unuse_pack(&w_curs);
+			free(zbuf);
 			return 0;
 		}
 		hashwrite(f, header, hdrlen);
@@ -453,6 +522,7 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 	} else if (type == OBJ_REF_DELTA) {
 		if (limit && hdrlen + hashsz + datalen + hashsz >= limit) {
 			unuse_pack(&w_curs);
+			free(zbuf);
 			return 0;
 		}
 		hashwrite(f, header, hdrlen);
@@ -462,11 +532,16 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 	} else {
 		if (limit && hdrlen + datalen + hashsz >= limit) {
 			unuse_pack(&w_curs);
+			free(zbuf);
 			return 0;
 		}
 		hashwrite(f, header, hdrlen);
 	}
-	copy_pack_data(f, p, &w_curs, offset, datalen);
+	if (zbuf)
+		hashwrite(f, zbuf, datalen);
+	else
+		copy_pack_data(f, p, &w_curs, offset, datalen);
+	free(zbuf);
 	unuse_pack(&w_curs);
 	reused++;
 	return hdrlen + datalen;
@@ -1953,11 +2028,6 @@ static int delta_cacheable(unsigned long src_size, unsigned long trg_size,
 	return 0;
 }
 
-/* Protect access to object database */
-static pthread_mutex_t read_mutex;
-#define read_lock()		pthread_mutex_lock(&read_mutex)
-#define read_unlock()		pthread_mutex_unlock(&read_mutex)
-
 /* Protect delta_cache_size */
 static pthread_mutex_t cache_mutex;
 #define cache_lock()		pthread_mutex_lock(&cache_mutex)
@@ -1993,11 +2063,9 @@ unsigned long oe_get_size_slow(struct packing_data *pack,
 	unsigned long used, avail, size;
 
 	if (e->type_ != OBJ_OFS_DELTA && e->type_ != OBJ_REF_DELTA) {
-		read_lock();
 		if (oid_object_info(the_repository, &e->idx.oid, &size) < 0)
 			die(_("unable to get size of %s"),
 			    oid_to_hex(&e->idx.oid));
-		read_unlock();
 		return size;
 	}
 
@@ -2005,7 +2073,7 @@ unsigned long oe_get_size_slow(struct packing_data *pack,
 	if (!p)
 		BUG("when e->type is a delta, it must belong to a pack");
 
-	read_lock();
+	obj_read_lock();
 	w_curs = NULL;
 	buf = use_pack(p, &w_curs, e->in_pack_offset, &avail);
 	used = unpack_object_header_buffer(buf, avail, &type, &size);
@@ -2014,7 +2082,7 @@ unsigned long oe_get_size_slow(struct packing_data *pack,
 		    oid_to_hex(&e->idx.oid));
 
 	unuse_pack(&w_curs);
-	read_unlock();
+	obj_read_unlock();
 	return size;
 }
 
@@ -2076,9 +2144,7 @@ static int try_delta(struct unpacked *trg, struct unpacked *src,
 
 	/* Load data if not already done */
 	if (!trg->data) {
-		read_lock();
 		trg->data = read_object_file(&trg_entry->idx.oid, &type, &sz);
-		read_unlock();
 		if (!trg->data)
 			die(_("object %s cannot be read"),
 			    oid_to_hex(&trg_entry->idx.oid));
@@ -2089,9 +2155,7 @@ static int try_delta(struct unpacked *trg, struct unpacked *src,
 		*mem_usage += sz;
 	}
 	if (!src->data) {
-		read_lock();
 		src->data = read_object_file(&src_entry->idx.oid, &type, &sz);
-		read_unlock();
 		if (!src->data) {
 			if (src_entry->preferred_base) {
 				static int warned = 0;
@@ -2337,9 +2401,9 @@ static void find_deltas(struct object_entry **list, unsigned *list_size,
 
 static void try_to_free_from_threads(size_t size)
 {
-	read_lock();
+	obj_read_lock();
 	release_pack_memory(size);
-	read_unlock();
+	obj_read_unlock();
 }
 
 static try_to_free_t old_try_to_free_routine;
@@ -2381,7 +2445,7 @@ static pthread_cond_t progress_cond;
  */
 static void init_threaded_search(void)
 {
-	init_recursive_mutex(&read_mutex);
+	enable_obj_read_lock();
 	pthread_mutex_init(&cache_mutex, NULL);
 	pthread_mutex_init(&progress_mutex, NULL);
 	pthread_cond_init(&progress_cond, NULL);
@@ -2392,7 +2456,7 @@ static void cleanup_threaded_search(void)
 {
 	set_try_to_free_routine(old_try_to_free_routine);
 	pthread_cond_destroy(&progress_cond);
-	pthread_mutex_destroy(&read_mutex);
+	disable_obj_read_lock();
 	pthread_mutex_destroy(&cache_mutex);
 	pthread_mutex_destroy(&progress_mutex);
 }
@@ -3043,6 +3107,8 @@ static int pack_options_allow_reuse(void)
 {
 	return pack_to_stdout &&
 	       allow_ofs_delta &&
+	       (pack_codec != GIT_ZCODEC_ZLIB ||
+		repository_format_object_compression == GIT_ZCODEC_ZLIB) &&
 	       !ignore_packed_keep_on_disk &&
 	       !ignore_packed_keep_in_core &&
 	       (!local || !have_non_local_packs) &&
@@ -3051,7 +3117,7 @@ static int pack_options_allow_reuse(void)
 
 static int get_object_list_from_bitmap(struct rev_info *revs)
 {
-	if (!(bitmap_git = prepare_bitmap_walk(revs)))
+	if (!(bitmap_git = prepare_bitmap_walk(revs, &filter_options)))
 		return -1;
 
 	if (pack_options_allow_reuse() &&
@@ -3232,6 +3298,7 @@ int cmd_pack_objects(int argc, const char **argv, const char *prefix)
 	int rev_list_unpacked = 0, rev_list_all = 0, rev_list_reflog = 0;
 	int rev_list_index = 0;
 	struct string_list keep_pack_list = STRING_LIST_INIT_NODUP;
+	const char *pack_codec_name = NULL;
 	struct option pack_objects_options[] = {
 		OPT_SET_INT('q', "quiet", &progress,
 			    N_("do not show progress meter"), 0),
@@ -3302,6 +3369,8 @@ int cmd_pack_objects(int argc, const char **argv, const char *prefix)
 				N_("ignore this pack")),
 		OPT_INTEGER(0, "compression", &pack_compression_level,
 			    N_("pack compression level")),
+		OPT_STRING(0, "compression-codec", &pack_codec_name, N_("codec"),
+			   N_("compress objects with <codec> (zlib or zstd)")),
 		OPT_SET_INT(0, "keep-true-parents", &grafts_replace_parents,
 			    N_("do not hide commits by grafts"), 0),
 		OPT_BOOL(0, "use-bitmap-index", &use_bitmap_index,
@@ -3390,6 +3459,19 @@ int cmd_pack_objects(int argc, const char **argv, const char *prefix)
 	else if (pack_compression_level < 0 || pack_compression_level > Z_BEST_COMPRESSION)
 		die(_("bad pack compression level %d"), pack_compression_level);
 
+	/*
+	 * Packs that leave the repository stay in zlib unless the
+	 * receiving end has told us (via the caller) it can read zstd.
+	 */
+	if (pack_codec_name) {
+		pack_codec = git_zcodec_from_name(pack_codec_name);
+		if (!git_zcodec_supported(pack_codec))
+			die(_("unsupported compression codec '%s'"), pack_codec_name);
+	} else if (pack_to_stdout)
+		pack_codec = GIT_ZCODEC_ZLIB;
+	else
+		pack_codec = repository_format_object_compression;
+
 	if (!delta_search_threads)	/* --threads=0 means autodetect */
 		delta_search_threads = online_cpus();
 
@@ -3415,7 +3497,6 @@ int cmd_pack_objects(int argc, const char **argv, const char *prefix)
 	if (filter_options.choice) {
 		if (!pack_to_stdout)
 			die(_("cannot use --filter without --stdout"));
-		use_bitmap_index = 0;
 	}
 
 	/*
@@ -1293,6 +1293,7 @@ static void set_connectivity_errors(struct command *commands,
 			continue;
 
 		opt.env = tmp_objdir_env(tmp_objdir);
+		opt.env_objects_visible = 1;
 		if (!check_connected(command_singleton_iterator, &singleton,
 				     &opt))
 			continue;
@@ -1479,6 +1480,7 @@ static void execute_commands(struct command *commands,
 	opt.err_fd = err_fd;
 	opt.progress = err_fd && !quiet;
 	opt.env = tmp_objdir_env(tmp_objdir);
+	opt.env_objects_visible = 1;
 	if (check_connected(iterate_receive_command_list, &data, &opt))
 		set_connectivity_errors(commands, si);
 
@@ -19,6 +19,8 @@
 #include "oidset.h"
 #include "packfile.h"
 #include "object-store.h"
+#include "commit-graph.h"
+#include "tag.h"
 
 static const char rev_list_usage[] =
 "git rev-list [OPTION] <commit-id>... [ -- paths... ]\n"
@@ -53,6 +55,7 @@ static const char rev_list_usage[] =
 "    --abbrev-commit\n"
 "    --left-right\n"
 "    --count\n"
+"    --disk-usage[=by-type]\n"
 "  special purpose:\n"
 "    --bisect\n"
 "    --bisect-vars\n"
@@ -77,6 +80,69 @@ static enum missing_action arg_missing_action;
 
 #define DEFAULT_OIDSET_SIZE     (16*1024)
 
+enum disk_usage_format {
+	DU_NONE = 0,
+	DU_TOTAL,	/* print the number of bytes used by all objects */
+	DU_BY_TYPE,	/* print the number and bytes of objects of each type */
+};
+static enum disk_usage_format arg_disk_usage;
+
+struct disk_usage {
+	uint32_t count;
+	off_t size;
+};
+static struct disk_usage disk_usage[OBJ_TAG + 1];
+
+static void add_disk_usage(struct object *obj)
+{
+	struct object_info oi = OBJECT_INFO_INIT;
+	off_t size;
+
+	oi.disk_sizep = &size;
+	if (oid_object_info_extended(the_repository, &obj->oid, &oi, 0) < 0)
+		die(_("unable to get disk usage of %s"), oid_to_hex(&obj->oid));
+	disk_usage[obj->type].count++;
+	disk_usage[obj->type].size += size;
+}
+
+static void print_disk_usage(void)
+{
+	enum object_type type;
+	off_t total = 0;
+
+	for (type = OBJ_COMMIT; type <= OBJ_TAG; type++) {
+		if (arg_disk_usage == DU_BY_TYPE)
+			printf("%s %"PRIu32" %"PRIuMAX"\n", type_name(type),
+			       disk_usage[type].count,
+			       (uintmax_t)disk_usage[type].size);
+		total += disk_usage[type].size;
+	}
+	if (arg_disk_usage == DU_TOTAL)
+		printf("%"PRIuMAX"\n", (uintmax_t)total);
+}
+
+/*
+ * Answer "--disk-usage" from a reachability bitmap: the counts are
+ * popcounts of the result, and the sizes come from the pack's reverse
+ * index. Without "--objects" only the commits are of interest.
+ */
+static void bitmap_disk_usage(struct rev_info *revs,
+			      struct bitmap_index *bitmap_git)
+{
+	int all = revs->tree_objects;
+
+	count_bitmap_commit_list(bitmap_git,
+				 &disk_usage[OBJ_COMMIT].count,
+				 all ? &disk_usage[OBJ_TREE].count : NULL,
+				 all ? &disk_usage[OBJ_BLOB].count : NULL,
+				 all ? &disk_usage[OBJ_TAG].count : NULL);
+	get_bitmap_disk_usage(bitmap_git,
+			      &disk_usage[OBJ_COMMIT].size,
+			      all ? &disk_usage[OBJ_TREE].size : NULL,
+			      all ? &disk_usage[OBJ_BLOB].size : NULL,
+			      all ? &disk_usage[OBJ_TAG].size : NULL);
+}
+
 static void finish_commit(struct commit *commit, void *data);
 static void show_commit(struct commit *commit, void *data)
 {
@@ -103,6 +169,12 @@ static void show_commit(struct commit *commit, void *data)
 		return;
 	}
 
+	if (arg_disk_usage) {
+		add_disk_usage(&commit->object);
+		finish_commit(commit, data);
+		return;
+	}
+
 	if (info->show_timestamp)
 		printf("%"PRItime" ", commit->date);
 	if (info->header_prefix)
@@ -254,6 +326,10 @@ static void show_object(struct object *obj, const char *name, void *cb_data)
 	display_progress(progress, ++progress_counter);
 	if (info->flags & REV_LIST_QUIET)
 		return;
+	if (arg_disk_usage) {
+		add_disk_usage(obj);
+		return;
+	}
 	show_object_with_name(stdout, obj, name);
 }
 
@@ -329,6 +405,58 @@ static int show_object_fast(
 	return 1;
 }
 
+/*
+ * Answer a plain "--count" from the commit-graph alone, without
+ * creating a commit object for each commit that is counted. Returns 0
+ * on success and -1 if the options or the commits given ask for more
+ * than the topology that the commit-graph stores.
+ */
+static int count_in_commit_graph(struct rev_info *revs, uint32_t *count)
+{
+	struct object_id *include = NULL, *exclude = NULL;
+	int nr_include = 0, nr_exclude = 0;
+	int alloc_include = 0, alloc_exclude = 0;
+	int i, ret = -1;
+
+	if (revs->prune || revs->no_walk || revs->simplify_by_decoration ||
+	    revs->tag_objects || revs->tree_objects || revs->blob_objects ||
+	    revs->boundary || revs->left_right || revs->left_only ||
+	    revs->right_only || revs->cherry_pick || revs->cherry_mark ||
+	    revs->bisect || revs->ancestry_path || revs->line_level_traverse ||
+	    revs->unpacked || revs->reflog_info || revs->skip_count > 0 ||
+	    revs->max_age != -1 || revs->min_age != -1 ||
+	    revs->min_parents || revs->max_parents != -1 ||
+	    revs->grep_filter.pattern_list || revs->grep_filter.header_list ||
+	    revs->include_check || revs->exclude_promisor_objects ||
+	    filter_options.choice)
+		return -1;
+
+	for (i = 0; i < revs->pending.nr; i++) {
+		struct object *obj = revs->pending.objects[i].item;
+		int uninteresting = obj->flags & UNINTERESTING;
+
+		obj = deref_tag(the_repository, obj, NULL, 0);
+		if (!obj || obj->type != OBJ_COMMIT)
+			goto out;
+		if (uninteresting) {
+			ALLOC_GROW(exclude, nr_exclude + 1, alloc_exclude);
+			oidcpy(&exclude[nr_exclude++], &obj->oid);
+		} else {
+			ALLOC_GROW(include, nr_include + 1, alloc_include);
+			oidcpy(&include[nr_include++], &obj->oid);
+		}
+	}
+
+	ret = commit_graph_count_reachable(the_repository,
+					   include, nr_include,
+					   exclude, nr_exclude,
+					   revs->first_parent_only, count);
+out:
+	free(include);
+	free(exclude);
+	return ret;
+}
+
 static inline int parse_missing_action_value(const char *value)
 {
 	if (!strcmp(value, "error")) {
@@ -442,6 +570,16 @@ int cmd_rev_list(int argc, const char **argv, const char *prefix)
 			bisect_show_vars = 1;
 			continue;
 		}
+		if (!strcmp(arg, "--disk-usage")) {
+			arg_disk_usage = DU_TOTAL;
+			continue;
+		}
+		if (skip_prefix(arg, "--disk-usage=", &arg)) {
+			if (strcmp(arg, "by-type"))
+				die(_("invalid value for --disk-usage: %s"), arg);
+			arg_disk_usage = DU_BY_TYPE;
+			continue;
+		}
 		if (!strcmp(arg, "--use-bitmap-index")) {
 			use_bitmap_index = 1;
 			continue;
@@ -504,8 +642,10 @@ int cmd_rev_list(int argc, const char **argv, const char *prefix)
 	if (revs.show_notes)
 		die(_("rev-list does not support display of notes"));
 
-	if (filter_options.choice && use_bitmap_index)
-		die(_("cannot combine --use-bitmap-index with object filtering"));
+	if (arg_print_omitted && use_bitmap_index)
+		die(_("cannot combine --use-bitmap-index with --filter-print-omitted"));
+	if (arg_disk_usage && revs.count)
+		die(_("cannot combine --disk-usage with --count"));
 
 	save_commit_buffer = (revs.verbose_header ||
 			      revs.grep_filter.pattern_list ||
@@ -517,11 +657,22 @@ int cmd_rev_list(int argc, const char **argv, const char *prefix)
 		progress = start_delayed_progress(show_progress, 0);
 
 	if (use_bitmap_index && !revs.prune) {
-		if (revs.count && !revs.left_right && !revs.cherry_mark) {
+		if (arg_disk_usage) {
+			struct bitmap_index *bitmap_git;
+			if (revs.max_count < 0 &&
+			    revs.tag_objects == revs.tree_objects &&
+			    revs.tree_objects == revs.blob_objects &&
+			    (bitmap_git = prepare_bitmap_walk(&revs, &filter_options))) {
+				bitmap_disk_usage(&revs, bitmap_git);
+				print_disk_usage();
+				free_bitmap_index(bitmap_git);
+				return 0;
+			}
+		} else if (revs.count && !revs.left_right && !revs.cherry_mark) {
 			uint32_t commit_count;
 			int max_count = revs.max_count;
 			struct bitmap_index *bitmap_git;
-			if ((bitmap_git = prepare_bitmap_walk(&revs))) {
+			if ((bitmap_git = prepare_bitmap_walk(&revs, &filter_options))) {
 				count_bitmap_commit_list(bitmap_git, &commit_count, NULL, NULL, NULL);
 				if (max_count >= 0 && max_count < commit_count)
 					commit_count = max_count;
@@ -532,7 +683,7 @@ int cmd_rev_list(int argc, const char **argv, const char *prefix)
 		} else if (revs.max_count < 0 &&
 			   revs.tag_objects && revs.tree_objects && revs.blob_objects) {
 			struct bitmap_index *bitmap_git;
-			if ((bitmap_git = prepare_bitmap_walk(&revs))) {
+			if ((bitmap_git = prepare_bitmap_walk(&revs, &filter_options))) {
 				traverse_bitmap_commit_list(bitmap_git, &show_object_fast);
 				free_bitmap_index(bitmap_git);
 				return 0;
@@ -540,6 +691,17 @@ int cmd_rev_list(int argc, const char **argv, const char *prefix)
 		}
 	}
 
+	if (revs.count && !bisect_list) {
+		uint32_t commit_count;
+
+		if (!count_in_commit_graph(&revs, &commit_count)) {
+			if (revs.max_count >= 0 && revs.max_count < commit_count)
+				commit_count = revs.max_count;
+			printf("%u\n", commit_count);
+			return 0;
+		}
+	}
+
 	if (prepare_revision_walk(&revs))
 		die("revision walk setup failed");
 	if (revs.tree_objects)
@@ -582,6 +744,9 @@ int cmd_rev_list(int argc, const char **argv, const char *prefix)
 
 	stop_progress(&progress);
 
+	if (arg_disk_usage)
+		print_disk_usage();
+
 	if (revs.count) {
 		if (revs.left_right && revs.cherry_mark)
 			printf("%d\t%d\t%d\n", revs.count_left, revs.count_right, revs.count_same);
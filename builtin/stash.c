@@ -14,6 +14,7 @@
 #include "log-tree.h"
 #include "diffcore.h"
 #include "exec-cmd.h"
+#include "bulk-checkin.h"
 
 #define INCLUDE_ALL_FILES 2
 
@@ -1020,6 +1021,8 @@ static int stash_patch(struct stash_info *info, struct pathspec ps,
 		goto done;
 	}
 
+	/* diff-tree needs to see the tree we just wrote */
+	flush_bulk_checkin();
 	cp_diff_tree.git_cmd = 1;
 	argv_array_pushl(&cp_diff_tree.args, "diff-tree", "-p", "HEAD",
 			 oid_to_hex(&info->w_tree), "--", NULL);
@@ -1144,6 +1147,8 @@ static int do_create_stash(struct pathspec ps, struct strbuf *stash_msg_buf,
 	strbuf_addf(&msg, "%s: %s ", branch_name, head_short_sha1);
 	pp_commit_easy(CMIT_FMT_ONELINE, head_commit, &msg);
 
+	plug_bulk_checkin();
+
 	strbuf_addf(&commit_tree_label, "index on %s\n", msg.buf);
 	commit_list_insert(head_commit, &parents);
 	if (write_cache_as_tree(&info->i_tree, 0, NULL) ||
@@ -1156,6 +1161,9 @@ static int do_create_stash(struct pathspec ps, struct strbuf *stash_msg_buf,
 		goto done;
 	}
 
+	/* the commands run below may need the index state */
+	flush_bulk_checkin();
+
 	if (include_untracked) {
 		if (save_untracked_files(info, &msg, untracked_files)) {
 			if (!quiet)
@@ -1220,6 +1228,7 @@ static int do_create_stash(struct pathspec ps, struct strbuf *stash_msg_buf,
 	}
 
 done:
+	unplug_bulk_checkin();
 	strbuf_release(&commit_tree_label);
 	strbuf_release(&msg);
 	strbuf_release(&untracked_files);
@@ -9,6 +9,7 @@
 #include "tree.h"
 #include "cache-tree.h"
 #include "parse-options.h"
+#include "bulk-checkin.h"
 
 static const char * const write_tree_usage[] = {
 	N_("git write-tree [--missing-ok] [--prefix=<prefix>/]"),
@@ -37,7 +38,9 @@ int cmd_write_tree(int argc, const char **argv, const char *unused_prefix)
 	argc = parse_options(argc, argv, unused_prefix, write_tree_options,
 			     write_tree_usage, 0);
 
+	plug_bulk_checkin();
 	ret = write_cache_as_tree(&oid, flags, prefix);
+	unplug_bulk_checkin();
 	switch (ret) {
 	case 0:
 		printf("%s\n", oid_to_hex(&oid));
@@ -9,26 +9,68 @@
 #include "strbuf.h"
 #include "packfile.h"
 #include "object-store.h"
+#include "oidset.h"
+#include "tmp-objdir.h"
 
 static struct bulk_checkin_state {
 	unsigned plugged:1;
+	unsigned atexit_registered:1;
 
 	char *pack_tmp_name;
 	struct hashfile *f;
 	off_t offset;
 	struct pack_idx_option pack_idx_opts;
 
+	/* where the object being written starts, while it is written */
+	unsigned in_object:1;
+	struct hashfile_checkpoint object_start;
+
 	struct pack_idx_entry **written;
 	uint32_t alloc_written;
 	uint32_t nr_written;
+	/* the same objects, to look them up quickly */
+	struct oidset written_oids;
+
+	/*
+	 * The first object given to bulk_checkin_write_object() is held
+	 * back until a second one arrives, so that a command writing a
+	 * single object leaves a loose object rather than a pack of one.
+	 */
+	void *held_buf;
+	size_t held_size;
+	enum object_type held_type;
+	struct object_id held_oid;
 } state;
 
+static void write_held_loose(struct bulk_checkin_state *state)
+{
+	struct object_id oid;
+	unsigned plugged = state->plugged;
+	void *buf = state->held_buf;
+
+	/* with the plug pulled, write_object_file() writes it loose */
+	state->held_buf = NULL;
+	state->plugged = 0;
+	if (write_object_file(buf, state->held_size,
+			      type_name(state->held_type), &oid))
+		die(_("unable to write %s object %s"),
+		    type_name(state->held_type), oid_to_hex(&state->held_oid));
+	state->plugged = plugged;
+
+	free(buf);
+	oidset_clear(&state->written_oids);
+}
+
 static void finish_bulk_checkin(struct bulk_checkin_state *state)
 {
 	struct object_id oid;
 	struct strbuf packname = STRBUF_INIT;
+	unsigned plugged = state->plugged;
+	unsigned atexit_registered = state->atexit_registered;
 	int i;
 
+	if (state->held_buf)
+		write_held_loose(state);
 	if (!state->f)
 		return;
 
@@ -55,30 +97,39 @@ static void finish_bulk_checkin(struct bulk_checkin_state *state)
 
 clear_exit:
 	free(state->written);
+	oidset_clear(&state->written_oids);
 	memset(state, 0, sizeof(*state));
+	state->plugged = plugged;
+	state->atexit_registered = atexit_registered;
 
 	strbuf_release(&packname);
 	/* Make objects we just wrote available to ourselves */
 	reprepare_packed_git(the_repository);
 }
 
-static int already_written(struct bulk_checkin_state *state, struct object_id *oid)
+static int already_written(struct bulk_checkin_state *state,
+			   const struct object_id *oid)
 {
-	int i;
+	/* We may have written it already */
+	if (oidset_contains(&state->written_oids, oid))
+		return 1;
 
 	/* The object may already exist in the repository */
 	if (has_sha1_file(oid->hash))
 		return 1;
 
-	/* Might want to keep the list sorted */
-	for (i = 0; i < state->nr_written; i++)
-		if (oideq(&state->written[i]->oid, oid))
-			return 1;
-
 	/* This is a new object we need to keep */
 	return 0;
 }
 
+static void add_written(struct bulk_checkin_state *state,
+			struct pack_idx_entry *idx)
+{
+	ALLOC_GROW(state->written, state->nr_written + 1, state->alloc_written);
+	state->written[state->nr_written++] = idx;
+	oidset_insert(&state->written_oids, &idx->oid);
+}
+
 /*
  * Read the contents from fd for size bytes, streaming it to the
  * packfile in state while updating the hash in ctx. Signal a failure
@@ -187,6 +238,8 @@ static void prepare_to_stream(struct bulk_checkin_state *state,
 		die_errno("unable to write pack header");
 }
 
+static void append_held(struct bulk_checkin_state *state);
+
 static int deflate_to_pack(struct bulk_checkin_state *state,
 			   struct object_id *result_oid,
 			   int fd, size_t size,
@@ -197,7 +250,7 @@ static int deflate_to_pack(struct bulk_checkin_state *state,
 	git_hash_ctx ctx;
 	unsigned char obuf[16384];
 	unsigned header_len;
-	struct hashfile_checkpoint checkpoint;
+	struct hashfile_checkpoint *checkpoint = &state->object_start;
 	struct pack_idx_entry *idx = NULL;
 
 	seekback = lseek(fd, 0, SEEK_CUR);
@@ -210,15 +263,18 @@ static int deflate_to_pack(struct bulk_checkin_state *state,
 	the_hash_algo->update_fn(&ctx, obuf, header_len);
 
 	/* Note: idx is non-NULL when we are writing */
-	if ((flags & HASH_WRITE_OBJECT) != 0)
+	if ((flags & HASH_WRITE_OBJECT) != 0) {
+		append_held(state);
 		idx = xcalloc(1, sizeof(*idx));
+	}
 
 	already_hashed_to = 0;
 
 	while (1) {
 		prepare_to_stream(state, flags);
 		if (idx) {
-			hashfile_checkpoint(state->f, &checkpoint);
+			hashfile_checkpoint(state->f, checkpoint);
+			state->in_object = 1;
 			idx->offset = state->offset;
 			crc32_begin(state->f);
 		}
@@ -232,8 +288,9 @@ static int deflate_to_pack(struct bulk_checkin_state *state,
 		 */
 		if (!idx)
 			BUG("should not happen");
-		hashfile_truncate(state->f, &checkpoint);
-		state->offset = checkpoint.offset;
+		hashfile_truncate(state->f, checkpoint);
+		state->offset = checkpoint->offset;
+		state->in_object = 0;
 		finish_bulk_checkin(state);
 		if (lseek(fd, seekback, SEEK_SET) == (off_t) -1)
 			return error("cannot seek back");
@@ -243,20 +300,205 @@ static int deflate_to_pack(struct bulk_checkin_state *state,
 		return 0;
 
 	idx->crc32 = crc32_end(state->f);
+	state->in_object = 0;
 	if (already_written(state, result_oid)) {
-		hashfile_truncate(state->f, &checkpoint);
-		state->offset = checkpoint.offset;
+		hashfile_truncate(state->f, checkpoint);
+		state->offset = checkpoint->offset;
 		free(idx);
 	} else {
 		oidcpy(&idx->oid, result_oid);
-		ALLOC_GROW(state->written,
-			   state->nr_written + 1,
-			   state->alloc_written);
-		state->written[state->nr_written++] = idx;
+		add_written(state, idx);
 	}
 	return 0;
 }
 
+/*
+ * Like stream_to_pack(), but for an object that is already in memory
+ * and whose name the caller has computed.
+ */
+static int buf_to_pack(struct bulk_checkin_state *state,
+		       const void *buf, size_t size, enum object_type type)
+{
+	git_zstream s;
+	unsigned char obuf[16384];
+	unsigned hdrlen;
+	int status;
+
+	git_deflate_init(&s, pack_compression_level);
+
+	hdrlen = encode_in_pack_object_header(obuf, sizeof(obuf), type, size);
+	s.next_out = obuf + hdrlen;
+	s.avail_out = sizeof(obuf) - hdrlen;
+	s.next_in = (void *)buf;
+	s.avail_in = size;
+
+	do {
+		status = git_deflate(&s, Z_FINISH);
+		if (status != Z_OK && status != Z_BUF_ERROR &&
+		    status != Z_STREAM_END)
+			die("unexpected deflate failure: %d", status);
+
+		if (!s.avail_out || status == Z_STREAM_END) {
+			size_t written = s.next_out - obuf;
+
+			/* would we bust the size limit? */
+			if (state->nr_written &&
+			    pack_size_limit_cfg &&
+			    pack_size_limit_cfg < state->offset + written) {
+				git_deflate_abort(&s);
+				return -1;
+			}
+
+			hashwrite(state->f, obuf, written);
+			state->offset += written;
+			s.next_out = obuf;
+			s.avail_out = sizeof(obuf);
+		}
+	} while (status != Z_STREAM_END);
+	git_deflate_end(&s);
+	return 0;
+}
+
+int bulk_checkin_active(void)
+{
+	return state.plugged && bulk_checkin_mode == BULK_CHECKIN_ALWAYS;
+}
+
+static void append_object(struct bulk_checkin_state *state,
+			  const void *buf, size_t size,
+			  enum object_type type,
+			  const struct object_id *oid)
+{
+	struct hashfile_checkpoint *checkpoint = &state->object_start;
+	struct pack_idx_entry *idx;
+
+	idx = xcalloc(1, sizeof(*idx));
+	while (1) {
+		prepare_to_stream(state, HASH_WRITE_OBJECT);
+		hashfile_checkpoint(state->f, checkpoint);
+		state->in_object = 1;
+		idx->offset = state->offset;
+		crc32_begin(state->f);
+		if (!buf_to_pack(state, buf, size, type))
+			break;
+		/* start a new pack, as in deflate_to_pack() */
+		hashfile_truncate(state->f, checkpoint);
+		state->offset = checkpoint->offset;
+		state->in_object = 0;
+		finish_bulk_checkin(state);
+	}
+	idx->crc32 = crc32_end(state->f);
+	state->in_object = 0;
+	oidcpy(&idx->oid, oid);
+	add_written(state, idx);
+}
+
+/* The pack is going to be written after all; put the held object in it. */
+static void append_held(struct bulk_checkin_state *state)
+{
+	void *buf = state->held_buf;
+
+	if (!buf)
+		return;
+	state->held_buf = NULL;
+	append_object(state, buf, state->held_size, state->held_type,
+		      &state->held_oid);
+	free(buf);
+}
+
+int bulk_checkin_write_object(const void *buf, size_t size,
+			      enum object_type type,
+			      const struct object_id *oid)
+{
+	/* write_object_file() has already looked for it elsewhere */
+	if (oidset_contains(&state.written_oids, oid))
+		return 0;
+
+	if (!state.f && !state.held_buf) {
+		state.held_buf = xmemdupz(buf, size);
+		state.held_size = size;
+		state.held_type = type;
+		oidcpy(&state.held_oid, oid);
+		oidset_insert(&state.written_oids, oid);
+		return 0;
+	}
+
+	append_held(&state);
+	append_object(&state, buf, size, type, oid);
+	return 0;
+}
+
+int bulk_checkin_has_object(const struct object_id *oid)
+{
+	return oidset_contains(&state.written_oids, oid);
+}
+
+/*
+ * With core.fsyncObjectFiles=batch, loose objects written while plugged
+ * go to this temporary object directory without being synced one by
+ * one, and are synced all at once before being moved into place.
+ */
+static struct tmp_objdir *staging;
+static unsigned int staged_nr;
+static struct trace_key trace_bulk_checkin = TRACE_KEY_INIT(BULK_CHECKIN);
+
+static int migrate_staged_objects(void)
+{
+	struct tmp_objdir *t = staging;
+
+	if (!t)
+		return 0;
+	staging = NULL;
+	trace_printf_key(&trace_bulk_checkin, "migrating %u staged objects",
+			 staged_nr);
+	staged_nr = 0;
+	if (tmp_objdir_sync(t)) {
+		error_errno(_("unable to sync objects in '%s'"),
+			    tmp_objdir_path(t));
+		tmp_objdir_destroy(t);
+		return -1;
+	}
+	if (tmp_objdir_migrate(t))
+		return error(_("unable to move new objects into place"));
+	return 0;
+}
+
+static void migrate_staged_objects_atexit(void)
+{
+	migrate_staged_objects();
+}
+
+const char *bulk_checkin_staging_dir(void)
+{
+	static int atexit_registered;
+
+	if (!state.plugged)
+		return NULL;
+	if (!staging) {
+		staging = tmp_objdir_create();
+		if (!staging)
+			return NULL;
+		tmp_objdir_add_as_alternate(staging);
+		/*
+		 * Registered after tmp-objdir's own cleanup, so that it
+		 * runs before the directory is removed.
+		 */
+		if (!atexit_registered) {
+			atexit(migrate_staged_objects_atexit);
+			atexit_registered = 1;
+		}
+	}
+	staged_nr++;
+	return tmp_objdir_path(staging);
+}
+
+void flush_bulk_checkin(void)
+{
+	finish_bulk_checkin(&state);
+	if (migrate_staged_objects())
+		die(_("unable to write new objects"));
+}
+
 int index_bulk_checkin(struct object_id *oid,
 		       int fd, size_t size, enum object_type type,
 		       const char *path, unsigned flags)
@@ -268,14 +510,35 @@ int index_bulk_checkin(struct object_id *oid,
 	return status;
 }
 
+static void finish_bulk_checkin_atexit(void)
+{
+	/* die() may have stopped us in the middle of an object */
+	if (state.f && state.in_object) {
+		hashfile_truncate(state.f, &state.object_start);
+		state.offset = state.object_start.offset;
+		state.in_object = 0;
+	}
+	/*
+	 * Nothing can refer to the held object yet (see
+	 * flush_bulk_checkin()); rather than writing it from an exit
+	 * handler, drop it.
+	 */
+	FREE_AND_NULL(state.held_buf);
+	finish_bulk_checkin(&state);
+}
+
 void plug_bulk_checkin(void)
 {
 	state.plugged = 1;
+	/* whatever happens, do not lose the objects written so far */
+	if (!state.atexit_registered) {
+		atexit(finish_bulk_checkin_atexit);
+		state.atexit_registered = 1;
+	}
 }
 
 void unplug_bulk_checkin(void)
 {
 	state.plugged = 0;
-	if (state.f)
-		finish_bulk_checkin(&state);
+	flush_bulk_checkin();
 }
@@ -10,7 +10,47 @@ extern int index_bulk_checkin(struct object_id *oid,
 			      int fd, size_t size, enum object_type type,
 			      const char *path, unsigned flags);
 
+/*
+ * While plugged, the objects checked in go into a single pack that is
+ * finished when unplugged (or when the command exits).  Normally only
+ * blobs above core.bigFileThreshold go there; with core.bulkCheckin set
+ * to "always", write_object_file() sends every new object there too.
+ */
 extern void plug_bulk_checkin(void);
 extern void unplug_bulk_checkin(void);
 
+/* Whether write_object_file() should use bulk_checkin_write_object(). */
+extern int bulk_checkin_active(void);
+
+extern int bulk_checkin_write_object(const void *buf, size_t size,
+				     enum object_type type,
+				     const struct object_id *oid);
+
+/*
+ * Whether "oid" has been handed to bulk_checkin_write_object() but
+ * cannot be read until flush_bulk_checkin() (or unplugging) finishes
+ * the pack.
+ */
+extern int bulk_checkin_has_object(const struct object_id *oid);
+
+/*
+ * Finish the pack being written, if any, and move staged loose objects
+ * into place without unplugging, e.g. before another process that
+ * needs the objects is started.  write_locked_index() and
+ * ref_transaction_commit() call it, so that neither the index nor a
+ * ref can name an object that is not in the repository yet.
+ */
+extern void flush_bulk_checkin(void);
+
+/*
+ * With core.fsyncObjectFiles=batch, the directory that loose objects
+ * written while plugged should go to instead of the object directory,
+ * or NULL if they should be written (and synced) as usual.  Objects
+ * there can be read right away, and are synced together and moved
+ * into the object directory when unplugged, before the command goes
+ * on to write anything that refers to them.  Each call is expected to
+ * be followed by writing one object there.
+ */
+extern const char *bulk_checkin_staging_dir(void);
+
 #endif
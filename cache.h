@@ -18,6 +18,18 @@
 #include "mem-pool.h"
 
 #include <zlib.h>
+
+/*
+ * Compression formats an object can be stored in.  Readers do not need
+ * to be told which one they are looking at: git_inflate() recognizes a
+ * zstd frame by its magic number and falls back to zlib otherwise.
+ */
+enum git_zcodec {
+	GIT_ZCODEC_UNKNOWN = -1,
+	GIT_ZCODEC_ZLIB = 0,
+	GIT_ZCODEC_ZSTD
+};
+
 typedef struct git_zstream {
 	z_stream z;
 	unsigned long avail_in;
@@ -26,8 +38,14 @@ typedef struct git_zstream {
 	unsigned long total_out;
 	unsigned char *next_in;
 	unsigned char *next_out;
+	enum git_zcodec codec;
+	void *zstd; /* ZSTD_DCtx or ZSTD_CCtx when codec is zstd */
+	int zstd_done;
 } git_zstream;
 
+/* Called once at startup, before any threads are spawned. */
+void git_zstream_start(void);
+
 void git_inflate_init(git_zstream *);
 void git_inflate_init_gzip_only(git_zstream *);
 void git_inflate_end(git_zstream *);
@@ -36,11 +54,21 @@ int git_inflate(git_zstream *, int flush);
 void git_deflate_init(git_zstream *, int level);
 void git_deflate_init_gzip(git_zstream *, int level);
 void git_deflate_init_raw(git_zstream *, int level);
+void git_deflate_init_codec(git_zstream *, int level, enum git_zcodec);
 void git_deflate_end(git_zstream *);
 int git_deflate_abort(git_zstream *);
 int git_deflate_end_gently(git_zstream *);
 int git_deflate(git_zstream *, int flush);
 unsigned long git_deflate_bound(git_zstream *, unsigned long);
+/*
+ * Promise the exact number of bytes that will be fed to the stream;
+ * zstd sizes its window (and records the size in the frame) from it.
+ */
+void git_deflate_set_size(git_zstream *, unsigned long size);
+
+enum git_zcodec git_zcodec_from_name(const char *name);
+/* Can this build of git write (and read) the given codec? */
+int git_zcodec_supported(enum git_zcodec);
 
 /* The length in bytes and in hex digits of an object name (SHA-1 value). */
 #define GIT_SHA1_RAWSZ 20
@@ -769,6 +797,13 @@ extern int remove_file_from_index(struct index_state *, const char *path);
  */
 extern int add_to_index(struct index_state *, const char *path, struct stat *, int flags);
 extern int add_file_to_index(struct index_state *, const char *path, int flags);
+/*
+ * Like add_to_index(), but the caller has already hashed (and written)
+ * the contents of the file, e.g. with parallel_checkin().
+ */
+extern int add_hashed_to_index(struct index_state *, const char *path,
+			       struct stat *, const struct object_id *oid,
+			       int flags);
 
 extern int chmod_index_entry(struct index_state *, struct cache_entry *ce, char flip);
 extern int ce_same_name(const struct cache_entry *a, const struct cache_entry *b);
@@ -824,6 +859,7 @@ extern void fill_stat_cache_info(struct cache_entry *ce, struct stat *st);
 #define REFRESH_IGNORE_SUBMODULES	0x0010	/* ignore submodules */
 #define REFRESH_IN_PORCELAIN	0x0020	/* user friendly output, not "needs update" */
 #define REFRESH_PROGRESS	0x0040  /* show progress bar if stderr is tty */
+#define REFRESH_VERIFY_CONTENT	0x0080	/* let preload_index() hash stat-dirty files */
 extern int refresh_index(struct index_state *, unsigned int flags, const struct pathspec *pathspec, char *seen, const char *header_msg);
 extern struct cache_entry *refresh_cache_entry(struct index_state *, struct cache_entry *, unsigned int);
 
@@ -860,6 +896,7 @@ extern int core_compression_level;
 extern int pack_compression_level;
 extern size_t packed_git_window_size;
 extern size_t packed_git_limit;
+extern int packed_git_map_whole;
 extern size_t delta_base_cache_limit;
 extern unsigned long big_file_threshold;
 extern unsigned long pack_size_limit_cfg;
@@ -883,7 +920,13 @@ void reset_shared_repository(void);
 extern int read_replace_refs;
 extern char *git_replace_ref_base;
 
-extern int fsync_object_files;
+enum fsync_object_files_mode {
+	FSYNC_OBJECT_FILES_OFF = 0,
+	FSYNC_OBJECT_FILES_ON,
+	FSYNC_OBJECT_FILES_BATCH
+};
+
+extern enum fsync_object_files_mode fsync_object_files;
 extern int core_preload_index;
 extern int core_apply_sparse_checkout;
 extern int precomposed_unicode;
@@ -945,6 +988,13 @@ enum object_creation_mode {
 
 extern enum object_creation_mode object_creation_mode;
 
+enum bulk_checkin_mode {
+	BULK_CHECKIN_LARGE = 0,
+	BULK_CHECKIN_ALWAYS
+};
+
+extern enum bulk_checkin_mode bulk_checkin_mode;
+
 extern char *notes_ref_name;
 
 extern int grafts_replace_parents;
@@ -960,12 +1010,14 @@ extern int repository_format_precious_objects;
 extern char *repository_format_partial_clone;
 extern const char *core_partial_clone_filter_default;
 extern int repository_format_worktree_config;
+extern enum git_zcodec repository_format_object_compression;
 
 struct repository_format {
 	int version;
 	int precious_objects;
 	char *partial_clone; /* value of extensions.partialclone */
 	int worktree_config;
+	enum git_zcodec object_compression;
 	int is_bare;
 	int hash_algo;
 	char *work_tree;
@@ -1570,6 +1622,12 @@ struct pack_window {
 	size_t len;
 	unsigned int last_used;
 	unsigned int inuse_cnt;
+	/* access pattern seen on a whole-pack mapping */
+	off_t last_offset;
+	unsigned int accesses;
+	unsigned int seeks;
+	int advice;
+	off_t readahead_end;
 };
 
 struct pack_entry {
@@ -21,6 +21,8 @@
 #define GRAPH_CHUNKID_OIDFANOUT 0x4f494446 /* "OIDF" */
 #define GRAPH_CHUNKID_OIDLOOKUP 0x4f49444c /* "OIDL" */
 #define GRAPH_CHUNKID_DATA 0x43444154 /* "CDAT" */
+#define GRAPH_CHUNKID_GENERATION_DATA 0x47444154 /* "GDAT" */
+#define GRAPH_CHUNKID_GENERATION_DATA_OVERFLOW 0x47444f56 /* "GDOV" */
 #define GRAPH_CHUNKID_LARGEEDGES 0x45444745 /* "EDGE" */
 
 #define GRAPH_DATA_WIDTH 36
@@ -40,6 +42,10 @@
 
 #define GRAPH_LAST_EDGE 0x80000000
 
+#define CORRECTED_COMMIT_DATE_OFFSET_OVERFLOW 0x80000000
+
+#define GENERATION_VERSION_DEFAULT 2
+
 #define GRAPH_HEADER_SIZE 8
 #define GRAPH_FANOUT_SIZE (4 * 256)
 #define GRAPH_CHUNKLOOKUP_WIDTH 12
@@ -145,9 +151,15 @@ struct commit_graph *load_commit_graph_one(const char *graph_file)
 	for (i = 0; i < graph->num_chunks; i++) {
 		uint32_t chunk_id = get_be32(chunk_lookup + 0);
 		uint64_t chunk_offset = get_be64(chunk_lookup + 4);
+		uint64_t next_chunk_offset;
 		int chunk_repeated = 0;
 
 		chunk_lookup += GRAPH_CHUNKLOOKUP_WIDTH;
+		/* the next label, or the terminating one, ends this chunk */
+		next_chunk_offset = get_be64(chunk_lookup + 4);
+		if (next_chunk_offset < chunk_offset ||
+		    next_chunk_offset > graph_size)
+			next_chunk_offset = chunk_offset;
 
 		if (chunk_offset > graph_size - GIT_MAX_RAWSZ) {
 			error(_("improper chunk offset %08x%08x"), (uint32_t)(chunk_offset >> 32),
@@ -177,6 +189,26 @@ struct commit_graph *load_commit_graph_one(const char *graph_file)
 				graph->chunk_commit_data = data + chunk_offset;
 			break;
 
+		case GRAPH_CHUNKID_GENERATION_DATA:
+			if (graph->chunk_generation_data)
+				chunk_repeated = 1;
+			else {
+				graph->chunk_generation_data = data + chunk_offset;
+				graph->num_generation_data =
+					(next_chunk_offset - chunk_offset) / sizeof(uint32_t);
+			}
+			break;
+
+		case GRAPH_CHUNKID_GENERATION_DATA_OVERFLOW:
+			if (graph->chunk_generation_data_overflow)
+				chunk_repeated = 1;
+			else {
+				graph->chunk_generation_data_overflow = data + chunk_offset;
+				graph->num_generation_data_overflows =
+					(next_chunk_offset - chunk_offset) / sizeof(uint64_t);
+			}
+			break;
+
 		case GRAPH_CHUNKID_LARGEEDGES:
 			if (graph->chunk_large_edges)
 				chunk_repeated = 1;
@@ -208,16 +240,60 @@ struct commit_graph *load_commit_graph_one(const char *graph_file)
 	exit(1);
 }
 
+static int generation_version(struct repository *r)
+{
+	int version;
+
+	if (repo_config_get_int(r, "commitgraph.generationversion", &version))
+		version = GENERATION_VERSION_DEFAULT;
+	return version;
+}
+
+/*
+ * Check that the generation data chunk covers every commit and that no
+ * offset points past the end of the overflow chunk, so that it is safe
+ * to read corrected commit dates.  An overflow offset in a graph without
+ * an overflow chunk is left to graph_corrected_date().
+ */
+static int generation_data_fits(struct commit_graph *g)
+{
+	uint32_t i;
+
+	if (g->num_generation_data != g->num_commits) {
+		warning(_("commit-graph generation data chunk is the wrong size"));
+		return 0;
+	}
+	if (!g->chunk_generation_data_overflow)
+		return 1;
+	for (i = 0; i < g->num_commits; i++) {
+		uint32_t offset = get_be32(g->chunk_generation_data +
+					   sizeof(uint32_t) * i);
+
+		if ((offset & CORRECTED_COMMIT_DATE_OFFSET_OVERFLOW) &&
+		    (offset & ~CORRECTED_COMMIT_DATE_OFFSET_OVERFLOW) >=
+		    g->num_generation_data_overflows) {
+			warning(_("commit-graph overflow generation data is too small"));
+			return 0;
+		}
+	}
+	return 1;
+}
+
 static void prepare_commit_graph_one(struct repository *r, const char *obj_dir)
 {
 	char *graph_name;
+	struct commit_graph *g;
 
 	if (r->objects->commit_graph)
 		return;
 
 	graph_name = get_commit_graph_filename(obj_dir);
-	r->objects->commit_graph =
-		load_commit_graph_one(graph_name);
+	g = load_commit_graph_one(graph_name);
+	if (g)
+		g->read_generation_data = g->chunk_generation_data &&
+					  generation_version(r) >= 2 &&
+					  generation_data_fits(g);
+	r->objects->commit_graph = g;
 
 	FREE_AND_NULL(graph_name);
 }
@@ -280,13 +356,55 @@ int generation_numbers_enabled(struct repository *r)
 	return !!first_generation;
 }
 
+static uint32_t graph_topo_level(struct commit_graph *g, uint32_t pos)
+{
+	const unsigned char *commit_data = g->chunk_commit_data + GRAPH_DATA_WIDTH * pos;
+	return get_be32(commit_data + g->hash_len + 8) >> 2;
+}
+
+static timestamp_t graph_commit_date(struct commit_graph *g, uint32_t pos)
+{
+	const unsigned char *commit_data = g->chunk_commit_data + GRAPH_DATA_WIDTH * pos;
+	uint64_t date_high, date_low;
+
+	date_high = get_be32(commit_data + g->hash_len + 8) & 0x3;
+	date_low = get_be32(commit_data + g->hash_len + 12);
+	return (timestamp_t)((date_high << 32) | date_low);
+}
+
+/*
+ * The corrected commit date is stored as an offset from the commit
+ * date; the few offsets that do not fit into 31 bits live in the
+ * overflow chunk.
+ */
+static timestamp_t graph_corrected_date(struct commit_graph *g, uint32_t pos)
+{
+	uint32_t offset = get_be32(g->chunk_generation_data + sizeof(uint32_t) * pos);
+
+	if (offset & CORRECTED_COMMIT_DATE_OFFSET_OVERFLOW) {
+		if (!g->chunk_generation_data_overflow)
+			die(_("commit-graph requires overflow generation data but has none"));
+		offset &= ~CORRECTED_COMMIT_DATE_OFFSET_OVERFLOW;
+		return graph_commit_date(g, pos) +
+			get_be64(g->chunk_generation_data_overflow + 8 * (uint64_t)offset);
+	}
+	return graph_commit_date(g, pos) + offset;
+}
+
+static timestamp_t graph_generation(struct commit_graph *g, uint32_t pos)
+{
+	if (g->read_generation_data)
+		return graph_corrected_date(g, pos);
+	return graph_topo_level(g, pos);
+}
+
 void close_commit_graph(struct repository *r)
 {
 	free_commit_graph(r->objects->commit_graph);
 	r->objects->commit_graph = NULL;
 }
 
-static int bsearch_graph(struct commit_graph *g, struct object_id *oid, uint32_t *pos)
+static int bsearch_graph(struct commit_graph *g, const struct object_id *oid, uint32_t *pos)
 {
 	return bsearch_hash(oid->hash, g->chunk_oid_fanout,
 			    g->chunk_oid_lookup, g->hash_len, pos);
@@ -312,16 +430,14 @@ static struct commit_list **insert_parent_or_die(struct commit_graph *g,
 
 static void fill_commit_graph_info(struct commit *item, struct commit_graph *g, uint32_t pos)
 {
-	const unsigned char *commit_data = g->chunk_commit_data + GRAPH_DATA_WIDTH * pos;
 	item->graph_pos = pos;
-	item->generation = get_be32(commit_data + g->hash_len + 8) >> 2;
+	item->generation = graph_generation(g, pos);
 }
 
 static int fill_commit_in_graph(struct commit *item, struct commit_graph *g, uint32_t pos)
 {
 	uint32_t edge_value;
 	uint32_t *parent_data_ptr;
-	uint64_t date_low, date_high;
 	struct commit_list **pptr;
 	const unsigned char *commit_data = g->chunk_commit_data + (g->hash_len + 16) * pos;
 
@@ -330,11 +446,8 @@ static int fill_commit_in_graph(struct commit *item, struct commit_graph *g, uin
 
 	item->maybe_tree = NULL;
 
-	date_high = get_be32(commit_data + g->hash_len + 8) & 0x3;
-	date_low = get_be32(commit_data + g->hash_len + 12);
-	item->date = (timestamp_t)((date_high << 32) | date_low);
-
-	item->generation = get_be32(commit_data + g->hash_len + 8) >> 2;
+	item->date = graph_commit_date(g, pos);
+	item->generation = graph_generation(g, pos);
 
 	pptr = &item->parents;
 
@@ -364,6 +477,176 @@ static int fill_commit_in_graph(struct commit *item, struct commit_graph *g, uin
 	return 1;
 }
 
+/*
+ * A walk over graph positions rather than "struct commit" objects: the
+ * parents and generation numbers are read straight from the chunks and
+ * the per-commit state is one byte in an array indexed by position, so
+ * nothing is allocated or looked up per commit.  Positions are visited
+ * in order of decreasing generation, so every commit is final by the
+ * time it is popped.
+ */
+#define GRAPH_WALK_INCLUDE	(1u<<0)
+#define GRAPH_WALK_EXCLUDE	(1u<<1)
+#define GRAPH_WALK_SEEN		(1u<<2)
+
+#define graph_walk_interesting(f) \
+	(((f) & (GRAPH_WALK_INCLUDE | GRAPH_WALK_EXCLUDE)) == GRAPH_WALK_INCLUDE)
+
+struct graph_walk_entry {
+	timestamp_t generation;
+	uint32_t pos;
+};
+
+struct graph_walk {
+	struct commit_graph *g;
+	unsigned char *flags;
+	struct graph_walk_entry *heap;
+	uint32_t nr, alloc;
+	/* number of queued positions that are still interesting */
+	uint32_t nr_interesting;
+};
+
+static void graph_walk_push(struct graph_walk *w, uint32_t pos, unsigned flag)
+{
+	unsigned char old = w->flags[pos];
+	uint32_t i;
+
+	w->flags[pos] |= flag | GRAPH_WALK_SEEN;
+	if (old & GRAPH_WALK_SEEN) {
+		/* already queued; it can only become uninteresting */
+		if (graph_walk_interesting(old) &&
+		    !graph_walk_interesting(w->flags[pos]))
+			w->nr_interesting--;
+		return;
+	}
+	if (graph_walk_interesting(w->flags[pos]))
+		w->nr_interesting++;
+
+	ALLOC_GROW(w->heap, w->nr + 1, w->alloc);
+	i = w->nr++;
+	w->heap[i].generation = graph_generation(w->g, pos);
+	w->heap[i].pos = pos;
+
+	while (i) {
+		uint32_t parent = (i - 1) / 2;
+		if (w->heap[parent].generation >= w->heap[i].generation)
+			break;
+		SWAP(w->heap[parent], w->heap[i]);
+		i = parent;
+	}
+}
+
+static uint32_t graph_walk_pop(struct graph_walk *w)
+{
+	uint32_t pos = w->heap[0].pos, i = 0;
+
+	w->heap[0] = w->heap[--w->nr];
+	for (;;) {
+		uint32_t largest = i, l = 2 * i + 1, r = l + 1;
+
+		if (l < w->nr && w->heap[l].generation > w->heap[largest].generation)
+			largest = l;
+		if (r < w->nr && w->heap[r].generation > w->heap[largest].generation)
+			largest = r;
+		if (largest == i)
+			break;
+		SWAP(w->heap[largest], w->heap[i]);
+		i = largest;
+	}
+	return pos;
+}
+
+static int graph_walk_push_parents(struct graph_walk *w, uint32_t pos,
+				   int first_parent_only)
+{
+	struct commit_graph *g = w->g;
+	const unsigned char *commit_data = g->chunk_commit_data + GRAPH_DATA_WIDTH * pos;
+	unsigned flag = w->flags[pos] & (GRAPH_WALK_INCLUDE | GRAPH_WALK_EXCLUDE);
+	uint32_t edge_value;
+	const unsigned char *parent_data_ptr;
+
+	edge_value = get_be32(commit_data + g->hash_len);
+	if (edge_value == GRAPH_PARENT_NONE)
+		return 0;
+	if (edge_value >= g->num_commits)
+		return -1;
+	graph_walk_push(w, edge_value, flag);
+	/*
+	 * Like the revision walk, follow all parents of an excluded
+	 * commit even then, so that it hides what it can reach.
+	 */
+	if (first_parent_only && !(flag & GRAPH_WALK_EXCLUDE))
+		return 0;
+
+	edge_value = get_be32(commit_data + g->hash_len + 4);
+	if (edge_value == GRAPH_PARENT_NONE)
+		return 0;
+	if (!(edge_value & GRAPH_OCTOPUS_EDGES_NEEDED)) {
+		if (edge_value >= g->num_commits)
+			return -1;
+		graph_walk_push(w, edge_value, flag);
+		return 0;
+	}
+
+	if (!g->chunk_large_edges)
+		return -1;
+	parent_data_ptr = g->chunk_large_edges +
+			  4 * (uint64_t)(edge_value & GRAPH_EDGE_LAST_MASK);
+	do {
+		edge_value = get_be32(parent_data_ptr);
+		if ((edge_value & GRAPH_EDGE_LAST_MASK) >= g->num_commits)
+			return -1;
+		graph_walk_push(w, edge_value & GRAPH_EDGE_LAST_MASK, flag);
+		parent_data_ptr += 4;
+	} while (!(edge_value & GRAPH_LAST_EDGE));
+	return 0;
+}
+
+int commit_graph_count_reachable(struct repository *r,
+				 const struct object_id *include, int nr_include,
+				 const struct object_id *exclude, int nr_exclude,
+				 int first_parent_only, uint32_t *count)
+{
+	struct graph_walk w = { NULL };
+	uint32_t pos;
+	int i, ret = 0;
+
+	if (!generation_numbers_enabled(r))
+		return -1;
+
+	w.g = r->objects->commit_graph;
+	for (i = 0; i < nr_include + nr_exclude; i++) {
+		const struct object_id *oid = i < nr_include ?
+			&include[i] : &exclude[i - nr_include];
+		if (!bsearch_graph(w.g, oid, &pos)) {
+			free(w.flags);
+			free(w.heap);
+			return -1;
+		}
+		if (!w.flags)
+			w.flags = xcalloc(w.g->num_commits, 1);
+		graph_walk_push(&w, pos, i < nr_include ?
+				GRAPH_WALK_INCLUDE : GRAPH_WALK_EXCLUDE);
+	}
+
+	*count = 0;
+	while (w.nr_interesting) {
+		pos = graph_walk_pop(&w);
+		if (graph_walk_interesting(w.flags[pos])) {
+			w.nr_interesting--;
+			(*count)++;
+		}
+		if (graph_walk_push_parents(&w, pos, first_parent_only)) {
+			ret = -1;
+			break;
+		}
+	}
+
+	free(w.flags);
+	free(w.heap);
+	return ret;
+}
+
 static int find_commit_in_graph(struct commit *item, struct commit_graph *g, uint32_t *pos)
 {
 	if (item->graph_pos != COMMIT_NOT_FROM_GRAPH) {
@@ -470,8 +753,12 @@ static const unsigned char *commit_to_sha1(size_t index, void *table)
 	return commits[index]->object.oid.hash;
 }
 
+define_commit_slab(topo_level_slab, uint32_t);
+define_commit_slab(generation_data_slab, timestamp_t);
+
 static void write_graph_chunk_data(struct hashfile *f, int hash_len,
-				   struct commit **commits, int nr_commits)
+				   struct commit **commits, int nr_commits,
+				   struct topo_level_slab *topo_levels)
 {
 	struct commit **list = commits;
 	struct commit **last = commits + nr_commits;
@@ -531,7 +818,7 @@ static void write_graph_chunk_data(struct hashfile *f, int hash_len,
 		else
 			packedDate[0] = 0;
 
-		packedDate[0] |= htonl((*list)->generation << 2);
+		packedDate[0] |= htonl(*topo_level_slab_at(topo_levels, *list) << 2);
 
 		packedDate[1] = htonl((*list)->date);
 		hashwrite(f, packedDate, 8);
@@ -540,6 +827,41 @@ static void write_graph_chunk_data(struct hashfile *f, int hash_len,
 	}
 }
 
+static void write_graph_chunk_generation_data(struct hashfile *f,
+					      struct commit **commits,
+					      int nr_commits,
+					      struct generation_data_slab *corrected_dates)
+{
+	int i, num_overflow = 0;
+
+	for (i = 0; i < nr_commits; i++) {
+		struct commit *c = commits[i];
+		timestamp_t offset = *generation_data_slab_at(corrected_dates, c) - c->date;
+
+		if (offset > GENERATION_NUMBER_V2_OFFSET_MAX)
+			offset = CORRECTED_COMMIT_DATE_OFFSET_OVERFLOW | num_overflow++;
+		hashwrite_be32(f, offset);
+	}
+}
+
+static void write_graph_chunk_generation_data_overflow(struct hashfile *f,
+						       struct commit **commits,
+						       int nr_commits,
+						       struct generation_data_slab *corrected_dates)
+{
+	int i;
+
+	for (i = 0; i < nr_commits; i++) {
+		struct commit *c = commits[i];
+		timestamp_t offset = *generation_data_slab_at(corrected_dates, c) - c->date;
+
+		if (offset > GENERATION_NUMBER_V2_OFFSET_MAX) {
+			hashwrite_be32(f, offset >> 32);
+			hashwrite_be32(f, (uint32_t)offset);
+		}
+	}
+}
+
 static void write_graph_chunk_large_edges(struct hashfile *f,
 					  struct commit **commits,
 					  int nr_commits)
@@ -679,7 +1001,18 @@ static void close_reachable(struct packed_oid_list *oids, int report_progress)
 	stop_progress(&progress);
 }
 
+/*
+ * Compute both kinds of generation numbers for all commits: the
+ * topological level that goes into the commit data chunk, and the
+ * corrected commit date (the commit date, bumped to one more than the
+ * corrected dates of the parents where necessary) that goes into the
+ * generation data chunk.  A zero topological level means "not computed
+ * yet"; we do not trust whatever an existing graph left in
+ * commit->generation, as it may be either kind.
+ */
 static void compute_generation_numbers(struct packed_commit_list* commits,
+				       struct topo_level_slab *topo_levels,
+				       struct generation_data_slab *corrected_dates,
 				       int report_progress)
 {
 	int i;
@@ -692,8 +1025,7 @@ static void compute_generation_numbers(struct packed_commit_list* commits,
 			commits->nr);
 	for (i = 0; i < commits->nr; i++) {
 		display_progress(progress, i + 1);
-		if (commits->list[i]->generation != GENERATION_NUMBER_INFINITY &&
-		    commits->list[i]->generation != GENERATION_NUMBER_ZERO)
+		if (*topo_level_slab_at(topo_levels, commits->list[i]))
 			continue;
 
 		commit_list_insert(commits->list[i], &list);
@@ -701,25 +1033,36 @@ static void compute_generation_numbers(struct packed_commit_list* commits,
 			struct commit *current = list->item;
 			struct commit_list *parent;
 			int all_parents_computed = 1;
-			uint32_t max_generation = 0;
+			uint32_t max_level = 0;
+			timestamp_t max_corrected_date = 0;
 
 			for (parent = current->parents; parent; parent = parent->next) {
-				if (parent->item->generation == GENERATION_NUMBER_INFINITY ||
-				    parent->item->generation == GENERATION_NUMBER_ZERO) {
+				uint32_t level = *topo_level_slab_at(topo_levels, parent->item);
+				timestamp_t corrected_date;
+
+				if (!level) {
 					all_parents_computed = 0;
 					commit_list_insert(parent->item, &list);
 					break;
-				} else if (parent->item->generation > max_generation) {
-					max_generation = parent->item->generation;
 				}
+				if (level > max_level)
+					max_level = level;
+				corrected_date = *generation_data_slab_at(corrected_dates, parent->item);
+				if (corrected_date > max_corrected_date)
+					max_corrected_date = corrected_date;
 			}
 
 			if (all_parents_computed) {
-				current->generation = max_generation + 1;
 				pop_commit(&list);
 
-				if (current->generation > GENERATION_NUMBER_MAX)
-					current->generation = GENERATION_NUMBER_MAX;
+				if (max_level >= GENERATION_NUMBER_V1_MAX)
+					max_level = GENERATION_NUMBER_V1_MAX - 1;
+				*topo_level_slab_at(topo_levels, current) = max_level + 1;
+
+				if (current->date > max_corrected_date)
+					max_corrected_date = current->date - 1;
+				*generation_data_slab_at(corrected_dates, current) =
+					max_corrected_date + 1;
 			}
 		}
 	}
@@ -758,12 +1101,17 @@ void write_commit_graph(const char *obj_dir,
 	uint32_t i, count_distinct = 0;
 	char *graph_name;
 	struct lock_file lk = LOCK_INIT;
-	uint32_t chunk_ids[5];
-	uint64_t chunk_offsets[5];
+	uint32_t chunk_ids[7];
+	uint64_t chunk_sizes[6];
+	uint64_t chunk_offsets[7];
 	int num_chunks;
 	int num_extra_edges;
+	int write_generation_data;
+	int num_generation_data_overflow = 0;
 	struct commit_list *parent;
 	struct progress *progress = NULL;
+	struct topo_level_slab topo_levels;
+	struct generation_data_slab corrected_dates;
 
 	if (!commit_graph_compatible(the_repository))
 		return;
@@ -889,12 +1237,49 @@ void write_commit_graph(const char *obj_dir,
 
 		commits.nr++;
 	}
-	num_chunks = num_extra_edges ? 4 : 3;
 
 	if (commits.nr >= GRAPH_PARENT_MISSING)
 		die(_("too many commits to write graph"));
 
-	compute_generation_numbers(&commits, report_progress);
+	init_topo_level_slab(&topo_levels);
+	init_generation_data_slab(&corrected_dates);
+	compute_generation_numbers(&commits, &topo_levels, &corrected_dates,
+				   report_progress);
+
+	write_generation_data = generation_version(the_repository) >= 2;
+	if (write_generation_data) {
+		for (i = 0; i < commits.nr; i++) {
+			struct commit *c = commits.list[i];
+			if (*generation_data_slab_at(&corrected_dates, c) - c->date >
+			    GENERATION_NUMBER_V2_OFFSET_MAX)
+				num_generation_data_overflow++;
+		}
+	}
+
+	num_chunks = 0;
+	chunk_ids[num_chunks] = GRAPH_CHUNKID_OIDFANOUT;
+	chunk_sizes[num_chunks++] = GRAPH_FANOUT_SIZE;
+	chunk_ids[num_chunks] = GRAPH_CHUNKID_OIDLOOKUP;
+	chunk_sizes[num_chunks++] = GRAPH_OID_LEN * commits.nr;
+	chunk_ids[num_chunks] = GRAPH_CHUNKID_DATA;
+	chunk_sizes[num_chunks++] = (GRAPH_OID_LEN + 16) * commits.nr;
+	if (write_generation_data) {
+		chunk_ids[num_chunks] = GRAPH_CHUNKID_GENERATION_DATA;
+		chunk_sizes[num_chunks++] = sizeof(uint32_t) * commits.nr;
+	}
+	if (num_generation_data_overflow) {
+		chunk_ids[num_chunks] = GRAPH_CHUNKID_GENERATION_DATA_OVERFLOW;
+		chunk_sizes[num_chunks++] = sizeof(uint64_t) * num_generation_data_overflow;
+	}
+	if (num_extra_edges) {
+		chunk_ids[num_chunks] = GRAPH_CHUNKID_LARGEEDGES;
+		chunk_sizes[num_chunks++] = 4 * num_extra_edges;
+	}
+	chunk_ids[num_chunks] = 0;
+
+	chunk_offsets[0] = 8 + (num_chunks + 1) * GRAPH_CHUNKLOOKUP_WIDTH;
+	for (i = 0; i < num_chunks; i++)
+		chunk_offsets[i + 1] = chunk_offsets[i] + chunk_sizes[i];
 
 	graph_name = get_commit_graph_filename(obj_dir);
 	if (safe_create_leading_directories(graph_name)) {
@@ -913,21 +1298,6 @@ void write_commit_graph(const char *obj_dir,
 	hashwrite_u8(f, num_chunks);
 	hashwrite_u8(f, 0); /* unused padding byte */
 
-	chunk_ids[0] = GRAPH_CHUNKID_OIDFANOUT;
-	chunk_ids[1] = GRAPH_CHUNKID_OIDLOOKUP;
-	chunk_ids[2] = GRAPH_CHUNKID_DATA;
-	if (num_extra_edges)
-		chunk_ids[3] = GRAPH_CHUNKID_LARGEEDGES;
-	else
-		chunk_ids[3] = 0;
-	chunk_ids[4] = 0;
-
-	chunk_offsets[0] = 8 + (num_chunks + 1) * GRAPH_CHUNKLOOKUP_WIDTH;
-	chunk_offsets[1] = chunk_offsets[0] + GRAPH_FANOUT_SIZE;
-	chunk_offsets[2] = chunk_offsets[1] + GRAPH_OID_LEN * commits.nr;
-	chunk_offsets[3] = chunk_offsets[2] + (GRAPH_OID_LEN + 16) * commits.nr;
-	chunk_offsets[4] = chunk_offsets[3] + 4 * num_extra_edges;
-
 	for (i = 0; i <= num_chunks; i++) {
 		uint32_t chunk_write[3];
 
@@ -939,7 +1309,15 @@ void write_commit_graph(const char *obj_dir,
 
 	write_graph_chunk_fanout(f, commits.list, commits.nr);
 	write_graph_chunk_oids(f, GRAPH_OID_LEN, commits.list, commits.nr);
-	write_graph_chunk_data(f, GRAPH_OID_LEN, commits.list, commits.nr);
+	write_graph_chunk_data(f, GRAPH_OID_LEN, commits.list, commits.nr,
+			       &topo_levels);
+	if (write_generation_data)
+		write_graph_chunk_generation_data(f, commits.list, commits.nr,
+						  &corrected_dates);
+	if (num_generation_data_overflow)
+		write_graph_chunk_generation_data_overflow(f, commits.list,
+							   commits.nr,
+							   &corrected_dates);
 	write_graph_chunk_large_edges(f, commits.list, commits.nr);
 
 	close_commit_graph(the_repository);
@@ -949,6 +1327,8 @@ void write_commit_graph(const char *obj_dir,
 	free(graph_name);
 	free(commits.list);
 	free(oids.list);
+	clear_topo_level_slab(&topo_levels);
+	clear_generation_data_slab(&corrected_dates);
 }
 
 #define VERIFY_COMMIT_GRAPH_ERROR_HASH 2
@@ -990,6 +1370,10 @@ int verify_commit_graph(struct repository *r, struct commit_graph *g)
 		graph_report("commit-graph is missing the OID Lookup chunk");
 	if (!g->chunk_commit_data)
 		graph_report("commit-graph is missing the Commit Data chunk");
+	if (g->chunk_generation_data_overflow && !g->chunk_generation_data)
+		graph_report("commit-graph has a Generation Data Overflow chunk but no Generation Data chunk");
+	if (g->chunk_generation_data && !generation_data_fits(g))
+		graph_report("commit-graph has corrupt generation data");
 
 	if (verify_commit_graph_error)
 		return verify_commit_graph_error;
@@ -1048,7 +1432,8 @@ int verify_commit_graph(struct repository *r, struct commit_graph *g)
 	for (i = 0; i < g->num_commits; i++) {
 		struct commit *graph_commit, *odb_commit;
 		struct commit_list *graph_parents, *odb_parents;
-		uint32_t max_generation = 0;
+		uint32_t generation, max_generation = 0;
+		timestamp_t max_corrected_date = 0;
 
 		display_progress(progress, i + 1);
 		hashcpy(cur_oid.hash, g->chunk_oid_lookup + g->hash_len * i);
@@ -1084,8 +1469,15 @@ int verify_commit_graph(struct repository *r, struct commit_graph *g)
 					     oid_to_hex(&graph_parents->item->object.oid),
 					     oid_to_hex(&odb_parents->item->object.oid));
 
-			if (graph_parents->item->generation > max_generation)
-				max_generation = graph_parents->item->generation;
+			generation = graph_topo_level(g, graph_parents->item->graph_pos);
+			if (generation > max_generation)
+				max_generation = generation;
+			if (g->chunk_generation_data) {
+				timestamp_t corrected_date =
+					graph_corrected_date(g, graph_parents->item->graph_pos);
+				if (corrected_date > max_corrected_date)
+					max_corrected_date = corrected_date;
+			}
 
 			graph_parents = graph_parents->next;
 			odb_parents = odb_parents->next;
@@ -1095,7 +1487,26 @@ int verify_commit_graph(struct repository *r, struct commit_graph *g)
 			graph_report("commit-graph parent list for commit %s terminates early",
 				     oid_to_hex(&cur_oid));
 
-		if (!graph_commit->generation) {
+		if (graph_commit->date != odb_commit->date)
+			graph_report("commit date for commit %s in commit-graph is %"PRItime" != %"PRItime,
+				     oid_to_hex(&cur_oid),
+				     graph_commit->date,
+				     odb_commit->date);
+
+		if (g->chunk_generation_data) {
+			timestamp_t corrected_date = graph_corrected_date(g, i);
+
+			if (odb_commit->date > max_corrected_date)
+				max_corrected_date = odb_commit->date - 1;
+			if (corrected_date != max_corrected_date + 1)
+				graph_report("commit-graph corrected commit date for commit %s is %"PRItime" != %"PRItime,
+					     oid_to_hex(&cur_oid),
+					     corrected_date,
+					     max_corrected_date + 1);
+		}
+
+		generation = graph_topo_level(g, i);
+		if (!generation) {
 			if (generation_zero == GENERATION_NUMBER_EXISTS)
 				graph_report("commit-graph has generation number zero for commit %s, but non-zero elsewhere",
 					     oid_to_hex(&cur_oid));
@@ -1108,24 +1519,18 @@ int verify_commit_graph(struct repository *r, struct commit_graph *g)
 			continue;
 
 		/*
-		 * If one of our parents has generation GENERATION_NUMBER_MAX, then
-		 * our generation is also GENERATION_NUMBER_MAX. Decrement to avoid
-		 * extra logic in the following condition.
+		 * If one of our parents has generation GENERATION_NUMBER_V1_MAX,
+		 * then our generation is also GENERATION_NUMBER_V1_MAX. Decrement
+		 * to avoid extra logic in the following condition.
 		 */
-		if (max_generation == GENERATION_NUMBER_MAX)
+		if (max_generation == GENERATION_NUMBER_V1_MAX)
 			max_generation--;
 
-		if (graph_commit->generation != max_generation + 1)
+		if (generation != max_generation + 1)
 			graph_report("commit-graph generation for commit %s is %u != %u",
 				     oid_to_hex(&cur_oid),
-				     graph_commit->generation,
+				     generation,
 				     max_generation + 1);
-
-		if (graph_commit->date != odb_commit->date)
-			graph_report("commit date for commit %s in commit-graph is %"PRItime" != %"PRItime,
-				     oid_to_hex(&cur_oid),
-				     graph_commit->date,
-				     odb_commit->date);
 	}
 	stop_progress(&progress);
 
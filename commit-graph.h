@@ -44,12 +44,19 @@ struct commit_graph {
 	unsigned char hash_len;
 	unsigned char num_chunks;
 	uint32_t num_commits;
+	uint32_t num_generation_data;
+	uint64_t num_generation_data_overflows;
 	struct object_id oid;
 
 	const uint32_t *chunk_oid_fanout;
 	const unsigned char *chunk_oid_lookup;
 	const unsigned char *chunk_commit_data;
+	const unsigned char *chunk_generation_data;
+	const unsigned char *chunk_generation_data_overflow;
 	const unsigned char *chunk_large_edges;
+
+	/* use the corrected commit dates as generation numbers */
+	int read_generation_data;
 };
 
 struct commit_graph *load_commit_graph_one(const char *graph_file);
@@ -60,6 +67,19 @@ struct commit_graph *load_commit_graph_one(const char *graph_file);
  */
 int generation_numbers_enabled(struct repository *r);
 
+/*
+ * Count the commits that are reachable from one of the "nr_include"
+ * commits in "include" but from none of the "nr_exclude" commits in
+ * "exclude", following only first parents of the former if
+ * "first_parent_only" is set. The walk works on graph positions and never creates commit
+ * objects. Returns -1 if the commit-graph cannot answer the question,
+ * e.g. because one of the commits is not in it.
+ */
+int commit_graph_count_reachable(struct repository *r,
+				 const struct object_id *include, int nr_include,
+				 const struct object_id *exclude, int nr_exclude,
+				 int first_parent_only, uint32_t *count);
+
 void write_commit_graph_reachable(const char *obj_dir, int append,
 				  int report_progress);
 void write_commit_graph(const char *obj_dir,
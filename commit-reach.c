@@ -32,12 +32,12 @@ static int queue_has_nonstale(struct prio_queue *queue)
 /* all input commits in one and twos[] must have been parsed! */
 static struct commit_list *paint_down_to_common(struct commit *one, int n,
 						struct commit **twos,
-						int min_generation)
+						timestamp_t min_generation)
 {
 	struct prio_queue queue = { compare_commits_by_gen_then_commit_date };
 	struct commit_list *result = NULL;
 	int i;
-	uint32_t last_gen = GENERATION_NUMBER_INFINITY;
+	timestamp_t last_gen = GENERATION_NUMBER_INFINITY;
 
 	if (!min_generation)
 		queue.compare = compare_commits_by_commit_date;
@@ -60,7 +60,7 @@ static struct commit_list *paint_down_to_common(struct commit *one, int n,
 		int flags;
 
 		if (min_generation && commit->generation > last_gen)
-			BUG("bad generation skip %8x > %8x at %s",
+			BUG("bad generation skip %"PRItime" > %"PRItime" at %s",
 			    commit->generation, last_gen,
 			    oid_to_hex(&commit->object.oid));
 		last_gen = commit->generation;
@@ -174,7 +174,7 @@ static int remove_redundant(struct commit **array, int cnt)
 		parse_commit(array[i]);
 	for (i = 0; i < cnt; i++) {
 		struct commit_list *common;
-		uint32_t min_generation = array[i]->generation;
+		timestamp_t min_generation = array[i]->generation;
 
 		if (redundant[i])
 			continue;
@@ -308,7 +308,7 @@ int in_merge_bases_many(struct commit *commit, int nr_reference, struct commit *
 {
 	struct commit_list *bases;
 	int ret = 0, i;
-	uint32_t min_generation = GENERATION_NUMBER_INFINITY;
+	timestamp_t min_generation = GENERATION_NUMBER_INFINITY;
 
 	if (parse_commit(commit))
 		return ret;
@@ -438,7 +438,7 @@ static int in_commit_list(const struct commit_list *want, struct commit *c)
 static enum contains_result contains_test(struct commit *candidate,
 					  const struct commit_list *want,
 					  struct contains_cache *cache,
-					  uint32_t cutoff)
+					  timestamp_t cutoff)
 {
 	enum contains_result *cached = contains_cache_at(cache, candidate);
 
@@ -474,7 +474,7 @@ static enum contains_result contains_tag_algo(struct commit *candidate,
 {
 	struct contains_stack contains_stack = { 0, 0, NULL };
 	enum contains_result result;
-	uint32_t cutoff = GENERATION_NUMBER_INFINITY;
+	timestamp_t cutoff = GENERATION_NUMBER_INFINITY;
 	const struct commit_list *p;
 
 	for (p = want; p; p = p->next) {
@@ -527,6 +527,34 @@ int commit_contains(struct ref_filter *filter, struct commit *commit,
 	return is_descendant_of(commit, list);
 }
 
+void commit_contains_many(struct ref_filter *filter,
+			  struct commit **commits, int nr,
+			  struct commit_list *list, char *result)
+{
+	struct contains_cache cache;
+	int i, use_tag_algo = filter->with_commit_tag_algo;
+
+	/*
+	 * With generation numbers, the memoizing walk of the tag algorithm
+	 * stops at the generation of the commits we look for, and since
+	 * all candidates share its cache, no commit is visited twice
+	 * however many candidates there are.  Asking is_descendant_of()
+	 * about each candidate in turn would walk the common history once
+	 * per candidate.
+	 */
+	if (generation_numbers_enabled(the_repository))
+		use_tag_algo = 1;
+
+	init_contains_cache(&cache);
+	for (i = 0; i < nr; i++) {
+		if (use_tag_algo)
+			result[i] = contains_tag_algo(commits[i], list, &cache) == CONTAINS_YES;
+		else
+			result[i] = is_descendant_of(commits[i], list);
+	}
+	clear_contains_cache(&cache);
+}
+
 static int compare_commits_by_gen(const void *_a, const void *_b)
 {
 	const struct commit *a = *(const struct commit * const *)_a;
@@ -543,7 +571,7 @@ int can_all_from_reach_with_flag(struct object_array *from,
 				 unsigned int with_flag,
 				 unsigned int assign_flag,
 				 time_t min_commit_date,
-				 uint32_t min_generation)
+				 timestamp_t min_generation)
 {
 	struct commit **list = NULL;
 	int i;
@@ -644,7 +672,7 @@ int can_all_from_reach(struct commit_list *from, struct commit_list *to,
 	time_t min_commit_date = cutoff_by_min_date ? from->item->date : 0;
 	struct commit_list *from_iter = from, *to_iter = to;
 	int result;
-	uint32_t min_generation = GENERATION_NUMBER_INFINITY;
+	timestamp_t min_generation = GENERATION_NUMBER_INFINITY;
 
 	while (from_iter) {
 		add_object_array(&from_iter->item->object, NULL, &from_objs);
@@ -700,7 +728,7 @@ struct commit_list *get_reachable_subset(struct commit **from, int nr_from,
 	struct commit_list *found_commits = NULL;
 	struct commit **to_last = to + nr_to;
 	struct commit **from_last = from + nr_from;
-	uint32_t min_generation = GENERATION_NUMBER_INFINITY;
+	timestamp_t min_generation = GENERATION_NUMBER_INFINITY;
 	int num_to_find = 0;
 
 	struct prio_queue queue = { compare_commits_by_gen_then_commit_date };
@@ -60,6 +60,16 @@ define_commit_slab(contains_cache, enum contains_result);
 int commit_contains(struct ref_filter *filter, struct commit *commit,
 		    struct commit_list *list, struct contains_cache *cache);
 
+/*
+ * Batched version of commit_contains(): set result[i] to 1 if any of
+ * the commits in 'list' is reachable from commits[i], and to 0
+ * otherwise. This is much cheaper than calling commit_contains() for
+ * each commit when there are many of them.
+ */
+void commit_contains_many(struct ref_filter *filter,
+			  struct commit **commits, int nr,
+			  struct commit_list *list, char *result);
+
 /*
  * Determine if every commit in 'from' can reach at least one commit
  * that is marked with 'with_flag'. As we traverse, use 'assign_flag'
@@ -71,7 +81,7 @@ int can_all_from_reach_with_flag(struct object_array *from,
 				 unsigned int with_flag,
 				 unsigned int assign_flag,
 				 time_t min_commit_date,
-				 uint32_t min_generation);
+				 timestamp_t min_generation);
 int can_all_from_reach(struct commit_list *from, struct commit_list *to,
 		       int commit_date_cutoff);
 
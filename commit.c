@@ -355,8 +355,8 @@ struct object_id *get_commit_tree_oid(const struct commit *commit)
 void release_commit_memory(struct commit *c)
 {
 	c->maybe_tree = NULL;
-	c->index = 0;
 	free_commit_buffer(c);
+	c->index = 0;
 	free_commit_list(c->parents);
 	/* TODO: what about commit->util? */
 
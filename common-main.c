@@ -40,6 +40,8 @@ int main(int argc, const char **argv)
 
 	attr_start();
 
+	git_zstream_start();
+
 	restore_sigpipe_to_default();
 
 	return cmd_main(argc, argv);
@@ -3171,7 +3171,7 @@ int wmain(int argc, const wchar_t **wargv)
 
 	maybe_redirect_std_handles();
 	adjust_symlink_flags();
-	fsync_object_files = 1;
+	fsync_object_files = FSYNC_OBJECT_FILES_ON;
 
 	/* determine size of argv and environ conversion buffer */
 	maxlen = wcslen(wargv[0]);
@@ -0,0 +1,26 @@
+#ifndef COMPAT_SHA1_HW_H
+#define COMPAT_SHA1_HW_H
+
+/*
+ * SHA-1 compression with the CPU's SHA instructions, for the
+ * collision-detecting SHA-1 to use on blocks that cannot be part of a
+ * known collision attack.  Whether the instructions exist is only
+ * known at runtime; check sha1_hw_available() before calling
+ * sha1_hw_compress().
+ */
+#if !defined(NO_SHA1_HW) && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define HAVE_SHA1_HW 1
+
+int sha1_hw_available(void);
+
+/* Feed "nblocks" 64-byte blocks through the compression function. */
+void sha1_hw_compress(uint32_t ihv[5], const unsigned char *data,
+		      size_t nblocks);
+
+/* Compute W[32] to W[67] of a block's message schedule. */
+void sha1_hw_expand(const unsigned char *block, uint32_t W[80]);
+#endif
+
+#endif /* COMPAT_SHA1_HW_H */
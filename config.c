@@ -1214,6 +1214,7 @@ static int git_default_core_config(const char *var, const char *value, void *cb)
 		if (packed_git_window_size < 1)
 			packed_git_window_size = 1;
 		packed_git_window_size *= pgsz_x2;
+		packed_git_map_whole = 0;
 		return 0;
 	}
 
@@ -1224,6 +1225,7 @@ static int git_default_core_config(const char *var, const char *value, void *cb)
 
 	if (!strcmp(var, "core.packedgitlimit")) {
 		packed_git_limit = git_config_ulong(var, value);
+		packed_git_map_whole = 0;
 		return 0;
 	}
 
@@ -1305,7 +1307,12 @@ static int git_default_core_config(const char *var, const char *value, void *cb)
 	}
 
 	if (!strcmp(var, "core.fsyncobjectfiles")) {
-		fsync_object_files = git_config_bool(var, value);
+		if (value && !strcmp(value, "batch"))
+			fsync_object_files = FSYNC_OBJECT_FILES_BATCH;
+		else if (git_config_bool(var, value))
+			fsync_object_files = FSYNC_OBJECT_FILES_ON;
+		else
+			fsync_object_files = FSYNC_OBJECT_FILES_OFF;
 		return 0;
 	}
 
@@ -1324,6 +1331,18 @@ static int git_default_core_config(const char *var, const char *value, void *cb)
 		return 0;
 	}
 
+	if (!strcmp(var, "core.bulkcheckin")) {
+		if (!value)
+			return config_error_nonbool(var);
+		if (!strcmp(value, "large"))
+			bulk_checkin_mode = BULK_CHECKIN_LARGE;
+		else if (!strcmp(value, "always"))
+			bulk_checkin_mode = BULK_CHECKIN_ALWAYS;
+		else
+			die(_("invalid mode for bulk checkin: %s"), value);
+		return 0;
+	}
+
 	if (!strcmp(var, "core.sparsecheckout")) {
 		core_apply_sparse_checkout = git_config_bool(var, value);
 		return 0;
@@ -2322,6 +2341,27 @@ int git_config_get_index_threads(int *dest)
 	return 1;
 }
 
+int git_config_get_checkin_threads(int *dest)
+{
+	int is_bool, val;
+
+	val = git_env_ulong("GIT_TEST_CHECKIN_THREADS", 0);
+	if (val) {
+		*dest = val;
+		return 0;
+	}
+
+	if (!git_config_get_bool_or_int("core.checkinthreads", &is_bool, &val)) {
+		if (is_bool)
+			*dest = val ? 0 : 1;
+		else
+			*dest = val;
+		return 0;
+	}
+
+	return 1;
+}
+
 NORETURN
 void git_die_config_linenr(const char *key, const char *filename, int linenr)
 {
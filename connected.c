@@ -4,6 +4,181 @@
 #include "connected.h"
 #include "transport.h"
 #include "packfile.h"
+#include "object-store.h"
+#include "config.h"
+#include "object.h"
+#include "commit.h"
+#include "tag.h"
+#include "revision.h"
+#include "list-objects.h"
+#include "progress.h"
+#include "dir.h"
+
+/*
+ * The saved rev-list flags of the objects that existed before an
+ * in-process check, so that the walk neither is confused by what our
+ * caller marked, nor leaves its own marks behind.
+ */
+struct saved_flags {
+	struct object *obj;
+	unsigned int flags;
+};
+
+struct connected_data {
+	struct progress *progress;
+	uint64_t nr;
+	int missing;
+};
+
+static void check_connected_commit(struct commit *commit, void *cb_data)
+{
+	struct connected_data *data = cb_data;
+
+	display_progress(data->progress, ++data->nr);
+	free_commit_buffer(commit);
+}
+
+static void check_connected_object(struct object *obj, const char *name,
+				   void *cb_data)
+{
+	struct connected_data *data = cb_data;
+
+	display_progress(data->progress, ++data->nr);
+	if (obj->parsed || has_object_file(&obj->oid))
+		return;
+	error(_("missing %s object '%s'"),
+	      type_name(obj->type), oid_to_hex(&obj->oid));
+	data->missing++;
+}
+
+static void quiet_routine(const char *msg, va_list params)
+{
+}
+
+/*
+ * Do what "rev-list --objects --stdin --not --all" would do for us
+ * (see below), but in this process.  Unlike rev-list, a missing object
+ * is reported and makes us return non-zero instead of dying.
+ */
+static int check_connected_in_process(oid_iterate_fn fn, void *cb_data,
+				      const struct object_id *first,
+				      struct packed_git *new_pack,
+				      struct check_connected_options *opt)
+{
+	const char *argv[] = { "rev-list", "--not", "--all", NULL };
+	struct connected_data data = { NULL };
+	struct parsed_object_pool *pool = the_repository->parsed_objects;
+	void (*saved_error)(const char *, va_list) = get_error_routine();
+	void (*saved_warn)(const char *, va_list) = get_warn_routine();
+	int saved_fetch_if_missing = fetch_if_missing;
+	int saved_stderr = -1, own_scope = 0;
+	struct saved_flags *saved = NULL;
+	size_t saved_nr = 0, saved_alloc = 0, i;
+	unsigned int max = get_max_object_index();
+	struct object_id oid;
+	struct rev_info revs;
+	int err = 0;
+
+	if (opt->err_fd) {
+		saved_stderr = dup(2);
+		if (saved_stderr < 0 || dup2(opt->err_fd, 2) < 0)
+			return error_errno(_("unable to redirect errors"));
+	}
+	if (opt->quiet) {
+		set_error_routine(quiet_routine);
+		set_warn_routine(quiet_routine);
+	}
+
+	for (i = 0; i < max; i++) {
+		struct object *obj = get_indexed_object(i);
+
+		if (!obj || !(obj->flags & ALL_REV_FLAGS))
+			continue;
+		ALLOC_GROW(saved, saved_nr + 1, saved_alloc);
+		saved[saved_nr].obj = obj;
+		saved[saved_nr++].flags = obj->flags & ALL_REV_FLAGS;
+		obj->flags &= ~ALL_REV_FLAGS;
+	}
+	/*
+	 * Everything the walk parses is only referenced from revs, which
+	 * goes away with us, so it can all be dropped once we are done.
+	 */
+	if (!pool->scope_pool) {
+		begin_object_scope(the_repository);
+		own_scope = 1;
+	}
+
+	repo_init_revisions(the_repository, &revs, NULL);
+	revs.tag_objects = revs.tree_objects = revs.blob_objects = 1;
+	revs.do_not_die_on_missing_tree = 1;
+	revs.do_not_die_on_missing_parents = 1;
+	if (repository_format_partial_clone) {
+		fetch_if_missing = 0;
+		revs.exclude_promisor_objects = 1;
+	}
+
+	oidcpy(&oid, first);
+	do {
+		struct object *obj;
+
+		if (new_pack && find_pack_entry_one(oid.hash, new_pack))
+			continue;
+
+		obj = parse_object(the_repository, &oid);
+		if (obj && obj->type == OBJ_TAG &&
+		    !deref_tag(the_repository, obj, NULL, 0))
+			obj = NULL;
+		if (!obj) {
+			if (revs.exclude_promisor_objects &&
+			    is_promisor_object(&oid))
+				continue;
+			error(_("bad object %s"), oid_to_hex(&oid));
+			err = -1;
+			break;
+		}
+		add_pending_object(&revs, obj, "");
+	} while (!fn(cb_data, &oid));
+
+	if (!err && revs.pending.nr) {
+		/*
+		 * A ref that points to a missing object only makes us walk
+		 * further, so do not die on it like rev-list would.
+		 */
+		revs.ignore_missing = 1;
+		setup_revisions(opt->is_deepening_fetch ? 1 : ARRAY_SIZE(argv) - 1,
+				argv, &revs, NULL);
+
+		if (opt->progress)
+			data.progress = start_delayed_progress(
+				_("Checking connectivity"), 0);
+		if (prepare_revision_walk(&revs))
+			err = error(_("revision walk setup failed"));
+		else
+			traverse_commit_list(&revs, check_connected_commit,
+					     check_connected_object, &data);
+		stop_progress(&data.progress);
+		if (data.missing || revs.missing_parents)
+			err = -1;
+	}
+
+	if (own_scope)
+		end_object_scope(the_repository);
+	clear_object_flags(ALL_REV_FLAGS);
+	for (i = 0; i < saved_nr; i++)
+		saved[i].obj->flags |= saved[i].flags;
+	free(saved);
+
+	fetch_if_missing = saved_fetch_if_missing;
+	set_error_routine(saved_error);
+	set_warn_routine(saved_warn);
+	if (saved_stderr >= 0) {
+		dup2(saved_stderr, 2);
+		close(saved_stderr);
+	}
+	if (opt->err_fd)
+		close(opt->err_fd);
+	return err;
+}
 
 /*
  * If we feed all the commits we want to verify to this command
@@ -14,6 +189,10 @@
  * these commits locally exists and is connected to our existing refs.
  * Note that this does _not_ validate the individual objects.
  *
+ * Unless rev-list would see a different repository than we do (a
+ * shallow one, or one with objects that only its environment makes
+ * visible), we do the same walk in-process.
+ *
  * Returns 0 if everything is connected, non-zero otherwise.
  */
 int check_connected(oid_iterate_fn fn, void *cb_data,
@@ -49,6 +228,19 @@ int check_connected(oid_iterate_fn fn, void *cb_data,
 		strbuf_release(&idx_file);
 	}
 
+	/*
+	 * In a shallow repository (including one that "fetch
+	 * --update-shallow" has just made shallow), commits we parsed
+	 * earlier may predate the grafts for the shallow boundary, so
+	 * leave that case to a fresh rev-list.
+	 */
+	if (!opt->shallow_file && (!opt->env || opt->env_objects_visible) &&
+	    !is_repository_shallow(the_repository) &&
+	    !file_exists(git_path_shallow(the_repository)) &&
+	    git_env_bool("GIT_TEST_CHECK_CONNECTED_IN_PROCESS", 1))
+		return check_connected_in_process(fn, cb_data, &oid,
+						  new_pack, opt);
+
 	if (opt->shallow_file) {
 		argv_array_push(&rev_list.args, "--shallow-file");
 		argv_array_push(&rev_list.args, opt->shallow_file);
@@ -46,6 +46,14 @@ struct check_connected_options {
 	 * during a fetch.
 	 */
 	unsigned is_deepening_fetch : 1;
+
+	/*
+	 * Set if the objects that "env" makes visible to the rev-list
+	 * child are visible to us, too (e.g. because a quarantine
+	 * directory has been added as an alternate), so that the check
+	 * can be done without spawning rev-list.
+	 */
+	unsigned env_objects_visible : 1;
 };
 
 #define CHECK_CONNECTED_INIT { 0 }
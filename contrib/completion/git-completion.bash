@@ -1433,7 +1433,7 @@ _git_describe ()
 	__git_complete_refs
 }
 
-__git_diff_algorithms="myers minimal patience histogram"
+__git_diff_algorithms="myers minimal patience histogram bounded"
 
 __git_diff_submodule_formats="diff log short"
 
@@ -50,6 +50,7 @@ static int diff_stat_graph_width;
 static int diff_dirstat_permille_default = 30;
 static struct diff_options default_diff_options;
 static long diff_algorithm;
+static long diff_max_cost;
 static unsigned ws_error_highlight_default = WSEH_NEW;
 
 static char diff_colors[][COLOR_MAXLEN] = {
@@ -204,6 +205,8 @@ long parse_algorithm_value(const char *value)
 		return XDF_PATIENCE_DIFF;
 	else if (!strcasecmp(value, "histogram"))
 		return XDF_HISTOGRAM_DIFF;
+	else if (!strcasecmp(value, "bounded"))
+		return XDF_BOUNDED_DIFF;
 	return -1;
 }
 
@@ -426,6 +429,17 @@ int git_diff_basic_config(const char *var, const char *value, void *cb)
 		return 0;
 	}
 
+	if (!strcmp(var, "diff.maxcost")) {
+		unsigned long max_cost = git_config_ulong(var, value);
+
+		/* xdiff counts the cost in a signed long */
+		if (max_cost > LONG_MAX)
+			return error(_("value for '%s' is too large: %s"),
+				     var, value);
+		diff_max_cost = max_cost;
+		return 0;
+	}
+
 	if (userdiff_config(var, value) < 0)
 		return -1;
 
@@ -778,6 +792,23 @@ struct moved_entry {
 	struct hashmap_entry ent;
 	const struct emitted_diff_symbol *es;
 	struct moved_entry *next_line;
+	/* next line of the same class on the same side of the diff */
+	struct moved_entry *next_match;
+	/* equivalence class under the color-moved white space rules */
+	int id;
+};
+
+/*
+ * Every '+' and '-' line is hashed exactly once, when it is put into
+ * "entries", and assigned the id of its equivalence class.  Candidate
+ * matches on either side are then found by indexing "plus" or "minus"
+ * with that id, and lines are compared by id, without going back to
+ * the hash table or to the text.
+ */
+struct moved_index {
+	struct moved_entry *entries; /* parallel to o->emitted_symbols */
+	struct moved_entry **plus, **minus; /* indexed by class id */
+	int nr_classes;
 };
 
 /**
@@ -902,64 +933,88 @@ static int moved_entry_cmp(const void *hashmap_cmp_fn_data,
 				    flags);
 }
 
-static struct moved_entry *prepare_entry(struct diff_options *o,
-					 int line_no)
+static void prepare_entry(struct diff_options *o, int line_no,
+			  struct moved_entry *ret)
 {
-	struct moved_entry *ret = xmalloc(sizeof(*ret));
 	struct emitted_diff_symbol *l = &o->emitted_symbols->buf[line_no];
 	unsigned flags = o->color_moved_ws_handling & XDF_WHITESPACE_FLAGS;
 
-	ret->ent.hash = xdiff_hash_string(l->line, l->len, flags);
+	hashmap_entry_init(ret, xdiff_hash_string(l->line, l->len, flags));
 	ret->es = l;
 	ret->next_line = NULL;
-
-	return ret;
+	ret->next_match = NULL;
 }
 
 static void add_lines_to_move_detection(struct diff_options *o,
-					struct hashmap *add_lines,
-					struct hashmap *del_lines)
+					struct moved_index *mi)
 {
 	struct moved_entry *prev_line = NULL;
+	struct hashmap classes;
+	int n, alloc = 0;
+
+	hashmap_init(&classes, moved_entry_cmp, o, 0);
+	mi->entries = xcalloc(o->emitted_symbols->nr, sizeof(*mi->entries));
+	mi->plus = mi->minus = NULL;
+	mi->nr_classes = 0;
 
-	int n;
 	for (n = 0; n < o->emitted_symbols->nr; n++) {
-		struct hashmap *hm;
-		struct moved_entry *key;
+		struct moved_entry *key = &mi->entries[n], *rep;
+		struct moved_entry **head;
+		enum diff_symbol s = o->emitted_symbols->buf[n].s;
 
-		switch (o->emitted_symbols->buf[n].s) {
-		case DIFF_SYMBOL_PLUS:
-			hm = add_lines;
-			break;
-		case DIFF_SYMBOL_MINUS:
-			hm = del_lines;
-			break;
-		default:
+		if (s != DIFF_SYMBOL_PLUS && s != DIFF_SYMBOL_MINUS) {
 			prev_line = NULL;
 			continue;
 		}
 
-		key = prepare_entry(o, n);
-		if (prev_line && prev_line->es->s == o->emitted_symbols->buf[n].s)
-			prev_line->next_line = key;
+		prepare_entry(o, n, key);
+		rep = hashmap_get(&classes, key, NULL);
+		if (rep) {
+			key->id = rep->id;
+		} else {
+			key->id = mi->nr_classes++;
+			hashmap_add(&classes, key);
+			if (alloc < mi->nr_classes) {
+				int old = alloc;
+				ALLOC_GROW(mi->plus, mi->nr_classes, alloc);
+				REALLOC_ARRAY(mi->minus, alloc);
+				memset(mi->plus + old, 0,
+				       st_mult(alloc - old, sizeof(*mi->plus)));
+				memset(mi->minus + old, 0,
+				       st_mult(alloc - old, sizeof(*mi->minus)));
+			}
+		}
+
+		head = s == DIFF_SYMBOL_PLUS ? &mi->plus[key->id] : &mi->minus[key->id];
+		key->next_match = *head;
+		*head = key;
 
-		hashmap_add(hm, key);
+		if (prev_line && prev_line->es->s == s)
+			prev_line->next_line = key;
 		prev_line = key;
 	}
+
+	/* the entries are owned by mi->entries */
+	hashmap_free(&classes, 0);
+}
+
+static void moved_index_clear(struct moved_index *mi)
+{
+	FREE_AND_NULL(mi->entries);
+	FREE_AND_NULL(mi->plus);
+	FREE_AND_NULL(mi->minus);
+	mi->nr_classes = 0;
 }
 
-static void pmb_advance_or_null(struct diff_options *o,
-				struct moved_entry *match,
-				struct hashmap *hm,
+static void pmb_advance_or_null(struct moved_entry *key,
 				struct moved_block *pmb,
 				int pmb_nr)
 {
 	int i;
 	for (i = 0; i < pmb_nr; i++) {
 		struct moved_entry *prev = pmb[i].match;
-		struct moved_entry *cur = (prev && prev->next_line) ?
-				prev->next_line : NULL;
-		if (cur && !hm->cmpfn(o, cur, match, NULL)) {
+		struct moved_entry *cur = prev ? prev->next_line : NULL;
+		if (cur && cur->id == key->id) {
 			pmb[i].match = cur;
 		} else {
 			pmb[i].match = NULL;
@@ -968,36 +1023,28 @@ static void pmb_advance_or_null(struct diff_options *o,
 }
 
 static void pmb_advance_or_null_multi_match(struct diff_options *o,
-					    struct moved_entry *match,
-					    struct hashmap *hm,
+					    struct moved_entry *key,
 					    struct moved_block *pmb,
 					    int pmb_nr, int n)
 {
 	int i;
-	char *got_match = xcalloc(1, pmb_nr);
-
-	for (; match; match = hashmap_get_next(hm, match)) {
-		for (i = 0; i < pmb_nr; i++) {
-			struct moved_entry *prev = pmb[i].match;
-			struct moved_entry *cur = (prev && prev->next_line) ?
-					prev->next_line : NULL;
-			if (!cur)
-				continue;
-			if (!cmp_in_block_with_wsd(o, cur, match, &pmb[i], n))
-				got_match[i] |= 1;
-		}
-	}
 
 	for (i = 0; i < pmb_nr; i++) {
-		if (got_match[i]) {
-			/* Advance to the next line */
-			pmb[i].match = pmb[i].match->next_line;
-		} else {
+		struct moved_entry *prev = pmb[i].match;
+		struct moved_entry *cur = prev ? prev->next_line : NULL;
+
+		/*
+		 * "cur" can only continue the block if it is of the same
+		 * class as the current line; it is then itself one of the
+		 * candidate matches, so only the indentation change needs
+		 * to be checked.
+		 */
+		if (cur && cur->id == key->id &&
+		    !cmp_in_block_with_wsd(o, cur, cur, &pmb[i], n))
+			pmb[i].match = cur;
+		else
 			moved_block_clear(&pmb[i]);
-		}
 	}
-
-	free(got_match);
 }
 
 static int shrink_potential_moved_blocks(struct moved_block *pmb,
@@ -1062,8 +1109,7 @@ static void adjust_last_block(struct diff_options *o, int n, int block_length)
 
 /* Find blocks of moved code, delegate actual coloring decision to helper */
 static void mark_color_as_moved(struct diff_options *o,
-				struct hashmap *add_lines,
-				struct hashmap *del_lines)
+				struct moved_index *mi)
 {
 	struct moved_block *pmb = NULL; /* potentially moved blocks */
 	int pmb_nr = 0, pmb_alloc = 0;
@@ -1071,23 +1117,16 @@ static void mark_color_as_moved(struct diff_options *o,
 
 
 	for (n = 0; n < o->emitted_symbols->nr; n++) {
-		struct hashmap *hm = NULL;
-		struct moved_entry *key;
+		struct moved_entry *key = &mi->entries[n];
 		struct moved_entry *match = NULL;
 		struct emitted_diff_symbol *l = &o->emitted_symbols->buf[n];
 
 		switch (l->s) {
 		case DIFF_SYMBOL_PLUS:
-			hm = del_lines;
-			key = prepare_entry(o, n);
-			match = hashmap_get(hm, key, NULL);
-			free(key);
+			match = mi->minus[key->id];
 			break;
 		case DIFF_SYMBOL_MINUS:
-			hm = add_lines;
-			key = prepare_entry(o, n);
-			match = hashmap_get(hm, key, NULL);
-			free(key);
+			match = mi->plus[key->id];
 			break;
 		default:
 			flipped_block = 1;
@@ -1111,9 +1150,9 @@ static void mark_color_as_moved(struct diff_options *o,
 
 		if (o->color_moved_ws_handling &
 		    COLOR_MOVED_WS_ALLOW_INDENTATION_CHANGE)
-			pmb_advance_or_null_multi_match(o, match, hm, pmb, pmb_nr, n);
+			pmb_advance_or_null_multi_match(o, key, pmb, pmb_nr, n);
 		else
-			pmb_advance_or_null(o, match, hm, pmb, pmb_nr);
+			pmb_advance_or_null(key, pmb, pmb_nr);
 
 		pmb_nr = shrink_potential_moved_blocks(pmb, pmb_nr);
 
@@ -1122,7 +1161,7 @@ static void mark_color_as_moved(struct diff_options *o,
 			 * The current line is the start of a new block.
 			 * Setup the set of potential blocks.
 			 */
-			for (; match; match = hashmap_get_next(hm, match)) {
+			for (; match; match = match->next_match) {
 				ALLOC_GROW(pmb, pmb_nr + 1, pmb_alloc);
 				if (o->color_moved_ws_handling &
 				    COLOR_MOVED_WS_ALLOW_INDENTATION_CHANGE) {
@@ -3512,6 +3551,7 @@ static void builtin_diff(const char *name_a,
 		xpp.flags = o->xdl_opts;
 		xpp.anchors = o->anchors;
 		xpp.anchors_nr = o->anchors_nr;
+		xpp.max_cost = o->xdl_max_cost;
 		xecfg.ctxlen = o->context;
 		xecfg.interhunkctxlen = o->interhunkcontext;
 		xecfg.flags = XDL_EMIT_FUNCNAMES;
@@ -3636,6 +3676,7 @@ static void builtin_diffstat(const char *name_a, const char *name_b,
 		xpp.flags = o->xdl_opts;
 		xpp.anchors = o->anchors;
 		xpp.anchors_nr = o->anchors_nr;
+		xpp.max_cost = o->xdl_max_cost;
 		xecfg.ctxlen = o->context;
 		xecfg.interhunkctxlen = o->interhunkcontext;
 		if (xdi_diff_outf(&mf1, &mf2, discard_hunk_line,
@@ -4451,6 +4492,7 @@ void repo_diff_setup(struct repository *r, struct diff_options *options)
 	options->use_color = diff_use_color_default;
 	options->detect_rename = diff_detect_rename_default;
 	options->xdl_opts |= diff_algorithm;
+	options->xdl_max_cost = diff_max_cost;
 	if (diff_indent_heuristic)
 		DIFF_XDL_SET(options, INDENT_HEURISTIC);
 
@@ -4989,7 +5031,8 @@ int diff_opt_parse(struct diff_options *options,
 		long value = parse_algorithm_value(optarg);
 		if (value < 0)
 			return error("option diff-algorithm accepts \"myers\", "
-				     "\"minimal\", \"patience\" and \"histogram\"");
+				     "\"minimal\", \"patience\", \"histogram\" "
+				     "and \"bounded\"");
 		/* clear out previous settings */
 		DIFF_XDL_CLR(options, NEED_MINIMAL);
 		options->xdl_opts &= ~XDF_DIFF_ALGORITHM_MASK;
@@ -5866,22 +5909,18 @@ static void diff_flush_patch_all_file_pairs(struct diff_options *o)
 
 	if (o->emitted_symbols) {
 		if (o->color_moved) {
-			struct hashmap add_lines, del_lines;
+			struct moved_index mi;
 
 			if (o->color_moved_ws_handling &
 			    COLOR_MOVED_WS_ALLOW_INDENTATION_CHANGE)
 				o->color_moved_ws_handling |= XDF_IGNORE_WHITESPACE;
 
-			hashmap_init(&del_lines, moved_entry_cmp, o, 0);
-			hashmap_init(&add_lines, moved_entry_cmp, o, 0);
-
-			add_lines_to_move_detection(o, &add_lines, &del_lines);
-			mark_color_as_moved(o, &add_lines, &del_lines);
+			add_lines_to_move_detection(o, &mi);
+			mark_color_as_moved(o, &mi);
 			if (o->color_moved == COLOR_MOVED_ZEBRA_DIM)
 				dim_moved_lines(o);
 
-			hashmap_free(&add_lines, 1);
-			hashmap_free(&del_lines, 1);
+			moved_index_clear(&mi);
 		}
 
 		for (i = 0; i < esm.nr; i++)
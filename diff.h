@@ -169,6 +169,7 @@ struct diff_options {
 	int prefix_length;
 	const char *stat_sep;
 	long xdl_opts;
+	long xdl_max_cost;
 
 	/* see Documentation/diff-options.txt */
 	char **anchors;
@@ -21,6 +21,8 @@
 #include "ewah/ewok.h"
 #include "fsmonitor.h"
 #include "submodule-config.h"
+#include "thread-utils.h"
+#include "string-list.h"
 
 /*
  * Tells read_directory_recursive how a file or directory should be treated.
@@ -35,16 +37,37 @@ enum path_treatment {
 	path_untracked
 };
 
+/*
+ * A directory listing read ahead of time by preload_directory(), keyed
+ * by the path of the directory as read_directory_recursive() spells
+ * it, i.e. with a trailing slash, or empty for the top-level.
+ */
+struct preloaded_dirent {
+	char *name;
+	int dtype;
+};
+
+struct preloaded_dir {
+	struct hashmap_entry ent;
+	struct preloaded_dirent *entries;
+	int nr, alloc;
+	char path[FLEX_ARRAY];
+};
+
 /*
  * Support data structure for our opendir/readdir/closedir wrappers
  */
 struct cached_dir {
 	DIR *fdir;
+	struct preloaded_dir *preloaded;
 	struct untracked_cache_dir *untracked;
 	int nr_files;
 	int nr_dirs;
+	int nr_preloaded;
 
-	struct dirent *de;
+	/* the entry just read from fdir or preloaded, if any */
+	const char *d_name;
+	int d_type;
 	const char *file;
 	struct untracked_cache_dir *ucd;
 };
@@ -53,7 +76,7 @@ static enum path_treatment read_directory_recursive(struct dir_struct *dir,
 	struct index_state *istate, const char *path, int len,
 	struct untracked_cache_dir *untracked,
 	int check_only, int stop_at_first_file, const struct pathspec *pathspec);
-static int get_dtype(struct dirent *de, struct index_state *istate,
+static int get_dtype(int dtype, struct index_state *istate,
 		     const char *path, int len);
 
 int count_slashes(const char *s)
@@ -1123,7 +1146,7 @@ static struct exclude *last_exclude_matching_from_list(const char *pathname,
 
 		if (x->flags & EXC_FLAG_MUSTBEDIR) {
 			if (*dtype == DT_UNKNOWN)
-				*dtype = get_dtype(NULL, istate, pathname, pathlen);
+				*dtype = get_dtype(DT_UNKNOWN, istate, pathname, pathlen);
 			if (*dtype != DT_DIR)
 				continue;
 		}
@@ -1687,10 +1710,9 @@ static int get_index_dtype(struct index_state *istate,
 	return DT_UNKNOWN;
 }
 
-static int get_dtype(struct dirent *de, struct index_state *istate,
+static int get_dtype(int dtype, struct index_state *istate,
 		     const char *path, int len)
 {
-	int dtype = de ? DTYPE(de) : DT_UNKNOWN;
 	struct stat st;
 
 	if (dtype != DT_UNKNOWN)
@@ -1715,14 +1737,14 @@ static enum path_treatment treat_one_path(struct dir_struct *dir,
 					  struct strbuf *path,
 					  int baselen,
 					  const struct pathspec *pathspec,
-					  int dtype, struct dirent *de)
+					  int dtype)
 {
 	int exclude;
 	int has_path_in_index = !!index_file_exists(istate, path->buf, path->len, ignore_case);
 	enum path_treatment path_treatment;
 
 	if (dtype == DT_UNKNOWN)
-		dtype = get_dtype(de, istate, path->buf, path->len);
+		dtype = get_dtype(dtype, istate, path->buf, path->len);
 
 	/* Always exclude indexed files */
 	if (dtype != DT_DIR && has_path_in_index)
@@ -1830,21 +1852,18 @@ static enum path_treatment treat_path(struct dir_struct *dir,
 				      int baselen,
 				      const struct pathspec *pathspec)
 {
-	int dtype;
-	struct dirent *de = cdir->de;
-
-	if (!de)
+	if (!cdir->d_name)
 		return treat_path_fast(dir, untracked, cdir, istate, path,
 				       baselen, pathspec);
-	if (is_dot_or_dotdot(de->d_name) || !fspathcmp(de->d_name, ".git"))
+	if (is_dot_or_dotdot(cdir->d_name) || !fspathcmp(cdir->d_name, ".git"))
 		return path_none;
 	strbuf_setlen(path, baselen);
-	strbuf_addstr(path, de->d_name);
+	strbuf_addstr(path, cdir->d_name);
 	if (simplify_away(path->buf, path->len, pathspec))
 		return path_none;
 
-	dtype = DTYPE(de);
-	return treat_one_path(dir, untracked, istate, path, baselen, pathspec, dtype, de);
+	return treat_one_path(dir, untracked, istate, path, baselen, pathspec,
+			      cdir->d_type);
 }
 
 static void add_untracked(struct untracked_cache_dir *dir, const char *name)
@@ -1915,8 +1934,16 @@ static int open_cached_dir(struct cached_dir *cdir,
 
 	memset(cdir, 0, sizeof(*cdir));
 	cdir->untracked = untracked;
+	cdir->d_type = DT_UNKNOWN;
 	if (valid_cached_dir(dir, untracked, istate, path, check_only))
 		return 0;
+	if (dir->preloaded) {
+		cdir->preloaded = hashmap_get_from_hash(dir->preloaded,
+							strhash(path->buf),
+							path->buf);
+		if (cdir->preloaded)
+			return 0;
+	}
 	c_path = path->len ? path->buf : ".";
 	cdir->fdir = opendir(c_path);
 	if (!cdir->fdir)
@@ -1932,10 +1959,23 @@ static int open_cached_dir(struct cached_dir *cdir,
 
 static int read_cached_dir(struct cached_dir *cdir)
 {
+	if (cdir->preloaded) {
+		struct preloaded_dirent *e;
+
+		if (cdir->nr_preloaded >= cdir->preloaded->nr)
+			return -1;
+		e = &cdir->preloaded->entries[cdir->nr_preloaded++];
+		cdir->d_name = e->name;
+		cdir->d_type = e->dtype;
+		return 0;
+	}
 	if (cdir->fdir) {
-		cdir->de = readdir(cdir->fdir);
-		if (!cdir->de)
+		struct dirent *de = readdir(cdir->fdir);
+
+		if (!de)
 			return -1;
+		cdir->d_name = de->d_name;
+		cdir->d_type = DTYPE(de);
 		return 0;
 	}
 	while (cdir->nr_dirs < cdir->untracked->dirs_nr) {
@@ -2019,7 +2059,7 @@ static enum path_treatment read_directory_recursive(struct dir_struct *dir,
 		if ((state == path_recurse) ||
 			((state == path_untracked) &&
 			 (dir->flags & DIR_SHOW_IGNORED_TOO) &&
-			 (get_dtype(cdir.de, istate, path.buf, path.len) == DT_DIR))) {
+			 (get_dtype(cdir.d_type, istate, path.buf, path.len) == DT_DIR))) {
 			struct untracked_cache_dir *ud;
 			ud = lookup_untracked(dir->untracked, untracked,
 					      path.buf + baselen,
@@ -2142,7 +2182,7 @@ static int treat_leading_path(struct dir_struct *dir,
 		if (simplify_away(sb.buf, sb.len, pathspec))
 			break;
 		if (treat_one_path(dir, NULL, istate, &sb, baselen, pathspec,
-				   DT_DIR, NULL) == path_none)
+				   DT_DIR) == path_none)
 			break; /* do not recurse into it */
 		if (len <= baselen) {
 			rc = 1;
@@ -2314,6 +2354,294 @@ static struct untracked_cache_dir *validate_untracked_cache(struct dir_struct *d
 	return root;
 }
 
+/*
+ * Walking a large working tree is dominated by opendir() and readdir()
+ * (and lstat() where d_type is not available), which on a cold cache
+ * means waiting for the filesystem one directory at a time.  Much like
+ * preload_index() does for lstat(), preload_directory() lets a few
+ * threads read ahead the directories that read_directory_recursive()
+ * is going to visit.  The walk itself still runs on a single thread and
+ * replays the preloaded listings in readdir() order, so the result does
+ * not depend on the threads at all.
+ *
+ * The workers only have to guess which directories will be visited:
+ * they skip paths outside the pathspec, nested repositories, and
+ * untracked directories that are ignored or would only be peeked into.
+ * A wrong guess only costs time; a directory that was not preloaded is
+ * read with opendir() as before.
+ */
+#define MAX_PRELOAD_THREADS (20)
+#define PRELOAD_THREAD_COST (500)
+
+struct preload_state {
+	struct dir_struct *dir;
+	struct index_state *istate;
+	const struct pathspec *pathspec;
+	int prune_excluded;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	char **queue;
+	int queue_nr, queue_alloc;
+	int busy;
+	struct hashmap *preloaded;
+};
+
+struct preload_thread {
+	pthread_t pthread;
+	struct preload_state *state;
+
+	/*
+	 * A copy of the caller's dir_struct that shares its command
+	 * line and global exclude lists, but has its own stack of
+	 * per-directory ones.
+	 */
+	struct dir_struct dir;
+};
+
+static int preloaded_dir_cmp(const void *unused_cmp_data,
+			     const void *entry,
+			     const void *entry_or_key,
+			     const void *keydata)
+{
+	const struct preloaded_dir *a = entry;
+	const struct preloaded_dir *b = entry_or_key;
+
+	return strcmp(a->path, keydata ? keydata : b->path);
+}
+
+static int want_preload(struct preload_thread *t, struct strbuf *path)
+{
+	struct preload_state *ps = t->state;
+	int dtype = DT_DIR;
+
+	if (simplify_away(path->buf, path->len, ps->pathspec))
+		return 0;
+	/*
+	 * The index is not passed down, so that a .gitignore that only
+	 * exists in the index is not read from the object store, which
+	 * we cannot do from several threads.
+	 */
+	if (ps->prune_excluded && is_excluded(&t->dir, NULL, path->buf, &dtype))
+		return 0;
+
+	switch (directory_exists_in_index(ps->istate, path->buf, path->len)) {
+	case index_directory:
+		return 1;
+	case index_gitdir:
+		return 0;
+	case index_nonexistent:
+		break;
+	}
+	return !(ps->dir->flags & (DIR_SHOW_OTHER_DIRECTORIES |
+				   DIR_COLLECT_KILLED_ONLY));
+}
+
+static struct preloaded_dir *preload_one_dir(struct preload_thread *t,
+					     const char *base,
+					     struct string_list *subdirs)
+{
+	struct preloaded_dir *pd;
+	struct strbuf path = STRBUF_INIT;
+	struct dirent *de;
+	DIR *fdir;
+	int baselen = strlen(base), nested = 0, i;
+
+	fdir = opendir(baselen ? base : ".");
+	if (!fdir)
+		return NULL;
+
+	FLEX_ALLOC_STR(pd, path, base);
+	hashmap_entry_init(pd, strhash(base));
+	while ((de = readdir(fdir)) != NULL) {
+		struct preloaded_dirent *e;
+
+		if (is_dot_or_dotdot(de->d_name))
+			continue;
+		if (!fspathcmp(de->d_name, ".git"))
+			nested = baselen > 0;
+		ALLOC_GROW(pd->entries, pd->nr + 1, pd->alloc);
+		e = &pd->entries[pd->nr++];
+		e->name = xstrdup(de->d_name);
+		e->dtype = DTYPE(de);
+	}
+	closedir(fdir);
+
+	/* the walk does not descend into nested repositories */
+	if (nested)
+		return pd;
+
+	strbuf_add(&path, base, baselen);
+	for (i = 0; i < pd->nr; i++) {
+		struct preloaded_dirent *e = &pd->entries[i];
+		int dtype = e->dtype;
+
+		if (!fspathcmp(e->name, ".git"))
+			continue;
+		strbuf_setlen(&path, baselen);
+		strbuf_addstr(&path, e->name);
+		if (dtype == DT_UNKNOWN) {
+			struct stat st;
+
+			if (!lstat(path.buf, &st) && S_ISDIR(st.st_mode))
+				dtype = DT_DIR;
+		}
+		if (dtype != DT_DIR || !want_preload(t, &path))
+			continue;
+		strbuf_addch(&path, '/');
+		string_list_append_nodup(subdirs, xstrdup(path.buf));
+	}
+	strbuf_release(&path);
+	return pd;
+}
+
+static void *preload_dir_thread(void *data)
+{
+	struct preload_thread *t = data;
+	struct preload_state *ps = t->state;
+	struct string_list subdirs = STRING_LIST_INIT_NODUP;
+
+	pthread_mutex_lock(&ps->mutex);
+	for (;;) {
+		struct preloaded_dir *pd;
+		char *base;
+		int i;
+
+		while (!ps->queue_nr && ps->busy)
+			pthread_cond_wait(&ps->cond, &ps->mutex);
+		if (!ps->queue_nr)
+			break;
+		base = ps->queue[--ps->queue_nr];
+		ps->busy++;
+		pthread_mutex_unlock(&ps->mutex);
+
+		pd = preload_one_dir(t, base, &subdirs);
+		free(base);
+
+		pthread_mutex_lock(&ps->mutex);
+		if (pd)
+			hashmap_add(ps->preloaded, pd);
+		ALLOC_GROW(ps->queue, ps->queue_nr + subdirs.nr, ps->queue_alloc);
+		for (i = subdirs.nr - 1; i >= 0; i--)
+			ps->queue[ps->queue_nr++] = subdirs.items[i].string;
+		string_list_clear(&subdirs, 0);
+		ps->busy--;
+		pthread_cond_broadcast(&ps->cond);
+	}
+	pthread_mutex_unlock(&ps->mutex);
+	return NULL;
+}
+
+static void clear_preload_thread(struct preload_thread *t)
+{
+	struct exclude_list_group *group = &t->dir.exclude_list_group[EXC_DIRS];
+	struct exclude_stack *stk = t->dir.exclude_stack;
+	int i;
+
+	for (i = 0; i < group->nr; i++) {
+		free((char *)group->el[i].src);
+		clear_exclude_list(&group->el[i]);
+	}
+	free(group->el);
+	while (stk) {
+		struct exclude_stack *prev = stk->prev;
+		free(stk);
+		stk = prev;
+	}
+	strbuf_release(&t->dir.basebuf);
+}
+
+static void preload_directory(struct dir_struct *dir,
+			      struct index_state *istate,
+			      const char *path, int len,
+			      const struct pathspec *pathspec)
+{
+	struct preload_thread data[MAX_PRELOAD_THREADS];
+	struct preload_state ps;
+	int threads, i;
+
+	if (!HAVE_THREADS || !core_preload_index || dir->untracked)
+		return;
+	if (len && path[len - 1] != '/')
+		return;
+
+	threads = istate->cache_nr / PRELOAD_THREAD_COST;
+	if ((istate->cache_nr > 1) && (threads < 2) && git_env_bool("GIT_TEST_PRELOAD_INDEX", 0))
+		threads = 2;
+	if (threads < 2)
+		return;
+	trace_performance_enter();
+	if (threads > MAX_PRELOAD_THREADS)
+		threads = MAX_PRELOAD_THREADS;
+
+	/* make sure the name hash is set up before the threads use it */
+	if (ignore_case)
+		index_dir_exists(istate, "", 0);
+
+	memset(&ps, 0, sizeof(ps));
+	ps.dir = dir;
+	ps.istate = istate;
+	ps.pathspec = pathspec;
+	ps.prune_excluded = !(dir->flags & (DIR_SHOW_IGNORED | DIR_SHOW_IGNORED_TOO));
+	pthread_mutex_init(&ps.mutex, NULL);
+	pthread_cond_init(&ps.cond, NULL);
+	ALLOC_GROW(ps.queue, 1, ps.queue_alloc);
+	ps.queue[ps.queue_nr++] = xmemdupz(path, len);
+	ps.preloaded = xmalloc(sizeof(*ps.preloaded));
+	hashmap_init(ps.preloaded, preloaded_dir_cmp, NULL, 0);
+
+	memset(&data, 0, sizeof(data));
+	for (i = 0; i < threads; i++) {
+		struct preload_thread *t = data + i;
+		int err;
+
+		t->state = &ps;
+		t->dir = *dir;
+		memset(&t->dir.exclude_list_group[EXC_DIRS], 0,
+		       sizeof(t->dir.exclude_list_group[EXC_DIRS]));
+		t->dir.exclude_stack = NULL;
+		t->dir.exclude = NULL;
+		memset(&t->dir.basebuf, 0, sizeof(t->dir.basebuf));
+		t->dir.preloaded = NULL;
+
+		err = pthread_create(&t->pthread, NULL, preload_dir_thread, t);
+		if (err)
+			die(_("unable to create threaded directory walk: %s"),
+			    strerror(err));
+	}
+	for (i = 0; i < threads; i++) {
+		if (pthread_join(data[i].pthread, NULL))
+			die("unable to join threaded directory walk");
+		clear_preload_thread(data + i);
+	}
+
+	free(ps.queue);
+	pthread_cond_destroy(&ps.cond);
+	pthread_mutex_destroy(&ps.mutex);
+	dir->preloaded = ps.preloaded;
+
+	trace_performance_leave("preload directory");
+}
+
+static void free_preloaded_dirs(struct dir_struct *dir)
+{
+	struct hashmap_iter iter;
+	struct preloaded_dir *pd;
+
+	if (!dir->preloaded)
+		return;
+	hashmap_iter_init(dir->preloaded, &iter);
+	while ((pd = hashmap_iter_next(&iter))) {
+		int i;
+
+		for (i = 0; i < pd->nr; i++)
+			free(pd->entries[i].name);
+		free(pd->entries);
+	}
+	hashmap_free(dir->preloaded, 1);
+	FREE_AND_NULL(dir->preloaded);
+}
+
 int read_directory(struct dir_struct *dir, struct index_state *istate,
 		   const char *path, int len, const struct pathspec *pathspec)
 {
@@ -2333,8 +2661,11 @@ int read_directory(struct dir_struct *dir, struct index_state *istate,
 		 * e.g. prep_exclude()
 		 */
 		dir->untracked = NULL;
-	if (!len || treat_leading_path(dir, istate, path, len, pathspec))
+	if (!len || treat_leading_path(dir, istate, path, len, pathspec)) {
+		preload_directory(dir, istate, path, len, pathspec);
 		read_directory_recursive(dir, istate, path, len, untracked, 0, 0, pathspec);
+		free_preloaded_dirs(dir);
+	}
 	QSORT(dir->entries, dir->nr, cmp_dir_entry);
 	QSORT(dir->ignored, dir->ignored_nr, cmp_dir_entry);
 
@@ -199,6 +199,12 @@ struct dir_struct {
 	struct oid_stat ss_info_exclude;
 	struct oid_stat ss_excludes_file;
 	unsigned unmanaged_exclude_files;
+
+	/*
+	 * Directory listings read ahead by worker threads while
+	 * read_directory() runs; internal to dir.c.
+	 */
+	struct hashmap *preloaded;
 };
 
 /*Count the number of slashes for string s*/
@@ -27,6 +27,7 @@ static int transfer_unpack_limit = -1;
 static int fetch_unpack_limit = -1;
 static int unpack_limit = 100;
 static int prefer_ofs_delta = 1;
+static int use_zstd;
 static int no_done;
 static int deepen_since_ok;
 static int deepen_not_ok;
@@ -295,6 +296,7 @@ static int find_common(struct fetch_negotiator *negotiator,
 			if (args->no_progress)   strbuf_addstr(&c, " no-progress");
 			if (args->include_tag)   strbuf_addstr(&c, " include-tag");
 			if (prefer_ofs_delta)   strbuf_addstr(&c, " ofs-delta");
+			if (use_zstd)           strbuf_addstr(&c, " zstd");
 			if (deepen_since_ok)    strbuf_addstr(&c, " deepen-since");
 			if (deepen_not_ok)      strbuf_addstr(&c, " deepen-not");
 			if (agent_supported)    strbuf_addf(&c, " agent=%s",
@@ -968,6 +970,13 @@ static struct ref *do_fetch_pack(struct fetch_pack_args *args,
 	else
 		prefer_ofs_delta = 0;
 
+	/* only ask for zstd if our repository is set up to keep it */
+	if (repository_format_object_compression == GIT_ZCODEC_ZSTD &&
+	    server_supports("zstd")) {
+		use_zstd = 1;
+		print_verbose(args, _("Server supports zstd"));
+	}
+
 	if (server_supports("filter")) {
 		server_supports_filtering = 1;
 		print_verbose(args, _("Server supports filter"));
@@ -1147,6 +1156,9 @@ static int send_fetch_request(struct fetch_negotiator *negotiator, int fd_out,
 		packet_buf_write(&req_buf, "include-tag");
 	if (prefer_ofs_delta)
 		packet_buf_write(&req_buf, "ofs-delta");
+	if (repository_format_object_compression == GIT_ZCODEC_ZSTD &&
+	    server_supports_feature("fetch", "zstd", 0))
+		packet_buf_write(&req_buf, "zstd");
 
 	/* Add shallow-info and deepen request */
 	if (server_supports_feature("fetch", "shallow", 0))
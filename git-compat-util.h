@@ -685,6 +685,17 @@ extern int git_lstat(const char *, struct stat *);
 #define DEFAULT_PACKED_GIT_LIMIT \
 	((1024L * 1024L) * (size_t)(sizeof(void*) >= 8 ? (32 * 1024L * 1024L) : 256))
 
+/*
+ * With a 64-bit address space there is no reason to slide windows over
+ * a pack; map each one in full instead. NO_MMAP would read the whole
+ * pack into memory, so keep windows there.
+ */
+#ifdef NO_MMAP
+#define DEFAULT_PACKED_GIT_MAP_WHOLE 0
+#else
+#define DEFAULT_PACKED_GIT_MAP_WHOLE (sizeof(void*) >= 8)
+#endif
+
 #ifdef NO_PREAD
 #define pread git_pread
 extern ssize_t git_pread(int fd, void *buf, size_t count, off_t offset);
@@ -6,6 +6,26 @@
 #include "list.h"
 #include "sha1-array.h"
 #include "strbuf.h"
+#include "thread-utils.h"
+
+/*
+ * The loose objects of one object directory, read with readdir(3) one
+ * fanout subdirectory at a time. It lets us say "not here" without a
+ * syscall per lookup. A subdirectory is re-checked against its mtime
+ * after each reprepare_packed_git() and at most a second after it was
+ * last checked, and one modified within the last second is not cached
+ * at all, as entries could still be added without changing its mtime.
+ */
+struct loose_object_cache {
+	/* lookups seen before we started reading whole subdirectories */
+	unsigned int probes;
+	/* loose_cache_generation it was last validated at, 0 if not read */
+	unsigned int generation[256];
+	/* when the mtime was last checked */
+	time_t checked[256];
+	struct cache_time mtime[256];
+	struct oid_array subdir[256];
+};
 
 struct alternate_object_database {
 	struct alternate_object_database *next;
@@ -14,15 +34,7 @@ struct alternate_object_database {
 	struct strbuf scratch;
 	size_t base_len;
 
-	/*
-	 * Used to store the results of readdir(3) calls when searching
-	 * for unique abbreviated hashes.  This cache is never
-	 * invalidated, thus it's racy and not necessarily accurate.
-	 * That's fine for its purpose; don't use it for tasks requiring
-	 * greater accuracy!
-	 */
-	char loose_objects_subdir_seen[256];
-	struct oid_array loose_objects_cache;
+	struct loose_object_cache loose_objects;
 
 	/*
 	 * Path to the alternative object store. If this is a relative path,
@@ -62,6 +74,18 @@ void add_to_alternates_memory(const char *dir);
  */
 struct strbuf *alt_scratch_buf(struct alternate_object_database *alt);
 
+/*
+ * Return the sorted list of loose objects in fanout subdirectory
+ * "subdir_nr" of "alt", or of the repository's own object directory
+ * if "alt" is NULL. Returns NULL if the subdirectory is being written
+ * to right now and cannot be cached; read it directly in that case.
+ */
+struct oid_array *odb_loose_cache(struct repository *r,
+				  struct alternate_object_database *alt,
+				  int subdir_nr);
+
+void clear_loose_object_cache(struct loose_object_cache *cache);
+
 struct packed_git {
 	struct packed_git *next;
 	struct list_head mru;
@@ -103,6 +127,10 @@ struct raw_object_store {
 	struct alternate_object_database *alt_odb_list;
 	struct alternate_object_database **alt_odb_tail;
 
+	/* loose objects in "objectdir"; see struct loose_object_cache */
+	struct loose_object_cache *loose_objects;
+	unsigned int loose_cache_generation;
+
 	/*
 	 * Objects that should be substituted by other objects
 	 * (see git-replace(1)).
@@ -278,6 +306,50 @@ int oid_object_info_extended(struct repository *r,
 			     const struct object_id *,
 			     struct object_info *, unsigned flags);
 
+/*
+ * Objects can be read from several threads at once after
+ * enable_obj_read_lock() has been called: oid_object_info_extended(),
+ * read_object_file() and the functions built on them take
+ * obj_read_mutex themselves, and let go of it while inflating and
+ * applying deltas, which is where the time goes.
+ *
+ * Code that uses the lower-level pack and loose object functions
+ * (use_pack(), open_istream(), ...) or that changes the object store
+ * (e.g. add_to_alternates_memory()) while other threads may be reading
+ * has to hold the lock itself, using obj_read_lock() and
+ * obj_read_unlock(). The lock is recursive, and is not let go of while
+ * inflating when it was taken that way, so it also protects whatever
+ * else the caller does in between (e.g. diff's tempfiles).
+ */
+extern int obj_read_use_lock;
+
+void enable_obj_read_lock(void);
+void disable_obj_read_lock(void);
+
+void obj_read_lock_1(void);
+void obj_read_unlock_1(void);
+
+static inline void obj_read_lock(void)
+{
+	if (obj_read_use_lock)
+		obj_read_lock_1();
+}
+
+static inline void obj_read_unlock(void)
+{
+	if (obj_read_use_lock)
+		obj_read_unlock_1();
+}
+
+/*
+ * Let go of obj_read_mutex around work that does not touch shared
+ * state, if (and only if) the calling thread holds it, and only took
+ * it through the object reading functions. The value
+ * returned by obj_read_release() must be given to obj_read_reacquire().
+ */
+int obj_read_release(void);
+void obj_read_reacquire(int depth);
+
 /*
  * Iterate over the files in the loose-object parts of the object
  * directory "path", triggering the following callbacks:
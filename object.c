@@ -10,15 +10,22 @@
 #include "object-store.h"
 #include "packfile.h"
 #include "commit-graph.h"
+#include "mem-pool.h"
 
 unsigned int get_max_object_index(void)
 {
-	return the_repository->parsed_objects->obj_hash_size;
+	struct parsed_object_pool *o = the_repository->parsed_objects;
+
+	return o->objects.size + o->scope_objects.size;
 }
 
 struct object *get_indexed_object(unsigned int idx)
 {
-	return the_repository->parsed_objects->obj_hash[idx];
+	struct parsed_object_pool *o = the_repository->parsed_objects;
+
+	if (idx < o->objects.size)
+		return o->objects.objs[idx];
+	return o->scope_objects.objs[idx - o->objects.size];
 }
 
 static const char *object_type_strings[] = {
@@ -65,40 +72,56 @@ static unsigned int hash_obj(const unsigned char *sha1, unsigned int n)
 }
 
 /*
- * Insert obj into the hash table hash, which has length size (which
- * must be a power of 2).  On collisions, simply overflow to the next
- * empty bucket.
+ * Every slot of an object_hash has a one-byte tag next to the object
+ * pointer, taken from a part of the object name that hash_obj() does
+ * not look at.  Probing compares the tags first, so that we only
+ * dereference (and pull into the cache) the objects whose tag matches,
+ * and an empty slot is recognized by its zero tag without touching the
+ * pointers at all.  Tags of existing objects are therefore never zero.
+ */
+static inline unsigned char hash_obj_tag(const unsigned char *sha1)
+{
+	unsigned char tag = sha1[sizeof(unsigned int)];
+	return tag ? tag : 1;
+}
+
+/*
+ * Insert obj into the hash table, which must have room for it.  On
+ * collisions, simply overflow to the next empty bucket.
  */
-static void insert_obj_hash(struct object *obj, struct object **hash, unsigned int size)
+static void insert_obj_hash(struct object *obj, struct object_hash *h)
 {
-	unsigned int j = hash_obj(obj->oid.hash, size);
+	unsigned int j = hash_obj(obj->oid.hash, h->size);
 
-	while (hash[j]) {
+	while (h->tags[j]) {
 		j++;
-		if (j >= size)
+		if (j >= h->size)
 			j = 0;
 	}
-	hash[j] = obj;
+	h->objs[j] = obj;
+	h->tags[j] = hash_obj_tag(obj->oid.hash);
+	h->nr++;
 }
 
-/*
- * Look up the record for the given sha1 in the hash map stored in
- * obj_hash.  Return NULL if it was not found.
- */
-struct object *lookup_object(struct repository *r, const unsigned char *sha1)
+static struct object *lookup_obj_hash(struct object_hash *h,
+				      const unsigned char *sha1)
 {
 	unsigned int i, first;
-	struct object *obj;
+	unsigned char tag, t;
+	struct object *obj = NULL;
 
-	if (!r->parsed_objects->obj_hash)
+	if (!h->objs)
 		return NULL;
 
-	first = i = hash_obj(sha1, r->parsed_objects->obj_hash_size);
-	while ((obj = r->parsed_objects->obj_hash[i]) != NULL) {
-		if (hasheq(sha1, obj->oid.hash))
+	tag = hash_obj_tag(sha1);
+	first = i = hash_obj(sha1, h->size);
+	while ((t = h->tags[i]) != 0) {
+		if (t == tag && hasheq(sha1, h->objs[i]->oid.hash)) {
+			obj = h->objs[i];
 			break;
+		}
 		i++;
-		if (i == r->parsed_objects->obj_hash_size)
+		if (i == h->size)
 			i = 0;
 	}
 	if (obj && i != first) {
@@ -107,54 +130,80 @@ struct object *lookup_object(struct repository *r, const unsigned char *sha1)
 		 * that we do not need to walk the hash table the next
 		 * time we look for it.
 		 */
-		SWAP(r->parsed_objects->obj_hash[i],
-		     r->parsed_objects->obj_hash[first]);
+		SWAP(h->objs[i], h->objs[first]);
+		SWAP(h->tags[i], h->tags[first]);
 	}
 	return obj;
 }
 
 /*
- * Increase the size of the hash map stored in obj_hash to the next
- * power of 2 (but at least 32).  Copy the existing values to the new
- * hash map.
+ * Look up the record for the given sha1 among the parsed objects,
+ * including those of an open object scope.  Return NULL if it was not
+ * found.
+ */
+struct object *lookup_object(struct repository *r, const unsigned char *sha1)
+{
+	struct object *obj = lookup_obj_hash(&r->parsed_objects->objects, sha1);
+
+	if (!obj && r->parsed_objects->scope_pool)
+		obj = lookup_obj_hash(&r->parsed_objects->scope_objects, sha1);
+	return obj;
+}
+
+/*
+ * Increase the size of the hash map to the next power of 2 (but at
+ * least 32).  Copy the existing values to the new hash map.
  */
-static void grow_object_hash(struct repository *r)
+static void grow_object_hash(struct object_hash *h)
 {
 	int i;
 	/*
 	 * Note that this size must always be power-of-2 to match hash_obj
 	 * above.
 	 */
-	int new_hash_size = r->parsed_objects->obj_hash_size < 32 ? 32 : 2 * r->parsed_objects->obj_hash_size;
-	struct object **new_hash;
+	struct object_hash new_hash;
 
-	new_hash = xcalloc(new_hash_size, sizeof(struct object *));
-	for (i = 0; i < r->parsed_objects->obj_hash_size; i++) {
-		struct object *obj = r->parsed_objects->obj_hash[i];
+	new_hash.size = h->size < 32 ? 32 : 2 * h->size;
+	new_hash.nr = 0;
+	new_hash.objs = xcalloc(new_hash.size, sizeof(struct object *));
+	new_hash.tags = xcalloc(new_hash.size, sizeof(unsigned char));
+	for (i = 0; i < h->size; i++) {
+		struct object *obj = h->objs[i];
 
 		if (!obj)
 			continue;
-		insert_obj_hash(obj, new_hash, new_hash_size);
+		insert_obj_hash(obj, &new_hash);
 	}
-	free(r->parsed_objects->obj_hash);
-	r->parsed_objects->obj_hash = new_hash;
-	r->parsed_objects->obj_hash_size = new_hash_size;
+	free(h->objs);
+	free(h->tags);
+	*h = new_hash;
+}
+
+static void clear_obj_hash(struct object_hash *h)
+{
+	FREE_AND_NULL(h->objs);
+	FREE_AND_NULL(h->tags);
+	h->nr = h->size = 0;
 }
 
 void *create_object(struct repository *r, const unsigned char *sha1, void *o)
 {
 	struct object *obj = o;
+	struct object_hash *h;
 
 	obj->parsed = 0;
 	obj->flags = 0;
 	hashcpy(obj->oid.hash, sha1);
 
-	if (r->parsed_objects->obj_hash_size - 1 <= r->parsed_objects->nr_objs * 2)
-		grow_object_hash(r);
+	if (r->parsed_objects->scope_pool)
+		h = &r->parsed_objects->scope_objects;
+	else
+		h = &r->parsed_objects->objects;
+
+	if (h->size - 1 <= h->nr * 2)
+		grow_object_hash(h);
 
-	insert_obj_hash(obj, r->parsed_objects->obj_hash,
-			r->parsed_objects->obj_hash_size);
-	r->parsed_objects->nr_objs++;
+	insert_obj_hash(obj, h);
 	return obj;
 }
 
@@ -434,10 +483,10 @@ void object_array_remove_duplicates(struct object_array *array)
 
 void clear_object_flags(unsigned flags)
 {
-	int i;
+	unsigned int i, max = get_max_object_index();
 
-	for (i=0; i < the_repository->parsed_objects->obj_hash_size; i++) {
-		struct object *obj = the_repository->parsed_objects->obj_hash[i];
+	for (i = 0; i < max; i++) {
+		struct object *obj = get_indexed_object(i);
 		if (obj)
 			obj->flags &= ~flags;
 	}
@@ -445,10 +494,10 @@ void clear_object_flags(unsigned flags)
 
 void clear_commit_marks_all(unsigned int flags)
 {
-	int i;
+	unsigned int i, max = get_max_object_index();
 
-	for (i = 0; i < the_repository->parsed_objects->obj_hash_size; i++) {
-		struct object *obj = the_repository->parsed_objects->obj_hash[i];
+	for (i = 0; i < max; i++) {
+		struct object *obj = get_indexed_object(i);
 		if (obj && obj->type == OBJ_COMMIT)
 			obj->flags &= ~flags;
 	}
@@ -485,7 +534,7 @@ struct raw_object_store *raw_object_store_new(void)
 static void free_alt_odb(struct alternate_object_database *alt)
 {
 	strbuf_release(&alt->scratch);
-	oid_array_clear(&alt->loose_objects_cache);
+	clear_loose_object_cache(&alt->loose_objects);
 	free(alt);
 }
 
@@ -515,24 +564,22 @@ void raw_object_store_clear(struct raw_object_store *o)
 	free_alt_odbs(o);
 	o->alt_odb_tail = NULL;
 
+	if (o->loose_objects) {
+		clear_loose_object_cache(o->loose_objects);
+		FREE_AND_NULL(o->loose_objects);
+	}
+
 	INIT_LIST_HEAD(&o->packed_git_mru);
 	close_all_packs(o);
 	o->packed_git = NULL;
 }
 
-void parsed_object_pool_clear(struct parsed_object_pool *o)
+static void release_object_memory(struct object_hash *h)
 {
-	/*
-	 * As objects are allocated in slabs (see alloc.c), we do
-	 * not need to free each object, but each slab instead.
-	 *
-	 * Before doing so, we need to free any additional memory
-	 * the objects may hold.
-	 */
 	unsigned i;
 
-	for (i = 0; i < o->obj_hash_size; i++) {
-		struct object *obj = o->obj_hash[i];
+	for (i = 0; i < h->size; i++) {
+		struct object *obj = h->objs[i];
 
 		if (!obj)
 			continue;
@@ -544,9 +591,134 @@ void parsed_object_pool_clear(struct parsed_object_pool *o)
 		else if (obj->type == OBJ_TAG)
 			release_tag_memory((struct tag*)obj);
 	}
+}
+
+void begin_object_scope(struct repository *r)
+{
+	struct parsed_object_pool *o = r->parsed_objects;
 
-	FREE_AND_NULL(o->obj_hash);
-	o->obj_hash_size = 0;
+	if (o->scope_pool)
+		BUG("object scopes do not nest");
+	mem_pool_init(&o->scope_pool, 0);
+	o->scope_commit_count = o->commit_count;
+}
+
+static int in_object_scope(struct parsed_object_pool *o, struct object *obj)
+{
+	return obj && lookup_obj_hash(&o->scope_objects, obj->oid.hash) == obj;
+}
+
+/*
+ * Forget what an object from before the scope learned about objects
+ * of the scope, so that it is parsed again when it is needed.
+ */
+static void unparse_from_object_scope(struct parsed_object_pool *o,
+				      struct object *obj)
+{
+	if (!obj->parsed)
+		return;
+
+	if (obj->type == OBJ_COMMIT) {
+		struct commit *c = (struct commit *)obj;
+		struct commit_list *p;
+		int stale = in_object_scope(o, (struct object *)c->maybe_tree);
+
+		for (p = c->parents; p && !stale; p = p->next)
+			stale = in_object_scope(o, &p->item->object);
+		if (stale) {
+			free_commit_buffer(c);
+			free_commit_list(c->parents);
+			c->parents = NULL;
+			c->maybe_tree = NULL;
+			c->object.parsed = 0;
+		}
+	} else if (obj->type == OBJ_TAG) {
+		struct tag *t = (struct tag *)obj;
+
+		if (in_object_scope(o, t->tagged))
+			release_tag_memory(t);
+	}
+}
+
+/*
+ * An object from before the scope that became a commit inside it (see
+ * object_as_type()) and got a commit index that is about to be reused.
+ */
+struct renumbered_commit {
+	struct commit *commit;
+	const void *buffer;
+	unsigned long size;
+};
+
+void end_object_scope(struct repository *r)
+{
+	struct parsed_object_pool *o = r->parsed_objects;
+	struct renumbered_commit *renumber = NULL;
+	size_t renumber_nr = 0, renumber_alloc = 0, j;
+	int i;
+
+	if (!o->scope_pool)
+		BUG("end_object_scope() without begin_object_scope()");
+
+	if (o->scope_objects.nr || o->commit_count != o->scope_commit_count) {
+		for (i = 0; i < o->objects.size; i++) {
+			struct object *obj = o->objects.objs[i];
+			struct commit *c = (struct commit *)obj;
+
+			if (!obj)
+				continue;
+			if (o->scope_objects.nr)
+				unparse_from_object_scope(o, obj);
+			if (obj->type != OBJ_COMMIT ||
+			    c->index < o->scope_commit_count)
+				continue;
+			ALLOC_GROW(renumber, renumber_nr + 1, renumber_alloc);
+			renumber[renumber_nr].commit = c;
+			renumber[renumber_nr].buffer =
+				detach_commit_buffer(c, &renumber[renumber_nr].size);
+			renumber_nr++;
+		}
+		release_object_memory(&o->scope_objects);
+	}
+	clear_obj_hash(&o->scope_objects);
+
+	/*
+	 * The commits of the scope are gone and their buffers freed, so
+	 * their indexes can be handed out again.
+	 */
+	o->commit_count = o->scope_commit_count;
+	for (j = 0; j < renumber_nr; j++) {
+		struct commit *c = renumber[j].commit;
+
+		c->index = alloc_commit_index(r);
+		if (renumber[j].buffer)
+			set_commit_buffer(r, c, (void *)renumber[j].buffer,
+					  renumber[j].size);
+	}
+	free(renumber);
+
+	mem_pool_discard(o->scope_pool, 0);
+	o->scope_pool = NULL;
+}
+
+void parsed_object_pool_clear(struct parsed_object_pool *o)
+{
+	/*
+	 * As objects are allocated in slabs (see alloc.c), we do
+	 * not need to free each object, but each slab instead.
+	 *
+	 * Before doing so, we need to free any additional memory
+	 * the objects may hold.
+	 */
+	release_object_memory(&o->objects);
+	release_object_memory(&o->scope_objects);
+
+	clear_obj_hash(&o->objects);
+	clear_obj_hash(&o->scope_objects);
+	if (o->scope_pool) {
+		mem_pool_discard(o->scope_pool, 0);
+		o->scope_pool = NULL;
+	}
 
 	free_commit_buffer_slab(o->buffer_slab);
 	o->buffer_slab = NULL;
@@ -4,10 +4,29 @@
 #include "cache.h"
 
 struct buffer_slab;
+struct mem_pool;
+
+/*
+ * An open-addressing hash table of objects; each slot has a one-byte
+ * tag next to the pointer, see lookup_object().
+ */
+struct object_hash {
+	struct object **objs;
+	unsigned char *tags;
+	int nr, size;
+};
 
 struct parsed_object_pool {
-	struct object **obj_hash;
-	int nr_objs, obj_hash_size;
+	struct object_hash objects;
+
+	/*
+	 * While an object scope is open (see begin_object_scope()),
+	 * new objects are allocated from scope_pool and are kept in
+	 * scope_objects, so that they can all be dropped at once.
+	 */
+	struct mem_pool *scope_pool;
+	struct object_hash scope_objects;
+	unsigned scope_commit_count;
 
 	/* TODO: migrate alloc_states to mem-pool? */
 	struct alloc_state *blob_state;
@@ -33,6 +52,29 @@ struct parsed_object_pool {
 struct parsed_object_pool *parsed_object_pool_new(void);
 void parsed_object_pool_clear(struct parsed_object_pool *o);
 
+/*
+ * Objects that are created between begin_object_scope() and
+ * end_object_scope() are forgotten by the latter, and the memory
+ * they used is released wholesale.  This keeps long-running processes
+ * that perform one operation after another (e.g. upload-pack serving
+ * several protocol v2 commands) from accumulating every object that
+ * any of the operations ever looked at.
+ *
+ * Objects that existed before the scope was opened stay, but are
+ * unparsed again if they were made to point to objects of the scope.
+ * The caller must not hold on to any pointer to an object created
+ * inside the scope after ending it, be it in an object_array, a
+ * commit_list or a decoration.  Scopes do not nest.
+ *
+ * The commit indexes handed out inside the scope are handed out again
+ * after it, so that commit slabs do not keep growing.  The commit
+ * buffers are taken care of, but any other commit slab that is used
+ * both inside the scope and after it must be cleared before the scope
+ * is ended.
+ */
+void begin_object_scope(struct repository *r);
+void end_object_scope(struct repository *r);
+
 struct object_list {
 	struct object *item;
 	struct object_list *next;
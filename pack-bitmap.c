@@ -12,6 +12,7 @@
 #include "packfile.h"
 #include "repository.h"
 #include "object-store.h"
+#include "list-objects-filter-options.h"
 
 /*
  * An entry on the bitmap index, representing the bitmap for a given
@@ -677,7 +678,202 @@ static int in_bitmapped_pack(struct bitmap_index *bitmap_git,
 	return 0;
 }
 
-struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs)
+static struct ewah_bitmap *type_bitmap(struct bitmap_index *bitmap_git,
+				       enum object_type type)
+{
+	switch (type) {
+	case OBJ_COMMIT:
+		return bitmap_git->commits;
+	case OBJ_TREE:
+		return bitmap_git->trees;
+	case OBJ_BLOB:
+		return bitmap_git->blobs;
+	case OBJ_TAG:
+		return bitmap_git->tags;
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * The objects of the given type that were asked for by name. Filters
+ * never omit these, as list-objects.c only filters NOT_USER_GIVEN ones.
+ */
+static struct bitmap *find_tip_objects(struct bitmap_index *bitmap_git,
+				       struct object_list *tip_objects,
+				       enum object_type type)
+{
+	struct bitmap *result = bitmap_new();
+	struct object_list *p;
+
+	for (p = tip_objects; p; p = p->next) {
+		int pos;
+
+		if (p->item->type != type)
+			continue;
+
+		pos = bitmap_position(bitmap_git, p->item->oid.hash);
+		if (pos < 0)
+			continue;
+
+		bitmap_set(result, pos);
+	}
+
+	return result;
+}
+
+static void filter_bitmap_exclude_type(struct bitmap_index *bitmap_git,
+				       struct object_list *tip_objects,
+				       struct bitmap *to_filter,
+				       enum object_type type)
+{
+	struct eindex *eindex = &bitmap_git->ext_index;
+	struct bitmap *tips;
+	struct ewah_iterator it;
+	eword_t mask;
+	uint32_t i;
+
+	tips = find_tip_objects(bitmap_git, tip_objects, type);
+
+	/*
+	 * Objects in the pack can be dropped a word at a time using the
+	 * type bitmap, sparing the tips.
+	 */
+	ewah_iterator_init(&it, type_bitmap(bitmap_git, type));
+	for (i = 0; i < to_filter->word_alloc && ewah_iterator_next(&mask, &it); i++) {
+		if (i < tips->word_alloc)
+			mask &= ~tips->words[i];
+		to_filter->words[i] &= ~mask;
+	}
+
+	/* ...while those in the extended index have to be checked one by one */
+	for (i = 0; i < eindex->count; i++) {
+		uint32_t pos = i + bitmap_git->pack->num_objects;
+		if (eindex->objects[i]->type == type &&
+		    bitmap_get(to_filter, pos) &&
+		    !bitmap_get(tips, pos))
+			bitmap_unset(to_filter, pos);
+	}
+
+	bitmap_free(tips);
+}
+
+static unsigned long get_size_by_pos(struct bitmap_index *bitmap_git,
+				     uint32_t pos)
+{
+	struct packed_git *pack = bitmap_git->pack;
+	unsigned long size;
+	struct object_info oi = OBJECT_INFO_INIT;
+
+	oi.sizep = &size;
+
+	if (pos < pack->num_objects) {
+		struct revindex_entry *entry = &pack->revindex[pos];
+		if (packed_object_info(the_repository, pack,
+				       entry->offset, &oi) < 0) {
+			struct object_id oid;
+			nth_packed_object_oid(&oid, pack, entry->nr);
+			die(_("unable to get size of %s"), oid_to_hex(&oid));
+		}
+	} else {
+		struct eindex *eindex = &bitmap_git->ext_index;
+		struct object *obj = eindex->objects[pos - pack->num_objects];
+		if (oid_object_info_extended(the_repository, &obj->oid, &oi, 0) < 0)
+			die(_("unable to get size of %s"), oid_to_hex(&obj->oid));
+	}
+
+	return size;
+}
+
+static void filter_bitmap_blob_limit(struct bitmap_index *bitmap_git,
+				     struct object_list *tip_objects,
+				     struct bitmap *to_filter,
+				     unsigned long limit)
+{
+	struct eindex *eindex = &bitmap_git->ext_index;
+	struct bitmap *tips;
+	struct ewah_iterator it;
+	eword_t mask;
+	uint32_t i;
+
+	tips = find_tip_objects(bitmap_git, tip_objects, OBJ_BLOB);
+
+	ewah_iterator_init(&it, bitmap_git->blobs);
+	for (i = 0; i < to_filter->word_alloc && ewah_iterator_next(&mask, &it); i++) {
+		eword_t word = to_filter->words[i] & mask;
+		unsigned offset;
+
+		for (offset = 0; offset < BITS_IN_EWORD; offset++) {
+			uint32_t pos;
+
+			if ((word >> offset) == 0)
+				break;
+			offset += ewah_bit_ctz64(word >> offset);
+			pos = i * BITS_IN_EWORD + offset;
+
+			if (!bitmap_get(tips, pos) &&
+			    get_size_by_pos(bitmap_git, pos) >= limit)
+				bitmap_unset(to_filter, pos);
+		}
+	}
+
+	for (i = 0; i < eindex->count; i++) {
+		uint32_t pos = i + bitmap_git->pack->num_objects;
+		if (eindex->objects[i]->type == OBJ_BLOB &&
+		    bitmap_get(to_filter, pos) &&
+		    !bitmap_get(tips, pos) &&
+		    get_size_by_pos(bitmap_git, pos) >= limit)
+			bitmap_unset(to_filter, pos);
+	}
+
+	bitmap_free(tips);
+}
+
+/*
+ * Apply "filter" to the objects in "to_filter", the way
+ * list-objects-filter.c would have during a traversal. If "to_filter"
+ * is NULL, only report whether the filter can be applied at all;
+ * returns 0 if it can and -1 otherwise.
+ */
+static int filter_bitmap(struct bitmap_index *bitmap_git,
+			 struct object_list *tip_objects,
+			 struct bitmap *to_filter,
+			 struct list_objects_filter_options *filter)
+{
+	if (!filter || filter->choice == LOFC_DISABLED)
+		return 0;
+
+	switch (filter->choice) {
+	case LOFC_BLOB_NONE:
+		if (to_filter)
+			filter_bitmap_exclude_type(bitmap_git, tip_objects,
+						   to_filter, OBJ_BLOB);
+		return 0;
+
+	case LOFC_BLOB_LIMIT:
+		if (to_filter)
+			filter_bitmap_blob_limit(bitmap_git, tip_objects,
+						 to_filter,
+						 filter->blob_limit_value);
+		return 0;
+
+	case LOFC_TREE_NONE:
+		if (to_filter) {
+			filter_bitmap_exclude_type(bitmap_git, tip_objects,
+						   to_filter, OBJ_TREE);
+			filter_bitmap_exclude_type(bitmap_git, tip_objects,
+						   to_filter, OBJ_BLOB);
+		}
+		return 0;
+
+	default:
+		/* the sparse filters need paths, which bitmaps do not have */
+		return -1;
+	}
+}
+
+struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs,
+					 struct list_objects_filter_options *filter)
 {
 	unsigned int i;
 
@@ -687,7 +883,12 @@ struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs)
 	struct bitmap *wants_bitmap = NULL;
 	struct bitmap *haves_bitmap = NULL;
 
-	struct bitmap_index *bitmap_git = xcalloc(1, sizeof(*bitmap_git));
+	struct bitmap_index *bitmap_git;
+
+	if (filter_bitmap(NULL, NULL, NULL, filter) < 0)
+		return NULL;
+
+	bitmap_git = xcalloc(1, sizeof(*bitmap_git));
 	/* try to open a bitmapped pack, but don't parse it yet
 	 * because we may not need to use it */
 	if (open_pack_bitmap(bitmap_git) < 0)
@@ -758,6 +959,8 @@ struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs)
 	if (haves_bitmap)
 		bitmap_and_not(wants_bitmap, haves_bitmap);
 
+	filter_bitmap(bitmap_git, wants, wants_bitmap, filter);
+
 	bitmap_git->result = wants_bitmap;
 	bitmap_git->haves = haves_bitmap;
 
@@ -852,31 +1055,15 @@ static uint32_t count_object_type(struct bitmap_index *bitmap_git,
 {
 	struct bitmap *objects = bitmap_git->result;
 	struct eindex *eindex = &bitmap_git->ext_index;
+	struct ewah_bitmap *type_filter = type_bitmap(bitmap_git, type);
 
 	uint32_t i = 0, count = 0;
 	struct ewah_iterator it;
 	eword_t filter;
 
-	switch (type) {
-	case OBJ_COMMIT:
-		ewah_iterator_init(&it, bitmap_git->commits);
-		break;
-
-	case OBJ_TREE:
-		ewah_iterator_init(&it, bitmap_git->trees);
-		break;
-
-	case OBJ_BLOB:
-		ewah_iterator_init(&it, bitmap_git->blobs);
-		break;
-
-	case OBJ_TAG:
-		ewah_iterator_init(&it, bitmap_git->tags);
-		break;
-
-	default:
+	if (!type_filter)
 		return 0;
-	}
+	ewah_iterator_init(&it, type_filter);
 
 	while (i < objects->word_alloc && ewah_iterator_next(&filter, &it)) {
 		eword_t word = objects->words[i++] & filter;
@@ -911,6 +1098,81 @@ void count_bitmap_commit_list(struct bitmap_index *bitmap_git,
 		*tags = count_object_type(bitmap_git, OBJ_TAG);
 }
 
+/*
+ * The on-disk size of a packed object is the distance to the object
+ * that follows it in the pack, which the reverse index gives us for
+ * free; only objects in the extended index have to be looked up.
+ */
+static off_t disk_usage_for_type(struct bitmap_index *bitmap_git,
+				 enum object_type type)
+{
+	struct bitmap *objects = bitmap_git->result;
+	struct eindex *eindex = &bitmap_git->ext_index;
+	struct revindex_entry *revindex = bitmap_git->pack->revindex;
+	struct ewah_bitmap *type_filter = type_bitmap(bitmap_git, type);
+
+	size_t i = 0;
+	uint32_t offset;
+	off_t total = 0;
+	struct ewah_iterator it;
+	eword_t filter;
+
+	if (!type_filter)
+		return 0;
+	ewah_iterator_init(&it, type_filter);
+
+	while (i < objects->word_alloc && ewah_iterator_next(&filter, &it)) {
+		eword_t word = objects->words[i] & filter;
+		size_t pos = i++ * BITS_IN_EWORD;
+
+		for (offset = 0; offset < BITS_IN_EWORD; ++offset) {
+			if ((word >> offset) == 0)
+				break;
+
+			offset += ewah_bit_ctz64(word >> offset);
+			total += revindex[pos + offset + 1].offset -
+				 revindex[pos + offset].offset;
+		}
+	}
+
+	for (i = 0; i < eindex->count; ++i) {
+		struct object *obj = eindex->objects[i];
+		struct object_info oi = OBJECT_INFO_INIT;
+		off_t size;
+
+		if (obj->type != type ||
+		    !bitmap_get(objects, bitmap_git->pack->num_objects + i))
+			continue;
+
+		oi.disk_sizep = &size;
+		if (oid_object_info_extended(the_repository, &obj->oid, &oi, 0) < 0)
+			die(_("unable to get disk usage of %s"),
+			    oid_to_hex(&obj->oid));
+		total += size;
+	}
+
+	return total;
+}
+
+void get_bitmap_disk_usage(struct bitmap_index *bitmap_git,
+			   off_t *commits, off_t *trees,
+			   off_t *blobs, off_t *tags)
+{
+	assert(bitmap_git->result);
+
+	if (commits)
+		*commits = disk_usage_for_type(bitmap_git, OBJ_COMMIT);
+
+	if (trees)
+		*trees = disk_usage_for_type(bitmap_git, OBJ_TREE);
+
+	if (blobs)
+		*blobs = disk_usage_for_type(bitmap_git, OBJ_BLOB);
+
+	if (tags)
+		*tags = disk_usage_for_type(bitmap_git, OBJ_TAG);
+}
+
 struct bitmap_test_data {
 	struct bitmap_index *bitmap_git;
 	struct bitmap *base;
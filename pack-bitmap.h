@@ -7,6 +7,7 @@
 
 struct commit;
 struct rev_info;
+struct list_objects_filter_options;
 
 struct bitmap_disk_header {
 	char magic[4];
@@ -42,10 +43,18 @@ struct bitmap_index;
 struct bitmap_index *prepare_bitmap_git(void);
 void count_bitmap_commit_list(struct bitmap_index *, uint32_t *commits,
 			      uint32_t *trees, uint32_t *blobs, uint32_t *tags);
+void get_bitmap_disk_usage(struct bitmap_index *, off_t *commits,
+			   off_t *trees, off_t *blobs, off_t *tags);
 void traverse_bitmap_commit_list(struct bitmap_index *,
 				 show_reachable_fn show_reachable);
 void test_bitmap_walk(struct rev_info *revs);
-struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs);
+/*
+ * Returns NULL if the walk cannot be answered from bitmaps, e.g. because
+ * there is no bitmapped pack or "filter" (which may be NULL) is one that
+ * bitmaps cannot apply.
+ */
+struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs,
+					 struct list_objects_filter_options *filter);
 int reuse_partial_packfile_from_bitmap(struct bitmap_index *,
 				       struct packed_git **packfile,
 				       uint32_t *entries, off_t *up_to);
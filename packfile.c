@@ -56,10 +56,12 @@ void pack_report(void)
 	fprintf(stderr,
 		"pack_report: getpagesize()            = %10" SZ_FMT "\n"
 		"pack_report: core.packedGitWindowSize = %10" SZ_FMT "\n"
-		"pack_report: core.packedGitLimit      = %10" SZ_FMT "\n",
+		"pack_report: core.packedGitLimit      = %10" SZ_FMT "\n"
+		"pack_report: whole-pack mapping       = %10s\n",
 		sz_fmt(getpagesize()),
 		sz_fmt(packed_git_window_size),
-		sz_fmt(packed_git_limit));
+		sz_fmt(packed_git_limit),
+		packed_git_map_whole ? "yes" : "no");
 	fprintf(stderr,
 		"pack_report: pack_used_ctr            = %10u\n"
 		"pack_report: pack_mmap_calls          = %10u\n"
@@ -587,7 +589,69 @@ static int in_window(struct pack_window *win, off_t offset)
 		&& (offset + the_hash_algo->rawsz) <= (win_off + win->len);
 }
 
-unsigned char *use_pack(struct packed_git *p,
+#if !defined(NO_MMAP) && defined(MADV_RANDOM)
+/* how many accesses we look at before (re)considering the advice */
+#define PACK_ADVICE_SAMPLE 256
+/* moving back, or forward by more than this, counts as a seek */
+#define PACK_ADVICE_NEAR (64 * 1024)
+/* how far ahead of a sequential reader the kernel is asked to read */
+#define PACK_ADVICE_READAHEAD (4 * 1024 * 1024)
+
+static void readahead_pack_window(struct pack_window *win, off_t offset)
+{
+	size_t start = xsize_t(offset - win->offset);
+	size_t len;
+
+	start -= start % getpagesize();
+	if (start >= win->len)
+		return;
+	len = win->len - start;
+	if (len > PACK_ADVICE_READAHEAD)
+		len = PACK_ADVICE_READAHEAD;
+	madvise(win->base + start, len, MADV_WILLNEED);
+	win->readahead_end = win->offset + start + len;
+}
+
+/*
+ * Tell the kernel how a whole-pack mapping is being read: readahead
+ * is wasted on object lookups all over a large pack, but is exactly
+ * what a front-to-back scan wants.
+ */
+static void advise_pack_window(struct pack_window *win, off_t offset)
+{
+	off_t last = win->last_offset;
+	int advice;
+
+	win->last_offset = offset;
+	if (offset < last || offset - last > PACK_ADVICE_NEAR)
+		win->seeks++;
+	/* keep the readahead going in front of a sequential reader */
+	if (win->advice == MADV_WILLNEED &&
+	    offset >= win->readahead_end - PACK_ADVICE_READAHEAD / 2)
+		readahead_pack_window(win, offset);
+	if (++win->accesses < PACK_ADVICE_SAMPLE)
+		return;
+
+	advice = win->seeks > PACK_ADVICE_SAMPLE / 4 ? MADV_RANDOM : MADV_WILLNEED;
+	win->accesses = win->seeks = 0;
+	if (advice == win->advice)
+		return;
+	win->advice = advice;
+
+	if (advice == MADV_RANDOM) {
+		madvise(win->base, win->len, MADV_RANDOM);
+	} else {
+		madvise(win->base, win->len, MADV_NORMAL);
+		readahead_pack_window(win, offset);
+	}
+}
+#else
+static inline void advise_pack_window(struct pack_window *win, off_t offset)
+{
+}
+#endif
+
+static unsigned char *map_pack(struct packed_git *p,
 		struct pack_window **w_cursor,
 		off_t offset,
 		unsigned long *left)
@@ -621,21 +685,38 @@ unsigned char *use_pack(struct packed_git *p,
 				die("packfile %s cannot be accessed", p->pack_name);
 
 			win = xcalloc(1, sizeof(*win));
-			win->offset = (offset / window_align) * window_align;
-			len = p->pack_size - win->offset;
-			if (len > packed_git_window_size)
-				len = packed_git_window_size;
-			win->len = (size_t)len;
-			pack_mapped += win->len;
-			while (packed_git_limit < pack_mapped
-				&& unuse_one_window(p))
-				; /* nothing */
-			win->base = xmmap(NULL, win->len,
-				PROT_READ, MAP_PRIVATE,
-				p->pack_fd, win->offset);
-			if (win->base == MAP_FAILED)
-				die_errno("packfile %s cannot be mapped",
-					  p->pack_name);
+			if (packed_git_map_whole) {
+				win->len = xsize_t(p->pack_size);
+				win->base = xmmap_gently(NULL, win->len,
+					PROT_READ, MAP_PRIVATE,
+					p->pack_fd, 0);
+				/*
+				 * Out of address space (a 32-bit process,
+				 * "ulimit -v" or a huge pack); go back to
+				 * windows for this and all later packs.
+				 */
+				if (win->base == MAP_FAILED)
+					packed_git_map_whole = 0;
+				else
+					pack_mapped += win->len;
+			}
+			if (!packed_git_map_whole) {
+				win->offset = (offset / window_align) * window_align;
+				len = p->pack_size - win->offset;
+				if (len > packed_git_window_size)
+					len = packed_git_window_size;
+				win->len = xsize_t(len);
+				pack_mapped += win->len;
+				while (packed_git_limit < pack_mapped
+					&& unuse_one_window(p))
+					; /* nothing */
+				win->base = xmmap(NULL, win->len,
+					PROT_READ, MAP_PRIVATE,
+					p->pack_fd, win->offset);
+				if (win->base == MAP_FAILED)
+					die_errno("packfile %s cannot be mapped",
+						  p->pack_name);
+			}
 			if (!win->offset && win->len == p->pack_size
 				&& !p->do_not_close)
 				close_pack_fd(p);
@@ -660,6 +741,18 @@ unsigned char *use_pack(struct packed_git *p,
 	return win->base + offset;
 }
 
+unsigned char *use_pack(struct packed_git *p,
+		struct pack_window **w_cursor,
+		off_t offset,
+		unsigned long *left)
+{
+	unsigned char *ret = map_pack(p, w_cursor, offset, left);
+
+	if (packed_git_map_whole)
+		advise_pack_window(*w_cursor, offset);
+	return ret;
+}
+
 void unuse_pack(struct pack_window **w_cursor)
 {
 	struct pack_window *w = *w_cursor;
@@ -993,6 +1086,7 @@ static void prepare_packed_git(struct repository *r)
 void reprepare_packed_git(struct repository *r)
 {
 	r->objects->approximate_object_count_valid = 0;
+	r->objects->loose_cache_generation++;
 	r->objects->packed_git_initialized = 0;
 	prepare_packed_git(r);
 }
@@ -1315,10 +1409,54 @@ static enum object_type packed_to_object_type(struct repository *r,
 	goto out;
 }
 
+/*
+ * The delta base cache uses an adaptive replacement policy (ARC): bases
+ * seen once live on the "recent" list, bases that were reused on the
+ * "frequent" list. Evicted entries leave a ghost (key and size only)
+ * behind, and a miss that hits a ghost tells us which of the two lists
+ * we shrank too eagerly; "delta_base_cache_target" is the number of
+ * bytes we currently want to give to the recent list. This keeps a
+ * stream of large one-shot bases (think "log -p" over big blobs) from
+ * flushing the small bases that every other delta chain is built on.
+ */
+enum delta_base_cache_list_id {
+	DBC_RECENT,
+	DBC_FREQUENT,
+	DBC_RECENT_GHOST,
+	DBC_FREQUENT_GHOST,
+};
+
+struct delta_base_cache_list {
+	struct list_head lru;
+	size_t bytes;
+	unsigned int nr;
+};
+
+static struct delta_base_cache_list delta_base_lists[] = {
+	{ LIST_HEAD_INIT(delta_base_lists[DBC_RECENT].lru) },
+	{ LIST_HEAD_INIT(delta_base_lists[DBC_FREQUENT].lru) },
+	{ LIST_HEAD_INIT(delta_base_lists[DBC_RECENT_GHOST].lru) },
+	{ LIST_HEAD_INIT(delta_base_lists[DBC_FREQUENT_GHOST].lru) },
+};
+
 static struct hashmap delta_base_cache;
-static size_t delta_base_cached;
+static size_t delta_base_cache_target;
+
+/* how many of the oldest entries to consider when picking a victim */
+#define DELTA_BASE_EVICT_CANDIDATES 4
 
-static LIST_HEAD(delta_base_cache_lru);
+/* ghost lists may always remember at least this many entries */
+#define DELTA_BASE_GHOST_MIN 64
+
+static struct {
+	uintmax_t hits;
+	uintmax_t misses;
+	uintmax_t evictions;
+	uintmax_t recent_ghost_hits;
+	uintmax_t frequent_ghost_hits;
+} delta_base_stats;
+
+static struct trace_key trace_delta_base_cache = TRACE_KEY_INIT(DELTA_BASE_CACHE);
 
 struct delta_base_cache_key {
 	struct packed_git *p;
@@ -1326,14 +1464,48 @@ struct delta_base_cache_key {
 };
 
 struct delta_base_cache_entry {
-	struct hashmap hash;
+	struct hashmap_entry ent;
 	struct delta_base_cache_key key;
 	struct list_head lru;
-	void *data;
+	enum delta_base_cache_list_id list;
+	void *data; /* NULL for ghosts */
 	unsigned long size;
 	enum object_type type;
+	/* number of deltas applied to produce this base */
+	unsigned int depth;
 };
 
+static inline size_t delta_base_cached(void)
+{
+	return delta_base_lists[DBC_RECENT].bytes +
+	       delta_base_lists[DBC_FREQUENT].bytes;
+}
+
+static inline int is_delta_base_ghost(struct delta_base_cache_entry *ent)
+{
+	return ent->list == DBC_RECENT_GHOST || ent->list == DBC_FREQUENT_GHOST;
+}
+
+static void link_delta_base_entry(struct delta_base_cache_entry *ent,
+				  enum delta_base_cache_list_id id)
+{
+	struct delta_base_cache_list *list = &delta_base_lists[id];
+
+	ent->list = id;
+	list_add_tail(&ent->lru, &list->lru);
+	list->bytes += ent->size;
+	list->nr++;
+}
+
+static void unlink_delta_base_entry(struct delta_base_cache_entry *ent)
+{
+	struct delta_base_cache_list *list = &delta_base_lists[ent->list];
+
+	list_del(&ent->lru);
+	list->bytes -= ent->size;
+	list->nr--;
+}
+
 static unsigned int pack_entry_hash(struct packed_git *p, off_t base_offset)
 {
 	unsigned int hash;
@@ -1344,7 +1516,7 @@ static unsigned int pack_entry_hash(struct packed_git *p, off_t base_offset)
 }
 
 static struct delta_base_cache_entry *
-get_delta_base_cache_entry(struct packed_git *p, off_t base_offset)
+lookup_delta_base_cache_entry(struct packed_git *p, off_t base_offset)
 {
 	struct hashmap_entry entry;
 	struct delta_base_cache_key key;
@@ -1358,6 +1530,17 @@ get_delta_base_cache_entry(struct packed_git *p, off_t base_offset)
 	return hashmap_get(&delta_base_cache, &entry, &key);
 }
 
+static struct delta_base_cache_entry *
+get_delta_base_cache_entry(struct packed_git *p, off_t base_offset)
+{
+	struct delta_base_cache_entry *ent;
+
+	ent = lookup_delta_base_cache_entry(p, base_offset);
+	if (ent && is_delta_base_ghost(ent))
+		return NULL;
+	return ent;
+}
+
 static int delta_base_cache_key_eq(const struct delta_base_cache_key *a,
 				   const struct delta_base_cache_key *b)
 {
@@ -1389,8 +1572,7 @@ static int in_delta_base_cache(struct packed_git *p, off_t base_offset)
 static void detach_delta_base_cache_entry(struct delta_base_cache_entry *ent)
 {
 	hashmap_remove(&delta_base_cache, ent, &ent->key);
-	list_del(&ent->lru);
-	delta_base_cached -= ent->size;
+	unlink_delta_base_entry(ent);
 	free(ent);
 }
 
@@ -1404,6 +1586,10 @@ static void *cache_or_unpack_entry(struct repository *r, struct packed_git *p,
 	if (!ent)
 		return unpack_entry(r, p, base_offset, type, base_size);
 
+	delta_base_stats.hits++;
+	unlink_delta_base_entry(ent);
+	link_delta_base_entry(ent, DBC_FREQUENT);
+
 	if (type)
 		*type = ent->type;
 	if (base_size)
@@ -1419,39 +1605,183 @@ static inline void release_delta_base_cache(struct delta_base_cache_entry *ent)
 
 void clear_delta_base_cache(void)
 {
-	struct list_head *lru, *tmp;
-	list_for_each_safe(lru, tmp, &delta_base_cache_lru) {
-		struct delta_base_cache_entry *entry =
-			list_entry(lru, struct delta_base_cache_entry, lru);
-		release_delta_base_cache(entry);
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(delta_base_lists); i++) {
+		struct list_head *lru, *tmp;
+		list_for_each_safe(lru, tmp, &delta_base_lists[i].lru) {
+			struct delta_base_cache_entry *entry =
+				list_entry(lru, struct delta_base_cache_entry, lru);
+			release_delta_base_cache(entry);
+		}
 	}
+	delta_base_cache_target = 0;
 }
 
-static void add_delta_base_cache(struct packed_git *p, off_t base_offset,
-	void *base, unsigned long base_size, enum object_type type)
+static void trim_delta_base_ghosts(enum delta_base_cache_list_id id)
 {
-	struct delta_base_cache_entry *ent = xmalloc(sizeof(*ent));
-	struct list_head *lru, *tmp;
+	struct delta_base_cache_list *list = &delta_base_lists[id];
+	unsigned int max_nr = delta_base_lists[DBC_RECENT].nr +
+			      delta_base_lists[DBC_FREQUENT].nr;
 
-	delta_base_cached += base_size;
+	if (max_nr < DELTA_BASE_GHOST_MIN)
+		max_nr = DELTA_BASE_GHOST_MIN;
 
-	list_for_each_safe(lru, tmp, &delta_base_cache_lru) {
-		struct delta_base_cache_entry *f =
-			list_entry(lru, struct delta_base_cache_entry, lru);
-		if (delta_base_cached <= delta_base_cache_limit)
+	while (list->nr &&
+	       (list->bytes > delta_base_cache_limit || list->nr > max_nr))
+		detach_delta_base_cache_entry(list_first_entry(&list->lru,
+				struct delta_base_cache_entry, lru));
+}
+
+/*
+ * Among the oldest few entries of a list, drop the one that frees the
+ * most memory per delta we would have to re-apply to get it back.
+ */
+static struct delta_base_cache_entry *
+pick_delta_base_victim(enum delta_base_cache_list_id id)
+{
+	struct delta_base_cache_entry *victim = NULL;
+	struct list_head *pos;
+	int n = 0;
+
+	list_for_each(pos, &delta_base_lists[id].lru) {
+		struct delta_base_cache_entry *ent =
+			list_entry(pos, struct delta_base_cache_entry, lru);
+		if (!victim ||
+		    (uintmax_t)ent->size * (victim->depth + 1) >
+		    (uintmax_t)victim->size * (ent->depth + 1))
+			victim = ent;
+		if (++n >= DELTA_BASE_EVICT_CANDIDATES)
 			break;
-		release_delta_base_cache(f);
 	}
+	return victim;
+}
+
+static void make_room_in_delta_base_cache(unsigned long size,
+					  enum delta_base_cache_list_id to)
+{
+	struct delta_base_cache_list *recent = &delta_base_lists[DBC_RECENT];
+	struct delta_base_cache_list *frequent = &delta_base_lists[DBC_FREQUENT];
+
+	while (delta_base_cached() + size > delta_base_cache_limit) {
+		struct delta_base_cache_entry *victim;
+		enum delta_base_cache_list_id from, ghost;
+		size_t recent_bytes = recent->bytes;
 
+		if (to == DBC_RECENT)
+			recent_bytes += size;
+		if (recent->nr &&
+		    (recent_bytes > delta_base_cache_target || !frequent->nr))
+			from = DBC_RECENT;
+		else if (frequent->nr)
+			from = DBC_FREQUENT;
+		else
+			break;
+		ghost = from == DBC_RECENT ? DBC_RECENT_GHOST : DBC_FREQUENT_GHOST;
+
+		victim = pick_delta_base_victim(from);
+		unlink_delta_base_entry(victim);
+		FREE_AND_NULL(victim->data);
+		link_delta_base_entry(victim, ghost);
+		delta_base_stats.evictions++;
+		trim_delta_base_ghosts(ghost);
+	}
+}
+
+/*
+ * A miss on a ghost means we evicted from the wrong list; move the
+ * target towards the list the ghost came from, by more when that
+ * ghost list is the smaller of the two.
+ */
+static void adapt_delta_base_target(struct delta_base_cache_entry *ghost)
+{
+	size_t recent = delta_base_lists[DBC_RECENT_GHOST].bytes;
+	size_t frequent = delta_base_lists[DBC_FREQUENT_GHOST].bytes;
+	size_t step = ghost->size;
+
+	if (ghost->list == DBC_RECENT_GHOST) {
+		delta_base_stats.recent_ghost_hits++;
+		if (frequent > recent && recent)
+			step = (double)step * frequent / recent;
+		if (step > delta_base_cache_limit - delta_base_cache_target)
+			delta_base_cache_target = delta_base_cache_limit;
+		else
+			delta_base_cache_target += step;
+	} else {
+		delta_base_stats.frequent_ghost_hits++;
+		if (recent > frequent && frequent)
+			step = (double)step * recent / frequent;
+		if (step > delta_base_cache_target)
+			delta_base_cache_target = 0;
+		else
+			delta_base_cache_target -= step;
+	}
+}
+
+static void report_delta_base_cache_stats(void)
+{
+	trace_printf_key(&trace_delta_base_cache,
+			 "delta base cache: %"PRIuMAX" hits, %"PRIuMAX" misses, "
+			 "%"PRIuMAX" evictions, %"PRIuMAX"/%"PRIuMAX" ghost hits "
+			 "(recent/frequent), %u/%u entries, %"PRIuMAX" bytes, "
+			 "target %"PRIuMAX"/%"PRIuMAX,
+			 delta_base_stats.hits, delta_base_stats.misses,
+			 delta_base_stats.evictions,
+			 delta_base_stats.recent_ghost_hits,
+			 delta_base_stats.frequent_ghost_hits,
+			 delta_base_lists[DBC_RECENT].nr,
+			 delta_base_lists[DBC_FREQUENT].nr,
+			 (uintmax_t)delta_base_cached(),
+			 (uintmax_t)delta_base_cache_target,
+			 (uintmax_t)delta_base_cache_limit);
+}
+
+/*
+ * Hand "base" over to the cache. "depth" is the number of deltas that
+ * were applied to produce it, and "reused" says whether it was itself
+ * just taken out of the cache.
+ */
+static void add_delta_base_cache(struct packed_git *p, off_t base_offset,
+	void *base, unsigned long base_size, enum object_type type,
+	unsigned int depth, int reused)
+{
+	struct delta_base_cache_entry *ent;
+	enum delta_base_cache_list_id to = reused ? DBC_FREQUENT : DBC_RECENT;
+
+	ent = lookup_delta_base_cache_entry(p, base_offset);
+	if (ent) {
+		/* another thread may have cached it while we were patching */
+		if (!is_delta_base_ghost(ent)) {
+			free(base);
+			return;
+		}
+		adapt_delta_base_target(ent);
+		detach_delta_base_cache_entry(ent);
+		to = DBC_FREQUENT;
+	}
+
+	/* it would only flush everything else and then not fit anyway */
+	if (base_size > delta_base_cache_limit) {
+		free(base);
+		return;
+	}
+
+	make_room_in_delta_base_cache(base_size, to);
+
+	ent = xmalloc(sizeof(*ent));
 	ent->key.p = p;
 	ent->key.base_offset = base_offset;
 	ent->type = type;
 	ent->data = base;
 	ent->size = base_size;
-	list_add_tail(&ent->lru, &delta_base_cache_lru);
+	ent->depth = depth;
+	link_delta_base_entry(ent, to);
 
-	if (!delta_base_cache.cmpfn)
+	if (!delta_base_cache.cmpfn) {
 		hashmap_init(&delta_base_cache, delta_base_cache_hash_cmp, NULL, 0);
+		if (trace_want(&trace_delta_base_cache))
+			atexit(report_delta_base_cache_stats);
+	}
 	hashmap_entry_init(ent, pack_entry_hash(p, base_offset));
 	hashmap_add(&delta_base_cache, ent);
 }
@@ -1547,7 +1877,7 @@ static void *unpack_compressed_entry(struct packed_git *p,
 				    off_t curpos,
 				    unsigned long size)
 {
-	int st;
+	int st, depth;
 	git_zstream stream;
 	unsigned char *buffer, *in;
 
@@ -1562,7 +1892,13 @@ static void *unpack_compressed_entry(struct packed_git *p,
 	do {
 		in = use_pack(p, w_curs, curpos, &stream.avail_in);
 		stream.next_in = in;
+		/*
+		 * The window stays mapped while we hold it in w_curs, so
+		 * other readers may go ahead while we inflate.
+		 */
+		depth = obj_read_release();
 		st = git_inflate(&stream, Z_FINISH);
+		obj_read_reacquire(depth);
 		if (!stream.avail_out)
 			break; /* the payload is larger than it should be */
 		curpos += stream.next_in - in;
@@ -1623,6 +1959,7 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 	struct unpack_entry_stack_ent *delta_stack = small_delta_stack;
 	int delta_stack_nr = 0, delta_stack_alloc = UNPACK_ENTRY_STACK_PREALLOC;
 	int base_from_cache = 0;
+	unsigned int depth = 0;
 
 	write_pack_access_log(p, obj_offset);
 
@@ -1637,8 +1974,10 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 			type = ent->type;
 			data = ent->data;
 			size = ent->size;
+			depth = ent->depth;
 			detach_delta_base_cache_entry(ent);
 			base_from_cache = 1;
+			delta_base_stats.hits++;
 			break;
 		}
 
@@ -1657,8 +1996,11 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 		}
 
 		type = unpack_object_header(p, &w_curs, &curpos, &size);
-		if (type != OBJ_OFS_DELTA && type != OBJ_REF_DELTA)
+		if (type != OBJ_OFS_DELTA && type != OBJ_REF_DELTA) {
+			if (delta_stack_nr)
+				delta_base_stats.misses++;
 			break;
+		}
 
 		base_offset = get_delta_base(p, &w_curs, &curpos, type, obj_offset);
 		if (!base_offset) {
@@ -1717,14 +2059,12 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 		void *delta_data;
 		void *base = data;
 		void *external_base = NULL;
+		off_t base_offset = obj_offset;
 		unsigned long delta_size, base_size = size;
-		int i;
+		int i, lock_depth;
 
 		data = NULL;
 
-		if (base)
-			add_delta_base_cache(p, obj_offset, base, base_size, type);
-
 		if (!base) {
 			/*
 			 * We're probably in deep shit, but let's try to fetch
@@ -1755,6 +2095,10 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 		if (!base)
 			continue;
 
+		/*
+		 * Only hand the base to the cache once we are done with it;
+		 * other threads may evict it while we inflate and patch.
+		 */
 		delta_data = unpack_compressed_entry(p, &w_curs, curpos, delta_size);
 
 		if (!delta_data) {
@@ -1762,13 +2106,27 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 			      "at offset %"PRIuMAX" from %s",
 			      (uintmax_t)curpos, p->pack_name);
 			data = NULL;
+			if (!external_base)
+				add_delta_base_cache(p, base_offset, base,
+						     base_size, type, depth,
+						     base_from_cache);
 			free(external_base);
+			base_from_cache = 0;
+			depth++;
 			continue;
 		}
 
+		lock_depth = obj_read_release();
 		data = patch_delta(base, base_size,
 				   delta_data, delta_size,
 				   &size);
+		obj_read_reacquire(lock_depth);
+
+		if (!external_base)
+			add_delta_base_cache(p, base_offset, base, base_size,
+					     type, depth, base_from_cache);
+		base_from_cache = 0;
+		depth++;
 
 		/*
 		 * We could not apply the delta; warn the user, but keep going.
@@ -1996,6 +2354,130 @@ int find_pack_entry(struct repository *r, const struct object_id *oid, struct pa
 	return 0;
 }
 
+#if !defined(NO_MMAP) && defined(MADV_WILLNEED)
+/* how much to read ahead for an object whose end we do not know */
+#define PREFETCH_OBJECT_GUESS (16 * 1024)
+/* reading over a gap this small is cheaper than another seek */
+#define PREFETCH_GAP (64 * 1024)
+/* objects whose pages we check before deciding the batch needs help */
+#define PREFETCH_SAMPLE 8
+
+struct prefetch_range {
+	struct packed_git *p;
+	off_t start, end;
+};
+
+static int prefetch_range_cmp(const void *va, const void *vb)
+{
+	const struct prefetch_range *a = va, *b = vb;
+
+	if (a->p != b->p)
+		return (uintptr_t)a->p < (uintptr_t)b->p ? -1 : 1;
+	if (a->start != b->start)
+		return a->start < b->start ? -1 : 1;
+	return 0;
+}
+
+static int pack_range_resident(struct packed_git *p,
+			       struct pack_window **w_curs, off_t start)
+{
+	size_t pagesize = getpagesize();
+	unsigned char *data = map_pack(p, w_curs, start, NULL);
+	unsigned char vec;
+
+	data -= (uintptr_t)data % pagesize;
+	if (mincore((void *)data, pagesize, (void *)&vec))
+		return 0;
+	return vec & 1;
+}
+
+static void prefetch_pack_range(struct packed_git *p,
+				struct pack_window **w_curs,
+				off_t start, off_t end)
+{
+	size_t pagesize = getpagesize();
+
+	while (start < end) {
+		unsigned long left;
+		unsigned char *data = map_pack(p, w_curs, start, &left);
+		size_t pad = (uintptr_t)data % pagesize;
+
+		if (left > end - start)
+			left = end - start;
+		madvise(data - pad, left + pad, MADV_WILLNEED);
+		start += left;
+	}
+}
+
+void prefetch_packed_objects(struct repository *r,
+			     const struct object_id *oids, size_t nr)
+{
+	struct prefetch_range *ranges;
+	struct pack_window *w_curs = NULL;
+	size_t i, j, ranges_nr = 0;
+
+	ALLOC_ARRAY(ranges, nr);
+	obj_read_lock();
+	for (i = 0; i < nr; i++) {
+		struct prefetch_range *range = &ranges[ranges_nr];
+		struct pack_entry e;
+		off_t last = 0;
+
+		/*
+		 * Resolving and advising costs about as much as reading
+		 * from a warm page cache; if the first few objects are
+		 * already in memory, assume the rest are too.
+		 */
+		if (i == PREFETCH_SAMPLE) {
+			for (j = 0; j < ranges_nr; j++)
+				if (!pack_range_resident(ranges[j].p, &w_curs,
+							 ranges[j].start))
+					break;
+			unuse_pack(&w_curs);
+			if (ranges_nr && j == ranges_nr)
+				goto out;
+		}
+
+		if (!find_pack_entry(r, &oids[i], &e))
+			continue;
+		range->p = e.p;
+		range->start = e.offset;
+		range->end = e.offset + PREFETCH_OBJECT_GUESS;
+		if (e.p->revindex)
+			range->end = find_pack_revindex(e.p, e.offset)[1].offset;
+		if (e.p->pack_size > the_hash_algo->rawsz)
+			last = e.p->pack_size - the_hash_algo->rawsz;
+		if (range->end > last)
+			range->end = last;
+		if (range->start < range->end)
+			ranges_nr++;
+	}
+
+	QSORT(ranges, ranges_nr, prefetch_range_cmp);
+	for (i = 0; i < ranges_nr; i = j) {
+		off_t end = ranges[i].end;
+
+		for (j = i + 1; j < ranges_nr; j++) {
+			if (ranges[j].p != ranges[i].p ||
+			    ranges[j].start > end + PREFETCH_GAP)
+				break;
+			if (ranges[j].end > end)
+				end = ranges[j].end;
+		}
+		prefetch_pack_range(ranges[i].p, &w_curs, ranges[i].start, end);
+		unuse_pack(&w_curs);
+	}
+out:
+	obj_read_unlock();
+	free(ranges);
+}
+#else
+void prefetch_packed_objects(struct repository *r,
+			     const struct object_id *oids, size_t nr)
+{
+}
+#endif
+
 int has_object_pack(const struct object_id *oid)
 {
 	struct pack_entry e;
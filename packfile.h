@@ -154,6 +154,15 @@ extern const struct packed_git *has_packed_and_bad(const unsigned char *sha1);
  */
 extern int find_pack_entry(struct repository *r, const struct object_id *oid, struct pack_entry *e);
 
+/*
+ * Ask the operating system to start reading the pack data of the given
+ * objects, in pack order, so that reading them afterwards in whatever
+ * order the caller needs does not stall on each one. Objects that are
+ * not in a pack are ignored.
+ */
+extern void prefetch_packed_objects(struct repository *r,
+				    const struct object_id *oids, size_t nr);
+
 extern int has_object_pack(const struct object_id *oid);
 
 extern int has_pack_index(const unsigned char *sha1);
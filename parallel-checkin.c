@@ -0,0 +1,154 @@
+#include "cache.h"
+#include "config.h"
+#include "convert.h"
+#include "object-store.h"
+#include "blob.h"
+#include "thread-utils.h"
+#include "parallel-checkin.h"
+
+/*
+ * Cap the parallelism at 16 threads, and do not bother with threads
+ * unless each gets at least this many files to work on.
+ */
+#define MAX_CHECKIN_THREADS (16)
+#define CHECKIN_THREAD_COST (16)
+
+struct checkin_state {
+	struct checkin_entry **todo;
+	int nr, next;
+	unsigned flags;
+	pthread_mutex_t mutex;
+};
+
+struct checkin_thread {
+	pthread_t pthread;
+	struct checkin_state *state;
+};
+
+/*
+ * Whether index_fd() would put the file into the object store as it
+ * is, reading it into memory in one piece.  Asking about conversion
+ * uses the attribute machinery, so this is done before the threads
+ * are started.
+ */
+static int can_check_in(struct index_state *istate,
+			const struct checkin_entry *e)
+{
+	if (!S_ISREG(e->st.st_mode) || e->st.st_size > big_file_threshold)
+		return 0;
+	if (e->attr_path &&
+	    (would_convert_to_git_filter_fd(istate, e->attr_path) ||
+	     would_convert_to_git(istate, e->attr_path)))
+		return 0;
+	return 1;
+}
+
+static void check_in(struct checkin_entry *e, unsigned flags,
+		     struct strbuf *buf)
+{
+	size_t size = xsize_t(e->st.st_size);
+	int fd = git_open_cloexec(e->path, O_RDONLY);
+
+	if (fd < 0)
+		return;
+	strbuf_reset(buf);
+	strbuf_grow(buf, size);
+	if (read_in_full(fd, buf->buf, size) != size) {
+		close(fd);
+		return;
+	}
+	close(fd);
+
+	if (flags & HASH_WRITE_OBJECT) {
+		if (write_object_file(buf->buf, size, blob_type, &e->oid))
+			return;
+	} else {
+		hash_object_file(buf->buf, size, blob_type, &e->oid);
+	}
+	e->hashed = 1;
+}
+
+static void *checkin_thread(void *data)
+{
+	struct checkin_state *state = ((struct checkin_thread *)data)->state;
+	struct strbuf buf = STRBUF_INIT;
+
+	for (;;) {
+		struct checkin_entry *e = NULL;
+
+		pthread_mutex_lock(&state->mutex);
+		if (state->next < state->nr)
+			e = state->todo[state->next++];
+		pthread_mutex_unlock(&state->mutex);
+		if (!e)
+			break;
+		check_in(e, state->flags, &buf);
+	}
+	strbuf_release(&buf);
+	return NULL;
+}
+
+static int checkin_threads(int nr)
+{
+	int threads = 0;
+
+	if (!HAVE_THREADS)
+		return 1;
+	if (git_config_get_checkin_threads(&threads) || !threads) {
+		threads = online_cpus();
+		if (threads > nr / CHECKIN_THREAD_COST)
+			threads = nr / CHECKIN_THREAD_COST;
+	}
+	if (threads > MAX_CHECKIN_THREADS)
+		threads = MAX_CHECKIN_THREADS;
+	return threads;
+}
+
+void parallel_checkin(struct index_state *istate,
+		      struct checkin_entry *entries, int nr,
+		      unsigned flags)
+{
+	struct checkin_thread data[MAX_CHECKIN_THREADS];
+	struct checkin_state state;
+	int threads, i, had_lock = obj_read_use_lock;
+
+	threads = checkin_threads(nr);
+	if (threads < 2)
+		return;
+
+	memset(&state, 0, sizeof(state));
+	state.flags = flags;
+	ALLOC_ARRAY(state.todo, nr);
+	for (i = 0; i < nr; i++) {
+		entries[i].hashed = 0;
+		if (can_check_in(istate, &entries[i]))
+			state.todo[state.nr++] = &entries[i];
+	}
+	if (state.nr < threads)
+		threads = state.nr;
+	if (threads < 2) {
+		free(state.todo);
+		return;
+	}
+
+	trace_performance_enter();
+	pthread_mutex_init(&state.mutex, NULL);
+	/* write_object_file() looks up existing objects under this lock */
+	enable_obj_read_lock();
+	for (i = 0; i < threads; i++) {
+		int err;
+
+		data[i].state = &state;
+		err = pthread_create(&data[i].pthread, NULL, checkin_thread, &data[i]);
+		if (err)
+			die(_("unable to create threaded checkin: %s"), strerror(err));
+	}
+	for (i = 0; i < threads; i++)
+		if (pthread_join(data[i].pthread, NULL))
+			die("unable to join threaded checkin");
+	if (!had_lock)
+		disable_obj_read_lock();
+	pthread_mutex_destroy(&state.mutex);
+	free(state.todo);
+	trace_performance_leave("parallel checkin");
+}
@@ -0,0 +1,41 @@
+#ifndef PARALLEL_CHECKIN_H
+#define PARALLEL_CHECKIN_H
+
+#include "cache.h"
+
+/*
+ * Hashing many files for the index (e.g. "git add" of a large new
+ * tree, or "git hash-object --stdin-paths") is dominated by reading,
+ * hashing and deflating the files one at a time.  parallel_checkin()
+ * does that for a whole batch of paths in worker threads, writing the
+ * resulting loose objects from the workers as well, so the caller is
+ * left with only the index updates, which it applies in its own order.
+ *
+ * Only regular files that go through index_fd() unchanged are handled:
+ * files that need conversion (attributes, filters, autocrlf), that are
+ * larger than core.bigFileThreshold (which go to bulk-checkin), or
+ * that cannot be read in one go are left for the caller to index one
+ * at a time as before, so that errors and warnings are reported the
+ * same way.
+ */
+struct checkin_entry {
+	/* input */
+	const char *path;	/* the file to read */
+	const char *attr_path;	/* path for conversion attributes, or NULL */
+	struct stat st;
+
+	/* output, valid when "hashed" is set */
+	struct object_id oid;
+	unsigned hashed : 1;
+};
+
+/*
+ * Hash the blobs of "entries", writing them to the object database
+ * when "flags" contains HASH_WRITE_OBJECT.  Does nothing unless it is
+ * worth using more than one thread (see core.checkinThreads).
+ */
+void parallel_checkin(struct index_state *istate,
+		      struct checkin_entry *entries, int nr,
+		      unsigned flags);
+
+#endif /* PARALLEL_CHECKIN_H */
@@ -8,6 +8,8 @@
 #include "config.h"
 #include "progress.h"
 #include "thread-utils.h"
+#include "object-store.h"
+#include "blob.h"
 
 struct fscache *fscache;
 
@@ -26,14 +28,78 @@ struct progress_data {
 	pthread_mutex_t mutex;
 };
 
+/*
+ * The attribute machinery is not thread-safe, so asking whether a
+ * path needs to be converted on its way into the repository has to
+ * be serialized.
+ */
+static pthread_mutex_t convert_mutex;
+
 struct thread_data {
 	pthread_t pthread;
 	struct index_state *index;
 	struct pathspec pathspec;
 	struct progress_data *progress;
 	int offset, nr;
+	int verify_content;
+	int verified;
 };
 
+/*
+ * Decide whether an entry whose stat information does not match the
+ * file may still have unchanged contents, i.e. whether it is worth
+ * hashing the file to find out.  This mirrors the logic in
+ * ie_modified(): a change in type or mode, or a change in size of an
+ * entry whose size is known, cannot be undone by looking at the data.
+ */
+static int needs_content_check(const struct cache_entry *ce,
+			       struct stat *st, int changed)
+{
+	if (!S_ISREG(ce->ce_mode) || !S_ISREG(st->st_mode))
+		return 0;
+	if (changed & (MODE_CHANGED | TYPE_CHANGED))
+		return 0;
+	if (ce->ce_stat_data.sd_size &&
+	    ce->ce_stat_data.sd_size != (unsigned int)st->st_size)
+		return 0;
+	return st->st_size <= big_file_threshold;
+}
+
+/*
+ * Hash the file behind "ce" the same way index_fd() would and tell
+ * whether the result matches the index.  Paths that need any kind of
+ * conversion are left alone; converting may consult the object store,
+ * which cannot be used from several threads at once, so those are
+ * handled by the single-threaded refresh that follows.
+ */
+static int content_matches(struct index_state *index,
+			   const struct cache_entry *ce,
+			   struct stat *st, struct strbuf *buf)
+{
+	struct object_id oid;
+	int convert, fd;
+
+	pthread_mutex_lock(&convert_mutex);
+	convert = would_convert_to_git_filter_fd(index, ce->name) ||
+		  would_convert_to_git(index, ce->name);
+	pthread_mutex_unlock(&convert_mutex);
+	if (convert)
+		return 0;
+
+	fd = git_open_cloexec(ce->name, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	strbuf_reset(buf);
+	if (strbuf_read(buf, fd, xsize_t(st->st_size)) != st->st_size) {
+		close(fd);
+		return 0;
+	}
+	close(fd);
+
+	hash_object_file(buf->buf, buf->len, blob_type, &oid);
+	return oideq(&oid, &ce->oid);
+}
+
 static void *preload_thread(void *_data)
 {
 	int nr, last_nr;
@@ -41,6 +107,7 @@ static void *preload_thread(void *_data)
 	struct index_state *index = p->index;
 	struct cache_entry **cep = index->cache + p->offset;
 	struct cache_def cache = CACHE_DEF_INIT;
+	struct strbuf buf = STRBUF_INIT;
 
 	nr = p->nr;
 	if (nr + p->offset > index->cache_nr)
@@ -51,6 +118,7 @@ static void *preload_thread(void *_data)
 	do {
 		struct cache_entry *ce = *cep++;
 		struct stat st;
+		int changed;
 
 		if (ce_stage(ce))
 			continue;
@@ -77,8 +145,28 @@ static void *preload_thread(void *_data)
 			continue;
 		if (lstat(ce->name, &st))
 			continue;
-		if (ie_match_stat(index, ce, &st, CE_MATCH_RACY_IS_DIRTY|CE_MATCH_IGNORE_FSMONITOR))
-			continue;
+		changed = ie_match_stat(index, ce, &st, CE_MATCH_RACY_IS_DIRTY|CE_MATCH_IGNORE_FSMONITOR);
+		if (changed) {
+			struct stat_data sd;
+
+			if (!p->verify_content ||
+			    !needs_content_check(ce, &st, changed) ||
+			    !content_matches(index, ce, &st, &buf))
+				continue;
+			/*
+			 * Only the stat information was stale (or the
+			 * entry was racily clean).  Record the new one so
+			 * that it gets written out with the index, just
+			 * like refresh_index() would have done one file
+			 * at a time.
+			 */
+			fill_stat_data(&sd, &st);
+			if (memcmp(&sd, &ce->ce_stat_data, sizeof(sd))) {
+				ce->ce_stat_data = sd;
+				ce->ce_flags |= CE_UPDATE_IN_BASE;
+				p->verified++;
+			}
+		}
 		ce_mark_uptodate(ce);
 		mark_fsmonitor_valid(ce);
 	} while (--nr > 0);
@@ -89,6 +177,7 @@ static void *preload_thread(void *_data)
 		display_progress(pd->progress, pd->n + last_nr);
 		pthread_mutex_unlock(&pd->mutex);
 	}
+	strbuf_release(&buf);
 	cache_def_clear(&cache);
 	merge_fscache(fscache);
 	return NULL;
@@ -98,9 +187,11 @@ void preload_index(struct index_state *index,
 		   const struct pathspec *pathspec,
 		   unsigned int refresh_flags)
 {
-	int threads, i, work, offset;
+	int threads, i, work, offset, verified = 0;
 	struct thread_data data[MAX_PARALLEL];
 	struct progress_data pd;
+	int verify_content = (refresh_flags & REFRESH_VERIFY_CONTENT) &&
+			     !assume_unchanged;
 
 	if (!HAVE_THREADS || !core_preload_index)
 		return;
@@ -123,6 +214,8 @@ void preload_index(struct index_state *index,
 		pd.progress = start_delayed_progress(_("Refreshing index"), index->cache_nr);
 		pthread_mutex_init(&pd.mutex, NULL);
 	}
+	if (verify_content)
+		pthread_mutex_init(&convert_mutex, NULL);
 
 	for (i = 0; i < threads; i++) {
 		struct thread_data *p = data+i;
@@ -133,6 +226,7 @@ void preload_index(struct index_state *index,
 			copy_pathspec(&p->pathspec, pathspec);
 		p->offset = offset;
 		p->nr = work;
+		p->verify_content = verify_content;
 		if (pd.progress)
 			p->progress = &pd;
 		offset += work;
@@ -145,10 +239,15 @@ void preload_index(struct index_state *index,
 		struct thread_data *p = data+i;
 		if (pthread_join(p->pthread, NULL))
 			die("unable to join threaded lstat");
+		verified += p->verified;
 	}
 	stop_progress(&pd.progress);
+	if (verify_content)
+		pthread_mutex_destroy(&convert_mutex);
+	if (verified)
+		index->cache_changed |= CE_ENTRY_CHANGED;
 
-	trace_performance_leave("preload index");
+	trace_performance_leave("preload index, %d re-hashed", verified);
 }
 
 int read_index_preload(struct index_state *index,
@@ -25,6 +25,7 @@
 #include "fsmonitor.h"
 #include "thread-utils.h"
 #include "progress.h"
+#include "bulk-checkin.h"
 
 /* Mask for the name length in ce_flags in the on-disk index */
 
@@ -691,7 +692,9 @@ void set_object_name_for_intent_to_add_entry(struct cache_entry *ce)
 	oidcpy(&ce->oid, &oid);
 }
 
-int add_to_index(struct index_state *istate, const char *path, struct stat *st, int flags)
+static int add_to_index_1(struct index_state *istate, const char *path,
+			  struct stat *st, const struct object_id *oid,
+			  int flags)
 {
 	int namelen, was_same;
 	mode_t st_mode = st->st_mode;
@@ -761,7 +764,9 @@ int add_to_index(struct index_state *istate, const char *path, struct stat *st,
 		}
 	}
 	if (!intent_only) {
-		if (index_path(istate, &ce->oid, path, st, newflags)) {
+		if (oid)
+			oidcpy(&ce->oid, oid);
+		else if (index_path(istate, &ce->oid, path, st, newflags)) {
 			discard_cache_entry(ce);
 			return error("unable to index file %s", path);
 		}
@@ -789,6 +794,17 @@ int add_to_index(struct index_state *istate, const char *path, struct stat *st,
 	return 0;
 }
 
+int add_to_index(struct index_state *istate, const char *path, struct stat *st, int flags)
+{
+	return add_to_index_1(istate, path, st, NULL, flags);
+}
+
+int add_hashed_to_index(struct index_state *istate, const char *path,
+			struct stat *st, const struct object_id *oid, int flags)
+{
+	return add_to_index_1(istate, path, st, oid, flags);
+}
+
 int add_file_to_index(struct index_state *istate, const char *path, int flags)
 {
 	struct stat st;
@@ -1500,9 +1516,12 @@ int refresh_index(struct index_state *istate, unsigned int flags,
 	/*
 	 * Use the multi-threaded preload_index() to refresh most of the
 	 * cache entries quickly then in the single threaded loop below,
-	 * we only have to do the special cases that are left.
+	 * we only have to do the special cases that are left.  Files
+	 * whose stat information is stale but whose contents did not
+	 * change are re-hashed in parallel as well, unless we were
+	 * asked to look behind CE_VALID.
 	 */
-	preload_index(istate, pathspec, 0);
+	preload_index(istate, pathspec, really ? 0 : REFRESH_VERIFY_CONTENT);
 	for (i = 0; i < istate->cache_nr; i++) {
 		struct cache_entry *ce, *new_entry;
 		int cache_errno = 0;
@@ -3156,6 +3175,9 @@ int write_locked_index(struct index_state *istate, struct lock_file *lock,
 		return 0;
 	}
 
+	/* the objects the index names have to be in place first */
+	flush_bulk_checkin();
+
 	if (istate->fsmonitor_last_update)
 		fill_fsmonitor_bitmap(istate);
 
@@ -1926,8 +1926,6 @@ static int filter_ref_kind(struct ref_filter *filter, const char *refname)
 struct ref_filter_cbdata {
 	struct ref_array *array;
 	struct ref_filter *filter;
-	struct contains_cache contains_cache;
-	struct contains_cache no_contains_cache;
 };
 
 /*
@@ -1964,23 +1962,16 @@ static int ref_filter_handler(const char *refname, const struct object_id *oid,
 		return 0;
 
 	/*
-	 * A merge filter is applied on refs pointing to commits. Hence
-	 * obtain the commit using the 'oid' available and discard all
-	 * non-commits early. The actual filtering is done later.
+	 * Merge and contains filters are applied on refs pointing to
+	 * commits. Hence obtain the commit using the 'oid' available and
+	 * discard all non-commits early. The actual filtering is done
+	 * later, for all refs at once.
 	 */
 	if (filter->merge_commit || filter->with_commit || filter->no_commit || filter->verbose) {
 		commit = lookup_commit_reference_gently(the_repository, oid,
 							1);
 		if (!commit)
 			return 0;
-		/* We perform the filtering for the '--contains' option... */
-		if (filter->with_commit &&
-		    !commit_contains(filter, commit, filter->with_commit, &ref_cbdata->contains_cache))
-			return 0;
-		/* ...or for the `--no-contains' option */
-		if (filter->no_commit &&
-		    commit_contains(filter, commit, filter->no_commit, &ref_cbdata->no_contains_cache))
-			return 0;
 	}
 
 	/*
@@ -2022,6 +2013,46 @@ void ref_array_clear(struct ref_array *array)
 	array->nr = array->alloc = 0;
 }
 
+static void do_contains_filter(struct ref_filter_cbdata *ref_cbdata)
+{
+	struct ref_filter *filter = ref_cbdata->filter;
+	struct ref_array *array = ref_cbdata->array;
+	struct commit **commits;
+	char *with = NULL, *without = NULL;
+	int i, old_nr = array->nr;
+
+	ALLOC_ARRAY(commits, old_nr);
+	for (i = 0; i < old_nr; i++)
+		commits[i] = array->items[i]->commit;
+
+	/* We perform the filtering for the '--contains' option... */
+	if (filter->with_commit) {
+		with = xcalloc(old_nr, 1);
+		commit_contains_many(filter, commits, old_nr,
+				     filter->with_commit, with);
+	}
+	/* ...or for the `--no-contains' option */
+	if (filter->no_commit) {
+		without = xcalloc(old_nr, 1);
+		commit_contains_many(filter, commits, old_nr,
+				     filter->no_commit, without);
+	}
+
+	array->nr = 0;
+	for (i = 0; i < old_nr; i++) {
+		struct ref_array_item *item = array->items[i];
+
+		if ((with && !with[i]) || (without && without[i]))
+			free_array_item(item);
+		else
+			array->items[array->nr++] = item;
+	}
+
+	free(commits);
+	free(with);
+	free(without);
+}
+
 static void do_merge_filter(struct ref_filter_cbdata *ref_cbdata)
 {
 	struct rev_info revs;
@@ -2030,20 +2061,32 @@ static void do_merge_filter(struct ref_filter_cbdata *ref_cbdata)
 	struct ref_array *array = ref_cbdata->array;
 	struct commit **to_clear = xcalloc(sizeof(struct commit *), array->nr);
 
-	repo_init_revisions(the_repository, &revs, NULL);
+	for (i = 0; i < array->nr; i++)
+		to_clear[i] = array->items[i]->commit;
 
-	for (i = 0; i < array->nr; i++) {
-		struct ref_array_item *item = array->items[i];
-		add_pending_object(&revs, &item->commit->object, item->refname);
-		to_clear[i] = item->commit;
-	}
+	if (generation_numbers_enabled(the_repository)) {
+		/*
+		 * A single walk from the merge commit that stops below the
+		 * lowest generation of the tips marks all the merged ones.
+		 */
+		free_commit_list(get_reachable_subset(&filter->merge_commit, 1,
+						      to_clear, array->nr,
+						      UNINTERESTING));
+	} else {
+		repo_init_revisions(the_repository, &revs, NULL);
+
+		for (i = 0; i < array->nr; i++) {
+			struct ref_array_item *item = array->items[i];
+			add_pending_object(&revs, &item->commit->object, item->refname);
+		}
 
-	filter->merge_commit->object.flags |= UNINTERESTING;
-	add_pending_object(&revs, &filter->merge_commit->object, "");
+		filter->merge_commit->object.flags |= UNINTERESTING;
+		add_pending_object(&revs, &filter->merge_commit->object, "");
 
-	revs.limited = 1;
-	if (prepare_revision_walk(&revs))
-		die(_("revision walk setup failed"));
+		revs.limited = 1;
+		if (prepare_revision_walk(&revs))
+			die(_("revision walk setup failed"));
+	}
 
 	old_nr = array->nr;
 	array->nr = 0;
@@ -2084,9 +2127,6 @@ int filter_refs(struct ref_array *array, struct ref_filter *filter, unsigned int
 		broken = 1;
 	filter->kind = type & FILTER_REFS_KIND_MASK;
 
-	init_contains_cache(&ref_cbdata.contains_cache);
-	init_contains_cache(&ref_cbdata.no_contains_cache);
-
 	/*  Simple per-ref filtering */
 	if (!filter->kind)
 		die("filter_refs: invalid type");
@@ -2109,10 +2149,9 @@ int filter_refs(struct ref_array *array, struct ref_filter *filter, unsigned int
 			head_ref(ref_filter_handler, &ref_cbdata);
 	}
 
-	clear_contains_cache(&ref_cbdata.contains_cache);
-	clear_contains_cache(&ref_cbdata.no_contains_cache);
-
 	/*  Filters that need revision walking */
+	if (filter->with_commit || filter->no_commit)
+		do_contains_filter(&ref_cbdata);
 	if (filter->merge_commit)
 		do_merge_filter(&ref_cbdata);
 
@@ -16,6 +16,7 @@
 #include "worktree.h"
 #include "argv-array.h"
 #include "repository.h"
+#include "bulk-checkin.h"
 
 /*
  * List of all available backends
@@ -1978,6 +1979,9 @@ int ref_transaction_commit(struct ref_transaction *transaction,
 	struct ref_store *refs = transaction->ref_store;
 	int ret;
 
+	/* the objects the refs point at have to be in place first */
+	flush_bulk_checkin();
+
 	switch (transaction->state) {
 	case REF_TRANSACTION_OPEN:
 		/* Need to prepare first. */
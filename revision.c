@@ -63,7 +63,8 @@ static void mark_tree_contents_uninteresting(struct repository *r,
 	if (parse_tree_gently(tree, 1) < 0)
 		return;
 
-	init_tree_desc(&desc, tree->buffer, tree->size);
+	init_tree_desc_cached(&desc, &tree->object.oid,
+			      tree->buffer, tree->size);
 	while (tree_entry(&desc, &entry)) {
 		switch (object_type(entry.mode)) {
 		case OBJ_TREE:
@@ -321,10 +322,10 @@ static struct commit *handle_commit(struct rev_info *revs,
 	die("%s is unknown object", name);
 }
 
-static int everybody_uninteresting(struct commit_list *orig,
+static int everybody_uninteresting(struct prio_queue *queue,
 				   struct commit **interesting_cache)
 {
-	struct commit_list *list = orig;
+	int i;
 
 	if (*interesting_cache) {
 		struct commit *commit = *interesting_cache;
@@ -332,9 +333,8 @@ static int everybody_uninteresting(struct commit_list *orig,
 			return 0;
 	}
 
-	while (list) {
-		struct commit *commit = list->item;
-		list = list->next;
+	for (i = 0; i < queue->nr; i++) {
+		struct commit *commit = queue->array[i].data;
 		if (commit->object.flags & UNINTERESTING)
 			continue;
 
@@ -755,26 +755,11 @@ static void try_to_simplify_commit(struct rev_info *revs, struct commit *commit)
 		commit->object.flags |= TREESAME;
 }
 
-static void commit_list_insert_by_date_cached(struct commit *p, struct commit_list **head,
-		    struct commit_list *cached_base, struct commit_list **cache)
-{
-	struct commit_list *new_entry;
-
-	if (cached_base && p->date < cached_base->item->date)
-		new_entry = commit_list_insert_by_date(p, &cached_base->next);
-	else
-		new_entry = commit_list_insert_by_date(p, head);
-
-	if (cache && (!*cache || p->date < (*cache)->item->date))
-		*cache = new_entry;
-}
-
 static int process_parents(struct rev_info *revs, struct commit *commit,
-			   struct commit_list **list, struct commit_list **cache_ptr)
+			   struct prio_queue *queue)
 {
 	struct commit_list *parent = commit->parents;
 	unsigned left_flag;
-	struct commit_list *cached_base = cache_ptr ? *cache_ptr : NULL;
 
 	if (commit->object.flags & ADDED)
 		return 0;
@@ -809,8 +794,8 @@ static int process_parents(struct rev_info *revs, struct commit *commit,
 			if (p->object.flags & SEEN)
 				continue;
 			p->object.flags |= SEEN;
-			if (list)
-				commit_list_insert_by_date_cached(p, list, cached_base, cache_ptr);
+			if (queue)
+				prio_queue_put(queue, p);
 		}
 		return 0;
 	}
@@ -849,8 +834,8 @@ static int process_parents(struct rev_info *revs, struct commit *commit,
 		p->object.flags |= left_flag;
 		if (!(p->object.flags & SEEN)) {
 			p->object.flags |= SEEN;
-			if (list)
-				commit_list_insert_by_date_cached(p, list, cached_base, cache_ptr);
+			if (queue)
+				prio_queue_put(queue, p);
 		}
 		if (revs->first_parent_only)
 			break;
@@ -937,20 +922,22 @@ static void cherry_pick_list(struct commit_list *list, struct rev_info *revs)
 /* How many extra uninteresting commits we want to see.. */
 #define SLOP 5
 
-static int still_interesting(struct commit_list *src, timestamp_t date, int slop,
+static int still_interesting(struct prio_queue *src, timestamp_t date, int slop,
 			     struct commit **interesting_cache)
 {
+	struct commit *next = prio_queue_peek(src);
+
 	/*
 	 * No source list at all? We're definitely done..
 	 */
-	if (!src)
+	if (!next)
 		return 0;
 
 	/*
 	 * Does the destination list contain entries with a date
 	 * before the source list? Definitely _not_ done.
 	 */
-	if (date <= src->item->date)
+	if (date <= next->date)
 		return SLOP;
 
 	/*
@@ -1072,20 +1059,24 @@ static int limit_list(struct rev_info *revs)
 {
 	int slop = SLOP;
 	timestamp_t date = TIME_MAX;
-	struct commit_list *list = revs->commits;
+	struct prio_queue queue = { compare_commits_by_commit_date };
+	struct commit_list *list;
 	struct commit_list *newlist = NULL;
 	struct commit_list **p = &newlist;
 	struct commit_list *bottom = NULL;
 	struct commit *interesting_cache = NULL;
+	struct commit *commit;
 
 	if (revs->ancestry_path) {
-		bottom = collect_bottom_commits(list);
+		bottom = collect_bottom_commits(revs->commits);
 		if (!bottom)
 			die("--ancestry-path given but there are no bottom commits");
 	}
 
-	while (list) {
-		struct commit *commit = pop_commit(&list);
+	while (revs->commits)
+		prio_queue_put(&queue, pop_commit(&revs->commits));
+
+	while ((commit = prio_queue_get(&queue))) {
 		struct object *obj = &commit->object;
 		show_early_output_fn_t show;
 
@@ -1094,11 +1085,13 @@ static int limit_list(struct rev_info *revs)
 
 		if (revs->max_age != -1 && (commit->date < revs->max_age))
 			obj->flags |= UNINTERESTING;
-		if (process_parents(revs, commit, &list, NULL) < 0)
+		if (process_parents(revs, commit, &queue) < 0) {
+			clear_prio_queue(&queue);
 			return -1;
+		}
 		if (obj->flags & UNINTERESTING) {
 			mark_parents_uninteresting(commit);
-			slop = still_interesting(list, date, slop, &interesting_cache);
+			slop = still_interesting(&queue, date, slop, &interesting_cache);
 			if (slop)
 				continue;
 			break;
@@ -1115,6 +1108,7 @@ static int limit_list(struct rev_info *revs)
 		show(revs, newlist);
 		show_early_output = NULL;
 	}
+	clear_prio_queue(&queue);
 	if (revs->cherry_pick || revs->cherry_mark)
 		cherry_pick_list(newlist, revs);
 
@@ -1460,6 +1454,7 @@ void repo_init_revisions(struct repository *r,
 	memset(revs, 0, sizeof(*revs));
 
 	revs->repo = r;
+	revs->commit_queue.compare = compare_commits_by_commit_date;
 	revs->abbrev = DEFAULT_ABBREV;
 	revs->ignore_merges = 1;
 	revs->simplify_history = 1;
@@ -2915,7 +2910,7 @@ define_commit_slab(indegree_slab, int);
 define_commit_slab(author_date_slab, timestamp_t);
 
 struct topo_walk_info {
-	uint32_t min_generation;
+	timestamp_t min_generation;
 	struct prio_queue explore_queue;
 	struct prio_queue indegree_queue;
 	struct prio_queue topo_queue;
@@ -2950,7 +2945,7 @@ static void explore_walk_step(struct rev_info *revs)
 	if (revs->max_age != -1 && (c->date < revs->max_age))
 		c->object.flags |= UNINTERESTING;
 
-	if (process_parents(revs, c, NULL, NULL) < 0)
+	if (process_parents(revs, c, NULL) < 0)
 		return;
 
 	if (c->object.flags & UNINTERESTING)
@@ -2961,7 +2956,7 @@ static void explore_walk_step(struct rev_info *revs)
 }
 
 static void explore_to_depth(struct rev_info *revs,
-			     uint32_t gen_cutoff)
+			     timestamp_t gen_cutoff)
 {
 	struct topo_walk_info *info = revs->topo_walk_info;
 	struct commit *c;
@@ -3001,7 +2996,7 @@ static void indegree_walk_step(struct rev_info *revs)
 }
 
 static void compute_indegrees_to_depth(struct rev_info *revs,
-				       uint32_t gen_cutoff)
+				       timestamp_t gen_cutoff)
 {
 	struct topo_walk_info *info = revs->topo_walk_info;
 	struct commit *c;
@@ -3089,15 +3084,24 @@ static struct commit *next_topo_commit(struct rev_info *revs)
 	return c;
 }
 
+static void report_missing_parents(struct rev_info *revs, struct commit *commit)
+{
+	if (revs->ignore_missing_links)
+		return;
+	if (!revs->do_not_die_on_missing_parents)
+		die("Failed to traverse parents of commit %s",
+		    oid_to_hex(&commit->object.oid));
+	error("Failed to traverse parents of commit %s",
+	      oid_to_hex(&commit->object.oid));
+	revs->missing_parents++;
+}
+
 static void expand_topo_walk(struct rev_info *revs, struct commit *commit)
 {
 	struct commit_list *p;
 	struct topo_walk_info *info = revs->topo_walk_info;
-	if (process_parents(revs, commit, NULL, NULL) < 0) {
-		if (!revs->ignore_missing_links)
-			die("Failed to traverse parents of commit %s",
-			    oid_to_hex(&commit->object.oid));
-	}
+	if (process_parents(revs, commit, NULL) < 0)
+		report_missing_parents(revs, commit);
 
 	for (p = commit->parents; p; p = p->next) {
 		struct commit *parent = p->item;
@@ -3128,6 +3132,8 @@ int prepare_revision_walk(struct rev_info *revs)
 	struct object_array old_pending;
 	struct commit_list **next = &revs->commits;
 
+	clear_prio_queue(&revs->commit_queue);
+
 	memcpy(&old_pending, &revs->pending, sizeof(old_pending));
 	revs->pending.nr = 0;
 	revs->pending.alloc = 0;
@@ -3176,12 +3182,10 @@ int prepare_revision_walk(struct rev_info *revs)
 
 static enum rewrite_result rewrite_one(struct rev_info *revs, struct commit **pp)
 {
-	struct commit_list *cache = NULL;
-
 	for (;;) {
 		struct commit *p = *pp;
 		if (!revs->limited)
-			if (process_parents(revs, p, &revs->commits, &cache) < 0)
+			if (process_parents(revs, p, &revs->commit_queue) < 0)
 				return rewrite_one_error;
 		if (p->object.flags & UNINTERESTING)
 			return rewrite_one_ok;
@@ -3482,6 +3486,18 @@ static void track_linear(struct rev_info *revs, struct commit *commit)
 	revs->previous_parents = copy_commit_list(commit->parents);
 }
 
+/*
+ * The commits on revs->commits (normally the starting points, sorted by
+ * prepare_revision_walk()) join the queue the first time we look at it,
+ * so that callers can still inspect and adjust the list until then.
+ */
+static struct commit *next_queued_commit(struct rev_info *revs)
+{
+	while (revs->commits)
+		prio_queue_put(&revs->commit_queue, pop_commit(&revs->commits));
+	return prio_queue_get(&revs->commit_queue);
+}
+
 static struct commit *get_revision_1(struct rev_info *revs)
 {
 	while (1) {
@@ -3491,8 +3507,10 @@ static struct commit *get_revision_1(struct rev_info *revs)
 			commit = next_reflog_entry(revs->reflog_info);
 		else if (revs->topo_walk_info)
 			commit = next_topo_commit(revs);
-		else
+		else if (revs->limited || revs->no_walk)
 			commit = pop_commit(&revs->commits);
+		else
+			commit = next_queued_commit(revs);
 
 		if (!commit)
 			return NULL;
@@ -3514,11 +3532,8 @@ static struct commit *get_revision_1(struct rev_info *revs)
 				try_to_simplify_commit(revs, commit);
 			else if (revs->topo_walk_info)
 				expand_topo_walk(revs, commit);
-			else if (process_parents(revs, commit, &revs->commits, NULL) < 0) {
-				if (!revs->ignore_missing_links)
-					die("Failed to traverse parents of commit %s",
-						oid_to_hex(&commit->object.oid));
-			}
+			else if (process_parents(revs, commit, &revs->commit_queue) < 0)
+				report_missing_parents(revs, commit);
 		}
 
 		switch (simplify_commit(revs, commit)) {
@@ -3571,6 +3586,7 @@ static void create_boundary_commit_list(struct rev_info *revs)
 		free_commit_list(revs->commits);
 		revs->commits = NULL;
 	}
+	clear_prio_queue(&revs->commit_queue);
 
 	/*
 	 * Put all of the actual boundary commits from revs->boundary_commits
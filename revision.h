@@ -8,6 +8,7 @@
 #include "pretty.h"
 #include "diff.h"
 #include "commit-slab-decl.h"
+#include "prio-queue.h"
 
 /* Remember to update object flag allocation in object.h */
 #define SEEN		(1u<<0)
@@ -72,6 +73,12 @@ struct topo_walk_info;
 struct rev_info {
 	/* Starting list */
 	struct commit_list *commits;
+
+	/*
+	 * Commits still to be walked in a non-limited walk, by date;
+	 * get_revision() moves "commits" over here as it goes.
+	 */
+	struct prio_queue commit_queue;
 	struct object_array pending;
 	struct repository *repo;
 
@@ -108,6 +115,7 @@ struct rev_info {
 
 	unsigned int	ignore_missing:1,
 			ignore_missing_links:1;
+	unsigned int missing_parents;
 
 	/* Traversal flags */
 	unsigned int	dense:1,
@@ -160,6 +168,13 @@ struct rev_info {
 			 */
 			do_not_die_on_missing_tree:1,
 
+			/*
+			 * Report commits whose parents cannot be read with
+			 * error() and count them in "missing_parents",
+			 * instead of dying.
+			 */
+			do_not_die_on_missing_parents:1,
+
 			/* for internal use only */
 			allow_exclude_promisor_objects_opt:1,
 			exclude_promisor_objects:1;
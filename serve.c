@@ -1,6 +1,7 @@
 #include "cache.h"
 #include "repository.h"
 #include "config.h"
+#include "object.h"
 #include "pkt-line.h"
 #include "version.h"
 #include "argv-array.h"
@@ -222,7 +223,15 @@ static int process_request(void)
 	if (!command)
 		die("no command requested");
 
+	/*
+	 * Commands do not share parsed objects, so do not let them pile
+	 * up over a long session.  None of them keeps an object pointer
+	 * past its return: ls_refs() only deals in object names, and
+	 * upload_pack_v2() clears its object arrays.
+	 */
+	begin_object_scope(the_repository);
 	command->command(the_repository, &keys, &reader);
+	end_object_scope(the_repository);
 
 	argv_array_clear(&keys);
 	return 0;
@@ -439,7 +439,17 @@ static int check_repo_format(const char *var, const char *value, void *vdata)
 			data->partial_clone = xstrdup(value);
 		} else if (!strcmp(ext, "worktreeconfig"))
 			data->worktree_config = git_config_bool(var, value);
-		else
+		else if (!strcmp(ext, "objectcompression")) {
+			enum git_zcodec codec;
+
+			if (!value)
+				return config_error_nonbool(var);
+			codec = git_zcodec_from_name(value);
+			if (git_zcodec_supported(codec))
+				data->object_compression = codec;
+			else
+				string_list_append(&data->unknown_extensions, ext);
+		} else
 			string_list_append(&data->unknown_extensions, ext);
 	}
 
@@ -478,6 +488,7 @@ static int check_repository_format_gently(const char *gitdir, struct repository_
 	repository_format_precious_objects = candidate->precious_objects;
 	repository_format_partial_clone = candidate->partial_clone;
 	repository_format_worktree_config = candidate->worktree_config;
+	repository_format_object_compression = candidate->object_compression;
 	string_list_clear(&candidate->unknown_extensions, 0);
 
 	if (repository_format_worktree_config) {
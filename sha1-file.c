@@ -707,6 +707,193 @@ void prepare_alt_odb(struct repository *r)
 	read_info_alternates(r, r->objects->objectdir, 0);
 }
 
+static int append_loose_object(const struct object_id *oid, const char *path,
+			       void *data)
+{
+	oid_array_append(data, oid);
+	return 0;
+}
+
+/*
+ * Make sure "cache" has an up-to-date listing of subdirectory
+ * "subdir_nr" of the object directory in "objdir"; returns 0 if that
+ * is not possible right now.
+ */
+static int refresh_loose_cache(struct raw_object_store *o,
+			       struct loose_object_cache *cache,
+			       struct strbuf *objdir, int subdir_nr,
+			       time_t now)
+{
+	struct cache_time mtime = { 0, 0 };
+	struct stat st;
+	size_t len = objdir->len;
+
+	strbuf_complete(objdir, '/');
+	strbuf_addf(objdir, "%02x", subdir_nr);
+	if (!stat(objdir->buf, &st)) {
+		mtime.sec = st.st_mtime;
+		mtime.nsec = ST_MTIME_NSEC(st);
+	} else if (errno != ENOENT) {
+		strbuf_setlen(objdir, len);
+		return 0;
+	}
+	strbuf_setlen(objdir, len);
+
+	if (cache->generation[subdir_nr] &&
+	    cache->mtime[subdir_nr].sec == mtime.sec &&
+	    cache->mtime[subdir_nr].nsec == mtime.nsec) {
+		cache->generation[subdir_nr] = o->loose_cache_generation;
+		cache->checked[subdir_nr] = now;
+		return 1;
+	}
+
+	cache->generation[subdir_nr] = 0;
+	oid_array_clear(&cache->subdir[subdir_nr]);
+	if (mtime.sec >= now - 1)
+		return 0;
+	if (mtime.sec &&
+	    for_each_file_in_obj_subdir(subdir_nr, objdir, append_loose_object,
+					NULL, NULL, &cache->subdir[subdir_nr])) {
+		oid_array_clear(&cache->subdir[subdir_nr]);
+		return 0;
+	}
+	cache->mtime[subdir_nr] = mtime;
+	cache->generation[subdir_nr] = o->loose_cache_generation;
+	cache->checked[subdir_nr] = now;
+	return 1;
+}
+
+static struct oid_array *loose_cache_subdir(struct raw_object_store *o,
+					    struct loose_object_cache *cache,
+					    struct strbuf *objdir,
+					    int subdir_nr)
+{
+	time_t now = time(NULL);
+
+	/* 0 marks a subdirectory we have not read */
+	if (!o->loose_cache_generation)
+		o->loose_cache_generation = 1;
+	/*
+	 * OBJECT_INFO_QUICK lookups never reprepare, so also look at the
+	 * mtime again once a second; otherwise an object another process
+	 * wrote into a subdirectory we have listed would stay hidden from
+	 * them for as long as we run.
+	 */
+	if ((cache->generation[subdir_nr] != o->loose_cache_generation ||
+	     cache->checked[subdir_nr] != now) &&
+	    !refresh_loose_cache(o, cache, objdir, subdir_nr, now))
+		return NULL;
+	return &cache->subdir[subdir_nr];
+}
+
+/* a lone lookup is cheaper than reading the directory it would be in */
+#define LOOSE_CACHE_MIN_PROBES 16
+
+/*
+ * Returns 1 if "oid" is known not to be a loose object in the object
+ * directory in "objdir", 0 if it may be one. Only the negative answer
+ * is trusted; the file may have been pruned since we listed it.
+ */
+static int loose_object_known_missing(struct raw_object_store *o,
+				      struct loose_object_cache *cache,
+				      struct strbuf *objdir,
+				      const struct object_id *oid)
+{
+	int subdir_nr = oid->hash[0];
+	struct oid_array *subdir;
+
+	if (!cache->generation[subdir_nr] &&
+	    cache->probes < LOOSE_CACHE_MIN_PROBES) {
+		cache->probes++;
+		return 0;
+	}
+	subdir = loose_cache_subdir(o, cache, objdir, subdir_nr);
+	return subdir && oid_array_lookup(subdir, oid) < 0;
+}
+
+/* Tell the cache about a loose object we have just written ourselves. */
+static void note_loose_object(struct repository *r, const struct object_id *oid)
+{
+	struct loose_object_cache *cache = r->objects->loose_objects;
+	struct oid_array *subdir;
+	int pos;
+
+	if (!cache || !cache->generation[oid->hash[0]])
+		return;
+
+	/* keep the listing sorted, rather than sorting it all again */
+	subdir = &cache->subdir[oid->hash[0]];
+	pos = oid_array_lookup(subdir, oid);
+	if (pos >= 0)
+		return;
+	pos = -pos - 1;
+	ALLOC_GROW(subdir->oid, subdir->nr + 1, subdir->alloc);
+	MOVE_ARRAY(subdir->oid + pos + 1, subdir->oid + pos, subdir->nr - pos);
+	oidcpy(&subdir->oid[pos], oid);
+	subdir->nr++;
+}
+
+static struct loose_object_cache *local_loose_cache(struct repository *r,
+						    struct strbuf **objdir)
+{
+	static struct strbuf buf = STRBUF_INIT;
+
+	if (!r->objects->loose_objects)
+		r->objects->loose_objects = xcalloc(1, sizeof(struct loose_object_cache));
+	strbuf_reset(&buf);
+	strbuf_addstr(&buf, r->objects->objectdir);
+	*objdir = &buf;
+	return r->objects->loose_objects;
+}
+
+static int local_loose_known_missing(struct repository *r,
+				     const unsigned char *sha1)
+{
+	struct loose_object_cache *cache;
+	struct strbuf *objdir;
+	struct object_id oid;
+
+	hashcpy(oid.hash, sha1);
+	cache = local_loose_cache(r, &objdir);
+	return loose_object_known_missing(r->objects, cache, objdir, &oid);
+}
+
+static int alt_loose_known_missing(struct repository *r,
+				   struct alternate_object_database *alt,
+				   const unsigned char *sha1)
+{
+	struct object_id oid;
+
+	hashcpy(oid.hash, sha1);
+	return loose_object_known_missing(r->objects, &alt->loose_objects,
+					  alt_scratch_buf(alt), &oid);
+}
+
+void clear_loose_object_cache(struct loose_object_cache *cache)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cache->subdir); i++)
+		oid_array_clear(&cache->subdir[i]);
+	memset(cache, 0, sizeof(*cache));
+}
+
+struct oid_array *odb_loose_cache(struct repository *r,
+				  struct alternate_object_database *alt,
+				  int subdir_nr)
+{
+	struct loose_object_cache *cache;
+	struct strbuf *objdir;
+
+	if (alt) {
+		cache = &alt->loose_objects;
+		objdir = alt_scratch_buf(alt);
+	} else {
+		cache = local_loose_cache(r, &objdir);
+	}
+	return loose_cache_subdir(r->objects, cache, objdir, subdir_nr);
+}
+
 /* Returns 1 if we have successfully freshened the file, 0 otherwise. */
 static int freshen_file(const char *fn)
 {
@@ -735,6 +922,9 @@ static int check_and_freshen_local(const struct object_id *oid, int freshen)
 {
 	static struct strbuf buf = STRBUF_INIT;
 
+	if (local_loose_known_missing(the_repository, oid->hash))
+		return 0;
+
 	strbuf_reset(&buf);
 	sha1_file_name(the_repository, &buf, oid->hash);
 
@@ -746,7 +936,10 @@ static int check_and_freshen_nonlocal(const struct object_id *oid, int freshen)
 	struct alternate_object_database *alt;
 	prepare_alt_odb(the_repository);
 	for (alt = the_repository->objects->alt_odb_list; alt; alt = alt->next) {
-		const char *path = alt_sha1_path(alt, oid->hash);
+		const char *path;
+		if (alt_loose_known_missing(the_repository, alt, oid->hash))
+			continue;
+		path = alt_sha1_path(alt, oid->hash);
 		if (check_and_freshen_file(path, freshen))
 			return 1;
 	}
@@ -900,12 +1093,14 @@ static int stat_sha1_file(struct repository *r, const unsigned char *sha1,
 	sha1_file_name(r, &buf, sha1);
 	*path = buf.buf;
 
-	if (!lstat(*path, st))
+	if (!local_loose_known_missing(r, sha1) && !lstat(*path, st))
 		return 0;
 
 	prepare_alt_odb(r);
 	errno = ENOENT;
 	for (alt = r->objects->alt_odb_list; alt; alt = alt->next) {
+		if (alt_loose_known_missing(r, alt, sha1))
+			continue;
 		*path = alt_sha1_path(alt, sha1);
 		if (!lstat(*path, st))
 			return 0;
@@ -930,13 +1125,20 @@ static int open_sha1_file(struct repository *r,
 	sha1_file_name(r, &buf, sha1);
 	*path = buf.buf;
 
-	fd = git_open(*path);
+	if (local_loose_known_missing(r, sha1)) {
+		fd = -1;
+		errno = ENOENT;
+	} else {
+		fd = git_open(*path);
+	}
 	if (fd >= 0)
 		return fd;
 	most_interesting_errno = errno;
 
 	prepare_alt_odb(r);
 	for (alt = r->objects->alt_odb_list; alt; alt = alt->next) {
+		if (alt_loose_known_missing(r, alt, sha1))
+			continue;
 		*path = alt_sha1_path(alt, sha1);
 		fd = git_open(*path);
 		if (fd >= 0)
@@ -1079,10 +1281,13 @@ static void *unpack_sha1_rest(git_zstream *stream, void *buffer, unsigned long s
 		 * we also want to check that zlib tells us that all
 		 * went well with status == Z_STREAM_END at the end.
 		 */
+		int depth = obj_read_release();
+
 		stream->next_out = buf + bytes;
 		stream->avail_out = size - bytes;
 		while (status == Z_OK)
 			status = git_inflate(stream, Z_FINISH);
+		obj_read_reacquire(depth);
 	}
 	if (status == Z_STREAM_END && !stream->avail_in) {
 		git_inflate_end(stream);
@@ -1250,10 +1455,120 @@ static int sha1_loose_object_info(struct repository *r,
 	return (status < 0) ? status : 0;
 }
 
+int obj_read_use_lock;
+static pthread_mutex_t obj_read_mutex;
+/*
+ * How many times the calling thread holds obj_read_mutex, and how many
+ * of those were taken with obj_read_lock() rather than by the object
+ * reading functions themselves.
+ */
+static pthread_key_t obj_read_depth_key;
+static pthread_key_t obj_read_pinned_key;
+
+static int obj_read_depth(void)
+{
+	return (int)(intptr_t)pthread_getspecific(obj_read_depth_key);
+}
+
+static void set_obj_read_depth(int depth)
+{
+	pthread_setspecific(obj_read_depth_key, (void *)(intptr_t)depth);
+}
+
+static int obj_read_pinned(void)
+{
+	return (int)(intptr_t)pthread_getspecific(obj_read_pinned_key);
+}
+
+static void set_obj_read_pinned(int pinned)
+{
+	pthread_setspecific(obj_read_pinned_key, (void *)(intptr_t)pinned);
+}
+
+void enable_obj_read_lock(void)
+{
+	if (!HAVE_THREADS || obj_read_use_lock)
+		return;
+	init_recursive_mutex(&obj_read_mutex);
+	pthread_key_create(&obj_read_depth_key, NULL);
+	pthread_key_create(&obj_read_pinned_key, NULL);
+	obj_read_use_lock = 1;
+}
+
+void disable_obj_read_lock(void)
+{
+	if (!obj_read_use_lock)
+		return;
+	obj_read_use_lock = 0;
+	pthread_key_delete(obj_read_depth_key);
+	pthread_key_delete(obj_read_pinned_key);
+	pthread_mutex_destroy(&obj_read_mutex);
+}
+
+/* Taken by the object reading functions, which may let go of it. */
+static void obj_read_enter(void)
+{
+	if (!obj_read_use_lock)
+		return;
+	pthread_mutex_lock(&obj_read_mutex);
+	set_obj_read_depth(obj_read_depth() + 1);
+}
+
+static void obj_read_leave(void)
+{
+	if (!obj_read_use_lock)
+		return;
+	set_obj_read_depth(obj_read_depth() - 1);
+	pthread_mutex_unlock(&obj_read_mutex);
+}
+
+void obj_read_lock_1(void)
+{
+	pthread_mutex_lock(&obj_read_mutex);
+	set_obj_read_depth(obj_read_depth() + 1);
+	set_obj_read_pinned(obj_read_pinned() + 1);
+}
+
+void obj_read_unlock_1(void)
+{
+	set_obj_read_pinned(obj_read_pinned() - 1);
+	set_obj_read_depth(obj_read_depth() - 1);
+	pthread_mutex_unlock(&obj_read_mutex);
+}
+
+int obj_read_release(void)
+{
+	int i, depth;
+
+	/*
+	 * A caller that took the lock with obj_read_lock() relies on it
+	 * for more than the object store; keep it all the way through.
+	 */
+	if (!obj_read_use_lock || obj_read_pinned())
+		return 0;
+	depth = obj_read_depth();
+	set_obj_read_depth(0);
+	for (i = 0; i < depth; i++)
+		pthread_mutex_unlock(&obj_read_mutex);
+	return depth;
+}
+
+void obj_read_reacquire(int depth)
+{
+	int i;
+
+	if (!depth)
+		return;
+	for (i = 0; i < depth; i++)
+		pthread_mutex_lock(&obj_read_mutex);
+	set_obj_read_depth(depth);
+}
+
 int fetch_if_missing = 1;
 
-int oid_object_info_extended(struct repository *r, const struct object_id *oid,
-			     struct object_info *oi, unsigned flags)
+static int do_oid_object_info_extended(struct repository *r,
+				       const struct object_id *oid,
+				       struct object_info *oi, unsigned flags)
 {
 	static struct object_info blank_oi = OBJECT_INFO_INIT;
 	struct pack_entry e;
@@ -1301,11 +1616,28 @@ int oid_object_info_extended(struct repository *r, const struct object_id *oid,
 		if (!sha1_loose_object_info(r, real->hash, oi, flags))
 			return 0;
 
-		/* Not a loose object; someone else may have just packed it. */
+		/*
+		 * Or one we have yet to finish writing to a pack; if the
+		 * caller wants more than to know it exists, finish the
+		 * pack and look again.
+		 */
+		if (r == the_repository && bulk_checkin_has_object(real)) {
+			if (oi == &blank_oi)
+				return 0;
+			flush_bulk_checkin();
+			continue;
+		}
+
+		/*
+		 * Not a loose object; someone else may have just packed it,
+		 * or written it after we last listed its directory.
+		 */
 		if (!(flags & OBJECT_INFO_QUICK)) {
 			reprepare_packed_git(r);
 			if (find_pack_entry(r, real, &e))
 				break;
+			if (!sha1_loose_object_info(r, real->hash, oi, flags))
+				return 0;
 		}
 
 		/* Check if it is a missing object */
@@ -1334,7 +1666,7 @@ int oid_object_info_extended(struct repository *r, const struct object_id *oid,
 	rtype = packed_object_info(r, e.p, e.offset, oi);
 	if (rtype < 0) {
 		mark_bad_packed_object(e.p, real->hash);
-		return oid_object_info_extended(r, real, oi, 0);
+		return do_oid_object_info_extended(r, real, oi, 0);
 	} else if (oi->whence == OI_PACKED) {
 		oi->u.packed.offset = e.offset;
 		oi->u.packed.pack = e.p;
@@ -1345,6 +1677,17 @@ int oid_object_info_extended(struct repository *r, const struct object_id *oid,
 	return 0;
 }
 
+int oid_object_info_extended(struct repository *r, const struct object_id *oid,
+			     struct object_info *oi, unsigned flags)
+{
+	int ret;
+
+	obj_read_enter();
+	ret = do_oid_object_info_extended(r, oid, oi, flags);
+	obj_read_leave();
+	return ret;
+}
+
 /* returns enum object_type or negative */
 int oid_object_info(struct repository *r,
 		    const struct object_id *oid,
@@ -1410,14 +1753,18 @@ void *read_object_file_extended(const struct object_id *oid,
 	const struct packed_git *p;
 	const char *path;
 	struct stat st;
-	const struct object_id *repl = lookup_replace ?
-		lookup_replace_object(the_repository, oid) : oid;
+	const struct object_id *repl;
+
+	obj_read_enter();
+	repl = lookup_replace ? lookup_replace_object(the_repository, oid) : oid;
+	obj_read_leave();
 
 	errno = 0;
 	data = read_object(repl->hash, type, size);
 	if (data)
 		return data;
 
+	obj_read_enter();
 	if (errno && errno != ENOENT)
 		die_errno(_("failed to read object %s"), oid_to_hex(oid));
 
@@ -1433,6 +1780,7 @@ void *read_object_file_extended(const struct object_id *oid,
 	if ((p = has_packed_and_bad(repl->hash)) != NULL)
 		die(_("packed object %s (stored in %s) is corrupt"),
 		    oid_to_hex(repl), p->pack_name);
+	obj_read_leave();
 
 	return NULL;
 }
@@ -1560,10 +1908,13 @@ int hash_object_file(const void *buf, unsigned long len, const char *type,
 	return 0;
 }
 
-/* Finalize a file on disk, and close it. */
-static void close_sha1_file(int fd)
+/*
+ * Finalize a file on disk, and close it.  A "staged" file is synced
+ * later together with the rest of its batch (see bulk-checkin.h).
+ */
+static void close_sha1_file(int fd, int staged)
 {
-	if (fsync_object_files)
+	if (fsync_object_files && !staged)
 		fsync_or_die(fd, "sha1 file");
 	if (close(fd) != 0)
 		die_errno(_("error when closing sha1 file"));
@@ -1623,22 +1974,35 @@ static int write_loose_object(const struct object_id *oid, char *hdr,
 	git_zstream stream;
 	git_hash_ctx c;
 	struct object_id parano_oid;
-	static struct strbuf tmp_file = STRBUF_INIT;
-	static struct strbuf filename = STRBUF_INIT;
-
-	strbuf_reset(&filename);
-	sha1_file_name(the_repository, &filename, oid->hash);
+	struct strbuf tmp_file = STRBUF_INIT;
+	struct strbuf filename = STRBUF_INIT;
+	const char *staging_dir = NULL;
+
+	if (fsync_object_files == FSYNC_OBJECT_FILES_BATCH) {
+		obj_read_lock();
+		staging_dir = bulk_checkin_staging_dir();
+		obj_read_unlock();
+	}
+	if (staging_dir) {
+		strbuf_addf(&filename, "%s/", staging_dir);
+		fill_sha1_path(&filename, oid->hash);
+	} else {
+		sha1_file_name(the_repository, &filename, oid->hash);
+	}
 
 	fd = create_tmpfile(&tmp_file, filename.buf);
 	if (fd < 0) {
 		if (errno == EACCES)
-			return error(_("insufficient permission for adding an object to repository database %s"), get_object_directory());
+			ret = error(_("insufficient permission for adding an object to repository database %s"), get_object_directory());
 		else
-			return error_errno(_("unable to create temporary file"));
+			ret = error_errno(_("unable to create temporary file"));
+		goto out;
 	}
 
 	/* Set it up */
-	git_deflate_init(&stream, zlib_compression_level);
+	git_deflate_init_codec(&stream, zlib_compression_level,
+			       repository_format_object_compression);
+	git_deflate_set_size(&stream, hdrlen + len);
 	stream.next_out = compressed;
 	stream.avail_out = sizeof(compressed);
 	the_hash_algo->init_fn(&c);
@@ -1675,7 +2039,7 @@ static int write_loose_object(const struct object_id *oid, char *hdr,
 		die(_("confused by unstable object source data for %s"),
 		    oid_to_hex(oid));
 
-	close_sha1_file(fd);
+	close_sha1_file(fd, !!staging_dir);
 
 	if (mtime) {
 		struct utimbuf utb;
@@ -1685,7 +2049,16 @@ static int write_loose_object(const struct object_id *oid, char *hdr,
 			warning_errno(_("failed utime() on %s"), tmp_file.buf);
 	}
 
-	return finalize_object_file(tmp_file.buf, filename.buf);
+	ret = finalize_object_file(tmp_file.buf, filename.buf);
+	if (!ret && !staging_dir) {
+		obj_read_lock();
+		note_loose_object(the_repository, oid);
+		obj_read_unlock();
+	}
+out:
+	strbuf_release(&tmp_file);
+	strbuf_release(&filename);
+	return ret ? -1 : 0;
 }
 
 static int freshen_loose_object(const struct object_id *oid)
@@ -1710,13 +2083,19 @@ int write_object_file(const void *buf, unsigned long len, const char *type,
 		      struct object_id *oid)
 {
 	char hdr[MAX_HEADER_LEN];
-	int hdrlen = sizeof(hdr);
+	int hdrlen = sizeof(hdr), found;
 
 	/* Normally if we have it in the pack then we do not bother writing
 	 * it out into .git/objects/??/?{38} file.
 	 */
 	write_object_file_prepare(buf, len, type, oid, hdr, &hdrlen);
-	if (freshen_packed_object(oid) || freshen_loose_object(oid))
+	obj_read_lock();
+	found = freshen_packed_object(oid) || freshen_loose_object(oid);
+	if (!found && bulk_checkin_active())
+		found = !bulk_checkin_write_object(buf, len,
+						   type_from_string(type), oid);
+	obj_read_unlock();
+	if (found)
 		return 0;
 	return write_loose_object(oid, hdr, hdrlen, buf, len, 0);
 }
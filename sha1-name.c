@@ -92,48 +92,49 @@ static int append_loose_object(const struct object_id *oid, const char *path,
 
 static int match_sha(unsigned, const unsigned char *, const unsigned char *);
 
-static void find_short_object_filename(struct disambiguate_state *ds)
+static void find_short_object_filename_in(struct disambiguate_state *ds,
+					  struct alternate_object_database *alt)
 {
 	int subdir_nr = ds->bin_pfx.hash[0];
-	struct alternate_object_database *alt;
-	static struct alternate_object_database *fakeent;
+	struct oid_array uncached = OID_ARRAY_INIT;
+	struct oid_array *loose;
+	int pos;
 
-	if (!fakeent) {
-		/*
-		 * Create a "fake" alternate object database that
-		 * points to our own object database, to make it
-		 * easier to get a temporary working space in
-		 * alt->name/alt->base while iterating over the
-		 * object databases including our own.
-		 */
-		fakeent = alloc_alt_odb(get_object_directory());
+	loose = odb_loose_cache(the_repository, alt, subdir_nr);
+	if (!loose) {
+		/* it is being written to; read it without caching */
+		struct strbuf buf = STRBUF_INIT;
+		strbuf_addstr(&buf, alt ? alt->path : get_object_directory());
+		for_each_file_in_obj_subdir(subdir_nr, &buf,
+					    append_loose_object,
+					    NULL, NULL, &uncached);
+		strbuf_release(&buf);
+		loose = &uncached;
 	}
-	fakeent->next = the_repository->objects->alt_odb_list;
 
-	for (alt = fakeent; alt && !ds->ambiguous; alt = alt->next) {
-		int pos;
+	pos = oid_array_lookup(loose, &ds->bin_pfx);
+	if (pos < 0)
+		pos = -1 - pos;
+	while (!ds->ambiguous && pos < loose->nr) {
+		const struct object_id *oid;
+		oid = loose->oid + pos;
+		if (!match_sha(ds->len, ds->bin_pfx.hash, oid->hash))
+			break;
+		update_candidates(ds, oid);
+		pos++;
+	}
+	oid_array_clear(&uncached);
+}
 
-		if (!alt->loose_objects_subdir_seen[subdir_nr]) {
-			struct strbuf *buf = alt_scratch_buf(alt);
-			for_each_file_in_obj_subdir(subdir_nr, buf,
-						    append_loose_object,
-						    NULL, NULL,
-						    &alt->loose_objects_cache);
-			alt->loose_objects_subdir_seen[subdir_nr] = 1;
-		}
+static void find_short_object_filename(struct disambiguate_state *ds)
+{
+	struct alternate_object_database *alt;
 
-		pos = oid_array_lookup(&alt->loose_objects_cache, &ds->bin_pfx);
-		if (pos < 0)
-			pos = -1 - pos;
-		while (!ds->ambiguous && pos < alt->loose_objects_cache.nr) {
-			const struct object_id *oid;
-			oid = alt->loose_objects_cache.oid + pos;
-			if (!match_sha(ds->len, ds->bin_pfx.hash, oid->hash))
-				break;
-			update_candidates(ds, oid);
-			pos++;
-		}
-	}
+	find_short_object_filename_in(ds, NULL);
+	for (alt = the_repository->objects->alt_odb_list;
+	     alt && !ds->ambiguous;
+	     alt = alt->next)
+		find_short_object_filename_in(ds, alt);
 }
 
 static int match_sha(unsigned len, const unsigned char *a, const unsigned char *b)
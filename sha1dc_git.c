@@ -1,4 +1,15 @@
 #include "cache.h"
+#include "config.h"
+#include "compat/sha1-hw.h"
+
+#if defined(HAVE_SHA1_HW) && !defined(DC_SHA1_EXTERNAL)
+#ifdef DC_SHA1_SUBMODULE
+#include "sha1collisiondetection/lib/ubc_check.h"
+#else
+#include "sha1dc/ubc_check.h"
+#endif
+#define SHA1DC_FAST_PATH 1
+#endif
 
 #ifdef DC_SHA1_EXTERNAL
 /*
@@ -22,12 +33,108 @@ void git_SHA1DCFinal(unsigned char hash[20], SHA1_CTX *ctx)
 	    sha1_to_hex(hash));
 }
 
+#ifdef SHA1DC_FAST_PATH
+/*
+ * sha1dc spends most of its time in a portable compression function
+ * that also records the intermediate states, which it only ever looks
+ * at for blocks whose expanded message meets the unavoidable bit
+ * conditions of some disturbance vector (ubc_check()).  For ordinary
+ * data that is a small minority of blocks, so we run ubc_check()
+ * ourselves, compress the blocks it clears with the SHA instructions,
+ * and hand only the others to sha1dc.  The result, including whether a
+ * collision attack is detected, is the same as sha1dc's.
+ */
+static int sha1_hw = -1;
+
+static int use_sha1_hw(void)
+{
+	/* racy, but every thread computes the same answer */
+	if (sha1_hw < 0)
+		sha1_hw = git_env_bool("GIT_TEST_SHA1_HW", 1) &&
+			  sha1_hw_available();
+	return sha1_hw;
+}
+
+static int block_needs_dc(const unsigned char *block)
+{
+	uint32_t W[80], dvmask[DVMASKSIZE] = { 0 };
+
+	sha1_hw_expand(block, W);
+	ubc_check(W, dvmask);
+	return dvmask[0] != 0;
+}
+
+/* Let sha1dc itself process one block, leaving ctx->total alone. */
+static void dc_process_block(SHA1_CTX *ctx, const unsigned char *block)
+{
+	char copy[64];
+	uint64_t total = ctx->total;
+
+	memcpy(copy, block, sizeof(copy));
+	ctx->total = 0;
+	SHA1DCUpdate(ctx, copy, sizeof(copy));
+	ctx->total = total;
+}
+
+static void process_blocks(SHA1_CTX *ctx, const unsigned char *data,
+			   size_t nblocks)
+{
+	size_t i, clean = 0;
+
+	for (i = 0; i < nblocks; i++) {
+		if (!block_needs_dc(data + 64 * i))
+			continue;
+		sha1_hw_compress(ctx->ihv, data + 64 * clean, i - clean);
+		dc_process_block(ctx, data + 64 * i);
+		clean = i + 1;
+	}
+	sha1_hw_compress(ctx->ihv, data + 64 * clean, nblocks - clean);
+}
+
+static void update_fast(SHA1_CTX *ctx, const char *data, size_t len)
+{
+	unsigned left = ctx->total & 63;
+	size_t nblocks;
+
+	if (left) {
+		unsigned fill = 64 - left;
+
+		if (len < fill) {
+			SHA1DCUpdate(ctx, data, len);
+			return;
+		}
+		memcpy(ctx->buffer + left, data, fill);
+		process_blocks(ctx, ctx->buffer, 1);
+		ctx->total += fill;
+		data += fill;
+		len -= fill;
+	}
+
+	nblocks = len / 64;
+	process_blocks(ctx, (const unsigned char *)data, nblocks);
+	ctx->total += 64 * nblocks;
+	data += 64 * nblocks;
+	len -= 64 * nblocks;
+
+	/* sha1dc keeps the tail in ctx->buffer for the next call */
+	if (len)
+		SHA1DCUpdate(ctx, data, len);
+}
+#endif
+
 /*
  * Same as SHA1DCUpdate, but adjust types to match git's usual interface.
  */
 void git_SHA1DCUpdate(SHA1_CTX *ctx, const void *vdata, unsigned long len)
 {
 	const char *data = vdata;
+
+#ifdef SHA1DC_FAST_PATH
+	if (ctx->detect_coll && ctx->ubc_check && use_sha1_hw()) {
+		update_fast(ctx, data, len);
+		return;
+	}
+#endif
 	/* We expect an unsigned long, but sha1dc only takes an int */
 	while (len > INT_MAX) {
 		SHA1DCUpdate(ctx, data, INT_MAX);
@@ -0,0 +1,60 @@
+#include "test-tool.h"
+#include "cache.h"
+#include "blob.h"
+#include "object-store.h"
+#include "run-command.h"
+
+/*
+ * Look objects up the way a long-running command would, while loose
+ * objects are written and pruned behind its back:
+ *
+ *   quick <oid>   look <oid> up with OBJECT_INFO_QUICK
+ *   write <text>  write a blob holding <text> and a newline ourselves
+ *   git <args>    have another git process do something
+ *   next-second   wait for the clock to move on to the next second
+ */
+int cmd__loose_cache(int argc, const char **argv)
+{
+	struct strbuf line = STRBUF_INIT;
+
+	setup_git_directory();
+
+	while (strbuf_getline(&line, stdin) != EOF) {
+		const char *arg;
+		struct object_id oid;
+
+		if (skip_prefix(line.buf, "quick ", &arg)) {
+			if (get_oid_hex(arg, &oid))
+				die("not a hexadecimal object name: %s", arg);
+			printf("%s %s\n", arg,
+			       oid_object_info_extended(the_repository, &oid, NULL,
+							OBJECT_INFO_QUICK) ?
+			       "missing" : "present");
+		} else if (skip_prefix(line.buf, "write ", &arg)) {
+			struct strbuf buf = STRBUF_INIT;
+
+			strbuf_addf(&buf, "%s\n", arg);
+			if (write_object_file(buf.buf, buf.len, blob_type, &oid))
+				die("unable to write '%s'", arg);
+			strbuf_release(&buf);
+		} else if (skip_prefix(line.buf, "git ", &arg)) {
+			struct child_process cp = CHILD_PROCESS_INIT;
+
+			argv_array_split(&cp.args, arg);
+			cp.git_cmd = 1;
+			cp.no_stdin = 1;
+			cp.no_stdout = 1;
+			if (run_command(&cp))
+				die("'git %s' failed", arg);
+		} else if (!strcmp(line.buf, "next-second")) {
+			time_t now = time(NULL);
+
+			while (time(NULL) == now)
+				sleep_millisec(50);
+		} else
+			die("unknown command: %s", line.buf);
+		fflush(stdout);
+	}
+	strbuf_release(&line);
+	return 0;
+}
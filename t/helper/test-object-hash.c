@@ -0,0 +1,84 @@
+#include "test-tool.h"
+#include "cache.h"
+#include "object.h"
+#include "parse-options.h"
+
+static int nr = 1000000;
+static int count = 1;
+
+/*
+ * Make up "nr" distinct object names, "salt" tells apart the names we
+ * insert from the ones that we expect not to find.
+ */
+static struct object_id *make_names(int nr, const char *salt)
+{
+	struct object_id *oids;
+	int i;
+
+	ALLOC_ARRAY(oids, nr);
+	for (i = 0; i < nr; i++) {
+		git_hash_ctx ctx;
+
+		the_hash_algo->init_fn(&ctx);
+		the_hash_algo->update_fn(&ctx, salt, strlen(salt));
+		the_hash_algo->update_fn(&ctx, &i, sizeof(i));
+		the_hash_algo->final_fn(oids[i].hash, &ctx);
+	}
+	return oids;
+}
+
+static double seconds_since(uint64_t t0)
+{
+	return ((double)(getnanotime() - t0)) / 1000000000;
+}
+
+int cmd__object_hash(int argc, const char **argv)
+{
+	const char *usage[] = {
+		"test-tool object-hash [-n <objects>] [-c <passes>]",
+		NULL
+	};
+	struct option options[] = {
+		OPT_INTEGER('n', "objects", &nr, "number of objects to insert"),
+		OPT_INTEGER('c', "count", &count, "number of lookup passes"),
+		OPT_END(),
+	};
+	struct object_id *present, *missing;
+	int i, pass, found = 0, not_found = 0;
+	uint64_t t0;
+
+	argc = parse_options(argc, argv, NULL, options, usage, 0);
+	if (argc || nr < 1 || count < 1)
+		usage_with_options(usage, options);
+
+	present = make_names(nr, "present");
+	missing = make_names(nr, "missing");
+
+	t0 = getnanotime();
+	for (i = 0; i < nr; i++)
+		lookup_unknown_object(present[i].hash);
+	fprintf(stderr, "%f seconds to insert %d objects\n",
+		seconds_since(t0), nr);
+
+	t0 = getnanotime();
+	for (pass = 0; pass < count; pass++)
+		for (i = 0; i < nr; i++)
+			if (lookup_object(the_repository, present[i].hash))
+				found++;
+	fprintf(stderr, "%f seconds for %d pass(es) of successful lookups\n",
+		seconds_since(t0), count);
+
+	t0 = getnanotime();
+	for (pass = 0; pass < count; pass++)
+		for (i = 0; i < nr; i++)
+			if (!lookup_object(the_repository, missing[i].hash))
+				not_found++;
+	fprintf(stderr, "%f seconds for %d pass(es) of failed lookups\n",
+		seconds_since(t0), count);
+
+	printf("%d found, %d not found\n", found, not_found);
+
+	free(present);
+	free(missing);
+	return 0;
+}
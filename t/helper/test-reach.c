@@ -139,6 +139,22 @@ int cmd__reach(int ac, const char **av)
 			filter.with_commit_tag_algo = 0;
 
 		printf("%s(_,A,X,_):%d\n", av[1], commit_contains(&filter, A, X, &cache));
+	} else if (!strcmp(av[1], "commit_contains_many")) {
+		struct ref_filter filter;
+		char *result = xcalloc(X_nr, 1);
+		int i;
+
+		if (ac > 2 && !strcmp(av[2], "--tag"))
+			filter.with_commit_tag_algo = 1;
+		else
+			filter.with_commit_tag_algo = 0;
+
+		commit_contains_many(&filter, X_array, X_nr, Y, result);
+		printf("%s(_,X,Y,_):", av[1]);
+		for (i = 0; i < X_nr; i++)
+			printf("%d", result[i]);
+		printf("\n");
+		free(result);
 	} else if (!strcmp(av[1], "get_reachable_subset")) {
 		const int reachable_flag = 1;
 		int i, count = 0;
@@ -0,0 +1,54 @@
+#include "test-tool.h"
+#include "cache.h"
+#include "object-store.h"
+#include "tree-walk.h"
+
+/*
+ * Walk each tree given on the command line, in the given order and
+ * as often as it is given, descending into subtrees while the parent
+ * is still being walked, and print every entry.  A corrupt entry ends
+ * the walk of its tree with a warning.
+ */
+static void walk_tree(const struct object_id *oid, struct strbuf *base)
+{
+	struct tree_desc desc;
+	struct name_entry entry;
+	enum object_type type;
+	unsigned long size;
+	size_t len = base->len;
+	void *buf;
+
+	buf = read_object_file(oid, &type, &size);
+	if (!buf || type != OBJ_TREE)
+		die("not a tree: %s", oid_to_hex(oid));
+
+	init_tree_desc_cached(&desc, oid, buf, size);
+	while (tree_entry_gently(&desc, &entry)) {
+		printf("%06o %s %s%s\n", entry.mode, oid_to_hex(entry.oid),
+		       base->buf, entry.path);
+		if (S_ISDIR(entry.mode)) {
+			strbuf_addf(base, "%s/", entry.path);
+			walk_tree(entry.oid, base);
+			strbuf_setlen(base, len);
+		}
+	}
+	free(buf);
+}
+
+int cmd__tree_walk(int argc, const char **argv)
+{
+	struct strbuf base = STRBUF_INIT;
+	int i;
+
+	setup_git_directory();
+
+	for (i = 1; i < argc; i++) {
+		struct object_id oid;
+
+		if (get_oid_hex(argv[i], &oid))
+			die("not a hexadecimal object name: %s", argv[i]);
+		walk_tree(&oid, &base);
+	}
+	strbuf_release(&base);
+	return 0;
+}
@@ -0,0 +1,104 @@
+#include "test-tool.h"
+#include "cache.h"
+#include "parse-options.h"
+#include "xdiff-interface.h"
+#include "xdiff/xtypes.h"
+#include "xdiff/xutils.h"
+
+static int count = 1;
+static int reference;
+static long xdl_flags;
+
+/*
+ * The byte-at-a-time record hash that xdl_hash_record() used before it
+ * learned to consume a word at a time.  Kept here so that we can check
+ * that both split the input into the same records and measure the
+ * difference.
+ */
+static unsigned long hash_record_reference(const char **data, const char *top)
+{
+	unsigned long ha = 5381;
+	const char *ptr = *data;
+
+	for (; ptr < top && *ptr != '\n'; ptr++) {
+		ha += (ha << 5);
+		ha ^= (unsigned long) *ptr;
+	}
+	*data = ptr < top ? ptr + 1 : ptr;
+
+	return ha;
+}
+
+/*
+ * Split "buf" into records the same way xdl_prepare_ctx() does.  The
+ * record boundaries are folded into "*split", which must not depend on
+ * the hash function, and the hashes themselves into the return value.
+ */
+static unsigned long hash_all(const char *buf, size_t len,
+			      long *nrec, unsigned long *split)
+{
+	const char *cur = buf, *top = buf + len;
+	unsigned long sum = 0;
+
+	*nrec = 0;
+	*split = 0;
+	while (cur < top) {
+		const char *prev = cur;
+
+		if (reference)
+			sum += hash_record_reference(&cur, top);
+		else
+			sum += xdl_hash_record(&cur, top, xdl_flags);
+		*split = *split * 31 + (unsigned long)(cur - prev);
+		(*nrec)++;
+	}
+	return sum;
+}
+
+int cmd__xdiff_hash(int argc, const char **argv)
+{
+	const char *usage[] = {
+		"test-tool xdiff-hash [--reference] [-c <n>] [-w | -b | --ignore-space-at-eol] <file>",
+		NULL
+	};
+	struct option options[] = {
+		OPT_BOOL(0, "reference", &reference,
+			 "use the byte-at-a-time reference hash"),
+		OPT_INTEGER('c', "count", &count, "number of passes"),
+		OPT_BIT('w', "ignore-all-space", &xdl_flags,
+			"ignore whitespace", XDF_IGNORE_WHITESPACE),
+		OPT_BIT('b', "ignore-space-change", &xdl_flags,
+			"ignore changes in amount of whitespace",
+			XDF_IGNORE_WHITESPACE_CHANGE),
+		OPT_BIT(0, "ignore-space-at-eol", &xdl_flags,
+			"ignore changes in whitespace at EOL",
+			XDF_IGNORE_WHITESPACE_AT_EOL),
+		OPT_END(),
+	};
+	struct strbuf buf = STRBUF_INIT;
+	unsigned long sum = 0, split = 0;
+	uint64_t t0, t1;
+	long nrec = 0;
+	int i;
+
+	argc = parse_options(argc, argv, NULL, options, usage, 0);
+	if (argc != 1 || count < 1)
+		usage_with_options(usage, options);
+	if (reference && xdl_flags)
+		die("--reference does not support whitespace options");
+
+	if (strbuf_read_file(&buf, argv[0], 0) < 0)
+		die_errno("unable to read '%s'", argv[0]);
+
+	t0 = getnanotime();
+	for (i = 0; i < count; i++)
+		sum = hash_all(buf.buf, buf.len, &nrec, &split);
+	t1 = getnanotime();
+
+	printf("%ld records %lx\n", nrec, split);
+	fprintf(stderr, "%f seconds for %d pass(es), hash sum %lx\n",
+		((double)(t1 - t0)) / 1000000000, count, sum);
+
+	strbuf_release(&buf);
+	return 0;
+}
@@ -27,4 +27,24 @@ test_perf 'rev-list --objects $commit --not --all' '
 	git rev-list --objects $commit --not --all >/dev/null
 '
 
+test_expect_success 'create 100k refs' '
+	git rev-list --all |
+	head -n 100000 |
+	awk "{ print \"create refs/perf/\" NR \" \" \$1 }" |
+	git update-ref --stdin &&
+	git pack-refs --all
+'
+
+test_perf 'rev-list --all (many refs)' '
+	git rev-list --all >/dev/null
+'
+
+test_perf 'rev-list --all --date-order (many refs)' '
+	git rev-list --all --date-order >/dev/null
+'
+
+test_perf 'rev-list $commit --not --all (many refs)' '
+	git rev-list $commit --not --all >/dev/null
+'
+
 test_done
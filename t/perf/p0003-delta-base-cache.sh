@@ -13,7 +13,9 @@ depth of 50.
 
 The setting of core.deltaBaseCacheLimit in the source repository is also
 relevant (depending on the size of your test repo), so be sure it is consistent
-between runs.
+between runs. The tests with a deliberately small cache show how well the
+replacement policy keeps the bases that are reused; run them with
+GIT_TRACE_DELTA_BASE_CACHE set to see the hit, miss and eviction counts.
 '
 . ./perf-lib.sh
 
@@ -28,4 +30,21 @@ test_perf 'log -S' '
 	git log --raw -Sfoo >/dev/null
 '
 
+test_expect_success 'list objects' '
+	git cat-file --batch-all-objects --batch-check="%(objectname)" >objects
+'
+
+# large blobs compete with the small bases every later delta needs
+test_perf 'log -p (8MB cache)' '
+	git -c core.deltaBaseCacheLimit=8m log -p -1000 >/dev/null
+'
+
+test_perf 'cat-file --batch (96MB cache)' '
+	git cat-file --batch <objects >/dev/null
+'
+
+test_perf 'cat-file --batch (8MB cache)' '
+	git -c core.deltaBaseCacheLimit=8m cat-file --batch <objects >/dev/null
+'
+
 test_done
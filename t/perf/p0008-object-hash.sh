@@ -0,0 +1,17 @@
+#!/bin/sh
+
+test_description='Tests performance of the parsed object hash table'
+. ./perf-lib.sh
+
+test_perf_fresh_repo
+
+for nr in 100000 1000000
+do
+	test_perf "insert and look up $nr objects" "
+		test-tool object-hash -n $nr -c 5 >actual &&
+		echo '$((5 * $nr)) found, $((5 * $nr)) not found' >expect &&
+		test_cmp expect actual
+	"
+done
+
+test_done
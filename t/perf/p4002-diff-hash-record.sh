@@ -0,0 +1,30 @@
+#!/bin/sh
+
+test_description='Tests xdiff record hashing performance'
+. ./perf-lib.sh
+
+test_perf_default_repo
+
+test_expect_success 'setup' '
+	git ls-files --stage "*.[ch]" "*.sh" |
+	cut -f2 -d" " |
+	git cat-file --batch >input
+'
+
+test_perf 'xdl_hash_record() byte-at-a-time reference' '
+	test-tool xdiff-hash --reference --count=10 input >expect
+'
+
+test_perf 'xdl_hash_record()' '
+	test-tool xdiff-hash --count=10 input >actual
+'
+
+test_expect_success 'xdl_hash_record() splits records like the reference' '
+	test_cmp expect actual
+'
+
+test_perf 'xdl_hash_record() with --ignore-space-at-eol' '
+	test-tool xdiff-hash --ignore-space-at-eol --count=10 input >/dev/null
+'
+
+test_done
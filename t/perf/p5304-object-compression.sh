@@ -0,0 +1,36 @@
+#!/bin/sh
+
+test_description='Tests the cost of decompressing objects stored with zlib and zstd
+
+The repository is copied twice and each copy is repacked from scratch
+(repack -F), once with the default zlib and once with
+extensions.objectCompression=zstd, so that the two differ only in the
+codec the objects were compressed with. Needs a build with USE_ZSTD.
+'
+. ./perf-lib.sh
+
+test_perf_large_repo
+
+test_expect_success ZSTD 'set up zlib and zstd copies' '
+	git clone -q --bare --no-local . zlib.git &&
+	git -C zlib.git repack -a -d -F -q &&
+	git clone -q --bare --no-local . zstd.git &&
+	git -C zstd.git config core.repositoryformatversion 1 &&
+	git -C zstd.git config extensions.objectCompression zstd &&
+	git -C zstd.git repack -a -d -F -q
+'
+
+for codec in zlib zstd
+do
+	test_perf ZSTD "cat-file --batch ($codec)" "
+		git -C $codec.git cat-file --batch-all-objects --batch >/dev/null
+	"
+
+	test_perf ZSTD "checkout ($codec)" "
+		rm -rf wt idx && mkdir wt &&
+		GIT_INDEX_FILE=\$(pwd)/idx \
+			git --git-dir=$codec.git --work-tree=wt read-tree -u --reset HEAD
+	"
+done
+
+test_done
@@ -16,4 +16,24 @@ test_expect_success 'test-sha1 detects shattered pdf' '
 	grep 38762cf7f55934b34d179ae6a4c80cadccbb7f0a err
 '
 
+test_expect_success 'collisions are detected without the SHA instructions' '
+	test_must_fail env GIT_TEST_SHA1_HW=0 \
+		test-tool sha1 <"$TEST_DATA/shattered-1.pdf" 2>err &&
+	test_i18ngrep collision err &&
+	grep 38762cf7f55934b34d179ae6a4c80cadccbb7f0a err
+'
+
+test_expect_success 'hashes do not depend on the SHA instructions' '
+	for n in 0 1 55 56 63 64 65 1000 100000
+	do
+		test-tool genrandom "$n" "$n" >data &&
+		test-tool sha1 <data >expect &&
+		GIT_TEST_SHA1_HW=0 test-tool sha1 <data >actual &&
+		test_cmp expect actual &&
+		git hash-object data >expect &&
+		GIT_TEST_SHA1_HW=0 git hash-object data >actual &&
+		test_cmp expect actual || return 1
+	done
+'
+
 test_done
@@ -239,6 +239,23 @@ test_expect_success 'rev-list stops traversal at missing and promised commit' '
 	! grep $FOO out
 '
 
+test_expect_success 'rev-list --count with a commit-graph excludes promisor commits' '
+	rm -rf repo &&
+	test_create_repo repo &&
+	test_commit -C repo foo &&
+	test_commit -C repo bar &&
+	git -C repo rev-list bar | pack_as_from_promisor &&
+	test_commit -C repo baz &&
+
+	git -C repo config core.repositoryformatversion 1 &&
+	git -C repo config extensions.partialclone "arbitrary string" &&
+	git -C repo config core.commitGraph true &&
+	git -C repo commit-graph write --reachable &&
+	echo 1 >expect &&
+	git -C repo rev-list --count --exclude-promisor-objects baz >actual &&
+	test_cmp expect actual
+'
+
 test_expect_success 'missing tree objects with --missing=allow-promisor and --exclude-promisor-objects' '
 	rm -rf repo &&
 	test_create_repo repo &&
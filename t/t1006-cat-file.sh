@@ -588,4 +588,17 @@ test_expect_success 'cat-file --unordered works' '
 	test_cmp expect actual
 '
 
+test_expect_success 'cat-file --batch --buffer reads ahead of its input' '
+	git -C all-two cat-file --batch-all-objects \
+				--batch-check="%(objectname)" >objects &&
+	for i in $(test_seq 100)
+	do
+		cat objects || return 1
+	done >input &&
+	echo "HEAD:file" >>input &&
+	git -C all-two cat-file --batch <input >expect &&
+	git -C all-two cat-file --batch --buffer <input >actual &&
+	test_cmp expect actual
+'
+
 test_done
@@ -0,0 +1,127 @@
+#!/bin/sh
+
+test_description='writing all new objects of a command into one pack'
+
+. ./test-lib.sh
+
+count_loose () {
+	find .git/objects/?? -type f 2>/dev/null | wc -l
+}
+
+count_packs () {
+	ls .git/objects/pack/*.pack 2>/dev/null | wc -l
+}
+
+test_expect_success 'setup' '
+	git config core.bulkCheckin always &&
+	mkdir dir &&
+	for i in $(test_seq 20)
+	do
+		test_seq $i >dir/file$i || return 1
+	done
+'
+
+test_expect_success 'invalid mode is refused' '
+	test_must_fail git -c core.bulkCheckin=sometimes add dir 2>err &&
+	test_i18ngrep "invalid mode for bulk checkin" err
+'
+
+test_expect_success 'add writes one pack' '
+	GIT_TEST_CHECKIN_THREADS=4 git add dir &&
+	test $(count_loose) = 0 &&
+	test $(count_packs) = 1 &&
+	git diff-files --exit-code &&
+	git fsck
+'
+
+test_expect_success 'write-tree and commit-tree' '
+	tree=$(git write-tree) &&
+	test $(count_loose) = 0 &&
+	test $(count_packs) = 2 &&
+	git cat-file -e $tree:dir/file20 &&
+	commit=$(echo initial | git commit-tree $tree) &&
+	git cat-file -e $commit &&
+	test $(count_loose) = 1 &&
+	test $(count_packs) = 2 &&
+	git update-ref HEAD $commit &&
+	git fsck
+'
+
+test_expect_success 'update-index --add' '
+	echo one >one &&
+	echo two >two &&
+	git update-index --add one two &&
+	test $(count_loose) = 1 &&
+	test $(count_packs) = 3 &&
+	git diff-files --exit-code &&
+	git cat-file -e :one &&
+	git cat-file -e :two
+'
+
+test_expect_success 'objects written earlier in the command can be read' '
+	git commit -q -m second &&
+	for i in $(test_seq 20)
+	do
+		echo change >>dir/file$i || return 1
+	done &&
+	echo untracked >new &&
+	git stash -u &&
+	git diff-files --exit-code &&
+	git stash show -p >diff &&
+	grep change diff &&
+	git stash pop &&
+	test_path_is_file new &&
+	grep change dir/file1 &&
+	git fsck
+'
+
+test_expect_success 'large mode still writes small objects loose' '
+	git -c core.bulkCheckin=large add dir &&
+	test $(count_loose) -gt 1
+'
+
+test_expect_success 'batched fsync stages loose objects until the end' '
+	git config core.bulkCheckin large &&
+	git config core.fsyncObjectFiles batch &&
+	for i in $(test_seq 20)
+	do
+		echo batch >>dir/file$i || return 1
+	done &&
+	GIT_TRACE_BULK_CHECKIN="$(pwd)/.git/trace" \
+	GIT_TEST_CHECKIN_THREADS=4 git add dir &&
+	grep "migrating 20 staged objects" .git/trace &&
+	git diff-files --exit-code &&
+	for i in $(test_seq 20)
+	do
+		git cat-file -e :dir/file$i &&
+		test_path_is_file .git/objects/$(git rev-parse :dir/file$i |
+					 sed -e "s|^..|&/|") || return 1
+	done &&
+	! ls -d .git/objects/incoming-* &&
+	git fsck
+'
+
+test_expect_success 'batched fsync with write-tree and stash' '
+	tree=$(git write-tree) &&
+	git cat-file -e $tree:dir &&
+	git commit -q -m batched &&
+	echo stashed >>dir/file1 &&
+	echo untracked >new2 &&
+	git stash -u &&
+	git stash show -p >.git/stash.diff &&
+	grep stashed .git/stash.diff &&
+	git stash pop &&
+	grep stashed dir/file1 &&
+	! ls -d .git/objects/incoming-* &&
+	git fsck
+'
+
+test_expect_success 'objects are not staged without batched fsync' '
+	echo unbatched >>dir/file1 &&
+	GIT_TRACE_BULK_CHECKIN="$(pwd)/.git/trace.off" \
+	git -c core.fsyncObjectFiles=true add dir &&
+	git cat-file -e :dir/file1 &&
+	! test -s .git/trace.off
+'
+
+test_done
@@ -0,0 +1,94 @@
+#!/bin/sh
+
+test_description='listings of loose objects going stale under a running command'
+
+. ./test-lib.sh
+
+# Look an object up often enough for the fanout directories to be read,
+# rather than stat()ed one object at a time.
+probes () {
+	for i in $(test_seq 20)
+	do
+		echo "quick $1"
+	done
+}
+
+test_expect_success 'setup' '
+	for i in $(test_seq 1000)
+	do
+		echo $i >$i || return 1
+	done &&
+	test_seq 1000 >names &&
+	git hash-object --stdin-paths <names >oids &&
+	paste oids names >all &&
+	dir=$(cut -c1-2 oids | sort | uniq -c | sort -rn | sed -n "1s/.* //p") &&
+	grep "^$dir" all >same &&
+	test_line_count -ge 4 same &&
+	for n in A B C D
+	do
+		sed -n "1p" same >line &&
+		sed -e "1d" same >rest &&
+		mv rest same &&
+		cut -f1 line >$n &&
+		cut -f2 line >$n.name || return 1
+	done &&
+	git hash-object -w $(cat A.name) &&
+	echo $dir >dir
+'
+
+test_expect_success 'objects written by others show up within a second' '
+	A=$(cat A) B=$(cat B) &&
+	test-tool chmtime =-10 .git/objects/$(cat dir) &&
+	{
+		probes $B &&
+		echo "quick $A" &&
+		echo "git hash-object -w $(cat B.name)" &&
+		echo next-second &&
+		echo "quick $B"
+	} >in &&
+	test-tool loose-cache <in >out &&
+	{
+		probes $B | sed -e "s/^quick \(.*\)/\1 missing/" &&
+		echo "$A present" &&
+		echo "$B present"
+	} >expect &&
+	test_cmp expect out
+'
+
+test_expect_success 'objects pruned by others are not found from a listing' '
+	A=$(cat A) &&
+	test-tool chmtime =-10 .git/objects/$(cat dir) &&
+	{
+		probes $A &&
+		echo "git prune --expire=now" &&
+		echo "quick $A"
+	} >in &&
+	test-tool loose-cache <in >out &&
+	tail -n 1 out >actual &&
+	echo "$A missing" >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'objects written by ourselves are found from a listing' '
+	A=$(cat A) C=$(cat C) D=$(cat D) &&
+	git hash-object -w $(cat A.name) &&
+	test-tool chmtime =-10 .git/objects/$(cat dir) &&
+	{
+		probes $C &&
+		echo "write $(cat D.name)" &&
+		echo "write $(cat C.name)" &&
+		echo "quick $C" &&
+		echo "quick $D" &&
+		echo "quick $A"
+	} >in &&
+	test-tool loose-cache <in >out &&
+	tail -n 3 out >actual &&
+	cat >expect <<-EOF &&
+	$C present
+	$D present
+	$A present
+	EOF
+	test_cmp expect actual
+'
+
+test_done
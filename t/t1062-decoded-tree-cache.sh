@@ -0,0 +1,89 @@
+#!/bin/sh
+
+test_description='walking trees through the cache of decoded trees'
+
+. ./test-lib.sh
+
+hex2oct() {
+	perl -ne 'printf "\\%03o", hex for /../g'
+}
+
+# Walk the trees in "trees" with the cache off, at its default size and
+# squeezed to a few trees, and check that all walks print the same.
+walk_three_ways () {
+	GIT_TEST_DECODED_TREE_CACHE=0 \
+		test-tool tree-walk $(cat trees) >expect 2>&1 &&
+	test-tool tree-walk $(cat trees) >actual 2>&1 &&
+	test_cmp expect actual &&
+	for n in 1 2 3
+	do
+		GIT_TEST_DECODED_TREE_CACHE=$n \
+			test-tool tree-walk $(cat trees) >actual 2>&1 &&
+		test_cmp expect actual || return 1
+	done
+}
+
+# Subdirectories sort before files, so that the walk of a tree goes on
+# after returning from them.
+test_expect_success 'setup' '
+	for i in $(test_seq 8)
+	do
+		mkdir -p a/b/c d/e &&
+		echo $i >a/b/c/deep &&
+		echo $i >a/b/c/$i &&
+		echo $i >>a/b/z &&
+		echo $i >a/z$i &&
+		echo $i >d/e/$i &&
+		echo $i >>d/z &&
+		echo $i >z$i &&
+		git add . &&
+		test_tick &&
+		git commit -q -m $i || return 1
+	done &&
+	git rev-list --all --format=%T | grep -v "^commit " >roots &&
+	for c in $(git rev-list --all)
+	do
+		git ls-tree -r -t $c | sed -n "s/^040000 tree \([^	]*\).*/\1/p" ||
+		return 1
+	done | sort -u >subtrees
+'
+
+test_expect_success 'trees walked often are admitted' '
+	cat roots roots roots roots >trees &&
+	walk_three_ways
+'
+
+test_expect_success 'cached trees are evicted while being walked' '
+	{
+		cat roots subtrees &&
+		sort -r roots &&
+		sort subtrees roots &&
+		cat subtrees roots subtrees
+	} >trees &&
+	walk_three_ways
+'
+
+test_expect_success 'corrupt trees are walked without the cache' '
+	blob=$(echo blob | git hash-object -w --stdin) &&
+	blob_bin=$(echo $blob | hex2oct) &&
+	bad=$(
+		printf "100644 a\0${blob_bin}10x644 b\0${blob_bin}" |
+		git hash-object -t tree --stdin -w --literally
+	) &&
+	bad_bin=$(echo $bad | hex2oct) &&
+	outer=$(
+		printf "40000 bad\0${bad_bin}100644 file\0${blob_bin}" |
+		git hash-object -t tree --stdin -w --literally
+	) &&
+	for i in 1 2 3 4
+	do
+		echo $bad &&
+		echo $outer &&
+		sed -n "${i}p" roots || return 1
+	done >trees &&
+	walk_three_ways &&
+	grep "^100644 $blob file\$" expect &&
+	test_i18ngrep "malformed mode" expect
+'
+
+test_done
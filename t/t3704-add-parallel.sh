@@ -0,0 +1,72 @@
+#!/bin/sh
+
+test_description='adding and hashing files with several threads'
+
+. ./test-lib.sh
+
+test_expect_success 'setup' '
+	mkdir dir &&
+	for i in $(test_seq 50)
+	do
+		test_seq $i >dir/file$i || return 1
+	done &&
+	printf "crlf\\r\\n" >dir/crlf.txt &&
+	echo "*.txt text" >.gitattributes &&
+	test_ln_s_add dir/file1 link &&
+	find dir -type f | sort >paths
+'
+
+test_expect_success 'hash-object --stdin-paths' '
+	GIT_TEST_CHECKIN_THREADS=1 git hash-object --stdin-paths <paths >expect &&
+	GIT_TEST_CHECKIN_THREADS=4 git hash-object --stdin-paths <paths >actual &&
+	test_cmp expect actual &&
+	GIT_TEST_CHECKIN_THREADS=4 \
+		git hash-object --stdin-paths --no-filters <paths >actual &&
+	git hash-object --no-filters $(cat paths) >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'hash-object -w --stdin-paths writes the objects' '
+	GIT_TEST_CHECKIN_THREADS=4 git hash-object -w --stdin-paths <paths >oids &&
+	while read oid
+	do
+		git cat-file -e $oid || return 1
+	done <oids
+'
+
+test_expect_success 'hash-object --stdin-paths still reports bad paths' '
+	echo missing >>paths &&
+	test_must_fail env GIT_TEST_CHECKIN_THREADS=4 \
+		git hash-object --stdin-paths <paths >actual 2>err &&
+	test_line_count = 51 actual &&
+	test_i18ngrep missing err
+'
+
+test_expect_success 'add new files' '
+	GIT_TEST_CHECKIN_THREADS=1 git add dir &&
+	git ls-files -s >expect &&
+	git rm -rq --cached dir &&
+	GIT_TEST_CHECKIN_THREADS=4 git add dir &&
+	git ls-files -s >actual &&
+	test_cmp expect actual &&
+	git diff-files --exit-code &&
+	git fsck
+'
+
+test_expect_success 'add -u of modified files' '
+	git commit -q -m initial &&
+	for i in $(test_seq 50)
+	do
+		echo more >>dir/file$i || return 1
+	done &&
+	GIT_TEST_CHECKIN_THREADS=4 git add -u &&
+	git diff-files --exit-code &&
+	git ls-files -s >actual &&
+	git reset -q &&
+	GIT_TEST_CHECKIN_THREADS=1 git add -u &&
+	git ls-files -s >expect &&
+	test_cmp expect actual &&
+	git fsck
+'
+
+test_done
@@ -0,0 +1,78 @@
+#!/bin/sh
+
+test_description='bounded diff algorithm'
+
+. ./test-lib.sh
+. "$TEST_DIRECTORY"/lib-diff-alternative.sh
+
+test_diff_frobnitz "diff-algorithm=bounded"
+
+test_diff_unique "diff-algorithm=bounded"
+
+test_expect_success 'setup large files' '
+	test_seq 1 1000 >half &&
+	cat half half >large1 &&
+	sed -e "s/^\(.*\)5$/\15 changed/" large1 >large2
+'
+
+test_expect_success 'bounded diff matches patience within budget' '
+	test_must_fail git diff --no-index --patience large1 large2 >expect &&
+	test_must_fail git diff --no-index --diff-algorithm=bounded \
+		large1 large2 >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'bounded diff is coarser but valid when out of budget' '
+	test_must_fail git -c diff.maxCost=1000 diff --no-index \
+		--diff-algorithm=bounded large1 large2 >coarse &&
+	test $(grep -c "^@@" coarse) -lt $(grep -c "^@@" expect) &&
+	git init applied &&
+	cp large1 applied/ &&
+	(cd applied && git apply ../coarse) &&
+	test_cmp large2 applied/large2
+'
+
+test_expect_success 'diff.maxCost switches other algorithms to bounded' '
+	test_must_fail git -c diff.maxCost=1000 diff --no-index \
+		large1 large2 >actual &&
+	test_cmp coarse actual
+'
+
+test_expect_success 'diff.maxCost leaves small diffs alone' '
+	test_must_fail git diff --no-index large1 large2 >expect &&
+	test_must_fail git -c diff.maxCost=100000000 diff --no-index \
+		large1 large2 >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'plumbing honors diff.maxCost' '
+	git init plumbing &&
+	(
+		cd plumbing &&
+		cp ../large1 file &&
+		git add file &&
+		git commit -m large1 &&
+		cp ../large2 file &&
+		git -c diff.maxCost=1000 diff >coarse &&
+		git diff >fine &&
+		! test_cmp fine coarse &&
+		git -c diff.maxCost=1000 diff-files -p >actual &&
+		test_cmp coarse actual &&
+		git -c diff.maxCost=1000 diff-index -p HEAD >actual &&
+		test_cmp coarse actual &&
+		git commit -a -m large2 &&
+		git -c diff.maxCost=1000 diff-tree -p HEAD^ HEAD >actual &&
+		test_cmp coarse actual
+	)
+'
+
+test_expect_success 'diff.maxCost rejects values out of range' '
+	test_must_fail git -c diff.maxCost=-1 diff --no-index \
+		large1 large2 2>err &&
+	test_i18ngrep diff.maxcost err &&
+	test_must_fail git -c diff.maxCost=9223372036854775808 diff --no-index \
+		large1 large2 2>err &&
+	test_i18ngrep diff.maxcost err
+'
+
+test_done
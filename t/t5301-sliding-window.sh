@@ -57,4 +57,30 @@ test_expect_success \
      git config --unset core.packedGitLimit &&
      git verify-pack -v "$pack2"'
 
+test_expect_success LONG_IS_64BIT 'packs are mapped whole by default' '
+	git fast-import --stats </dev/null 2>err &&
+	grep "whole-pack mapping *= *yes" err
+'
+
+test_expect_success 'packedGit{WindowSize,Limit} bring back windows' '
+	git -c core.packedGitWindowSize=1m fast-import --stats </dev/null 2>err &&
+	grep "whole-pack mapping *= *no" err &&
+	git -c core.packedGitLimit=1g fast-import --stats </dev/null 2>err &&
+	grep "whole-pack mapping *= *no" err
+'
+
+test_expect_success 'sequential and random reads of a whole mapping' '
+	for i in $(test_seq 600)
+	do
+		echo "content $i" >f$i || return 1
+	done &&
+	git hash-object -w f* >oids &&
+	git repack -a -d &&
+	git cat-file --batch-all-objects --batch --unordered >sequential &&
+	test $(grep -c "^content" sequential) = 600 &&
+	git cat-file --batch <oids >expect &&
+	sort -r oids | git cat-file --batch >random &&
+	test $(wc -c <random) = $(wc -c <expect)
+'
+
 test_done
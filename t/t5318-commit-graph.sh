@@ -50,7 +50,12 @@ graph_git_behavior() {
 		graph_git_two_modes "log --topo-order $BRANCH" &&
 		graph_git_two_modes "log --graph $COMPARE..$BRANCH" &&
 		graph_git_two_modes "branch -vv" &&
-		graph_git_two_modes "merge-base -a $BRANCH $COMPARE"
+		graph_git_two_modes "merge-base -a $BRANCH $COMPARE" &&
+		graph_git_two_modes "rev-list --count $BRANCH" &&
+		graph_git_two_modes "rev-list --count --first-parent $BRANCH" &&
+		graph_git_two_modes "rev-list --count $COMPARE..$BRANCH" &&
+		graph_git_two_modes "rev-list --count $COMPARE...$BRANCH" &&
+		graph_git_two_modes "rev-list --count --all --not $COMPARE"
 	'
 }
 
@@ -58,16 +63,16 @@ graph_git_behavior 'no graph' full commits/3 commits/1
 
 graph_read_expect() {
 	OPTIONAL=""
-	NUM_CHUNKS=3
+	NUM_CHUNKS=4
 	if test ! -z $2
 	then
 		OPTIONAL=" $2"
-		NUM_CHUNKS=$((3 + $(echo "$2" | wc -w)))
+		NUM_CHUNKS=$((4 + $(echo "$2" | wc -w)))
 	fi
 	cat >expect <<- EOF
 	header: 43475048 1 1 $NUM_CHUNKS 0
 	num_commits: $1
-	chunks: oid_fanout oid_lookup commit_metadata$OPTIONAL
+	chunks: oid_fanout oid_lookup commit_metadata generation_data$OPTIONAL
 	EOF
 	git commit-graph read >output &&
 	test_cmp expect output
@@ -237,6 +242,75 @@ test_expect_success 'write graph in bare repo' '
 graph_git_behavior 'bare repo with graph, commit 8 vs merge 1' bare commits/8 merge/1
 graph_git_behavior 'bare repo with graph, commit 8 vs merge 2' bare commits/8 merge/2
 
+test_expect_success 'write graph with generation version 1' '
+	cd "$TRASH_DIRECTORY/bare" &&
+	git -c commitGraph.generationVersion=1 commit-graph write &&
+	cat >expect <<-\EOF &&
+	header: 43475048 1 1 4 0
+	num_commits: 11
+	chunks: oid_fanout oid_lookup commit_metadata large_edges
+	EOF
+	git commit-graph read >output &&
+	test_cmp expect output &&
+	git commit-graph verify
+'
+
+graph_git_behavior 'generation version 1, commit 8 vs merge 1' bare commits/8 merge/1
+graph_git_behavior 'generation version 1, commit 8 vs merge 2' bare commits/8 merge/2
+
+test_expect_success 'setup commits with skewed dates' '
+	git init "$TRASH_DIRECTORY/skew" &&
+	cd "$TRASH_DIRECTORY/skew" &&
+	test_commit base &&
+	GIT_COMMITTER_DATE="4000000000 +0000" &&
+	test_commit --notick future &&
+	GIT_COMMITTER_DATE="1000000000 +0000" &&
+	test_commit --notick old-child &&
+	test_commit latest &&
+	git checkout -b side base &&
+	test_commit side &&
+	git commit-graph write --reachable &&
+	git commit-graph read >output &&
+	grep "chunks: .* generation_data generation_data_overflow" output &&
+	git commit-graph verify
+'
+
+test_expect_success 'corrected commit dates give the same answers' '
+	cd "$TRASH_DIRECTORY/skew" &&
+	for cmd in "tag --contains old-child" "tag --contains base" \
+		   "branch --merged side" "branch --contains future" \
+		   "merge-base --all side latest" "merge-base --independent side latest old-child" \
+		   "rev-list --topo-order latest"
+	do
+		git -c core.commitGraph=false $cmd >expect &&
+		git -c core.commitGraph=true $cmd >actual &&
+		test_cmp expect actual &&
+		git -c core.commitGraph=true \
+		    -c commitGraph.generationVersion=1 $cmd >actual &&
+		test_cmp expect actual || return 1
+	done
+'
+
+test_expect_success 'short overflow chunk falls back to topological levels' '
+	cd "$TRASH_DIRECTORY/skew" &&
+	graph=.git/objects/info/commit-graph &&
+	test_when_finished "mv commit-graph-backup $graph" &&
+	cp $graph commit-graph-backup &&
+	chmod u+w $graph &&
+	# end the overflow chunk after its first entry
+	perl -0777 -pi -e "
+		for (\$i = 8; substr(\$_, \$i, 4) ne q(GDOV); \$i += 12) {}
+		substr(\$_, \$i + 16, 8) =
+			pack(q(Q>), unpack(q(Q>), substr(\$_, \$i + 4, 8)) + 8);
+	" $graph &&
+	git -c core.commitGraph=false tag --contains old-child >expect &&
+	git -c core.commitGraph=true tag --contains old-child >actual 2>err &&
+	test_cmp expect actual &&
+	test_i18ngrep "overflow generation data is too small" err &&
+	test_must_fail git commit-graph verify 2>err &&
+	test_i18ngrep "corrupt generation data" err
+'
+
 test_expect_success 'perform fast-forward merge in full repo' '
 	cd "$TRASH_DIRECTORY/full" &&
 	git checkout -b merge-5-to-8 commits/5 &&
@@ -340,7 +414,7 @@ GRAPH_BYTE_HASH=5
 GRAPH_BYTE_CHUNK_COUNT=6
 GRAPH_CHUNK_LOOKUP_OFFSET=8
 GRAPH_CHUNK_LOOKUP_WIDTH=12
-GRAPH_CHUNK_LOOKUP_ROWS=5
+GRAPH_CHUNK_LOOKUP_ROWS=6
 GRAPH_BYTE_OID_FANOUT_ID=$GRAPH_CHUNK_LOOKUP_OFFSET
 GRAPH_BYTE_OID_LOOKUP_ID=$(($GRAPH_CHUNK_LOOKUP_OFFSET + \
 			    1 * $GRAPH_CHUNK_LOOKUP_WIDTH))
@@ -361,8 +435,10 @@ GRAPH_BYTE_COMMIT_WRONG_PARENT=$(($GRAPH_COMMIT_DATA_OFFSET + $HASH_LEN + 3))
 GRAPH_BYTE_COMMIT_GENERATION=$(($GRAPH_COMMIT_DATA_OFFSET + $HASH_LEN + 11))
 GRAPH_BYTE_COMMIT_DATE=$(($GRAPH_COMMIT_DATA_OFFSET + $HASH_LEN + 12))
 GRAPH_COMMIT_DATA_WIDTH=$(($HASH_LEN + 16))
-GRAPH_OCTOPUS_DATA_OFFSET=$(($GRAPH_COMMIT_DATA_OFFSET + \
-			     $GRAPH_COMMIT_DATA_WIDTH * $NUM_COMMITS))
+GRAPH_GENERATION_DATA_OFFSET=$(($GRAPH_COMMIT_DATA_OFFSET + \
+				$GRAPH_COMMIT_DATA_WIDTH * $NUM_COMMITS))
+GRAPH_BYTE_GENERATION_DATA=$(($GRAPH_GENERATION_DATA_OFFSET + 3))
+GRAPH_OCTOPUS_DATA_OFFSET=$(($GRAPH_GENERATION_DATA_OFFSET + 4 * $NUM_COMMITS))
 GRAPH_BYTE_OCTOPUS=$(($GRAPH_OCTOPUS_DATA_OFFSET + 4))
 GRAPH_BYTE_FOOTER=$(($GRAPH_OCTOPUS_DATA_OFFSET + 4 * $NUM_OCTOPUS_EDGES))
 
@@ -474,6 +550,11 @@ test_expect_success 'detect incorrect commit date' '
 		"commit date"
 '
 
+test_expect_success 'detect incorrect corrected commit date' '
+	corrupt_graph_and_verify $GRAPH_BYTE_GENERATION_DATA "\01" \
+		"corrected commit date"
+'
+
 test_expect_success 'detect incorrect parent for octopus merge' '
 	corrupt_graph_and_verify $GRAPH_BYTE_OCTOPUS "\01" \
 		"invalid parent"
@@ -0,0 +1,123 @@
+#!/bin/sh
+
+test_description='storing and transferring objects compressed with zstd'
+
+. ./test-lib.sh
+
+# first two bytes of a file, in hex
+magic () {
+	perl -e 'binmode STDIN; read(STDIN, $b, 2); print unpack("H*", $b), "\n"' <"$1"
+}
+
+# first two bytes of the compressed data of the first entry in a pack
+entry_magic () {
+	perl -e '
+		binmode STDIN;
+		read(STDIN, $b, 64);
+		my $i = 12;
+		$i++ while (ord(substr($b, $i, 1)) & 0x80);
+		print unpack("H*", substr($b, $i + 1, 2)), "\n";
+	' <"$1"
+}
+
+loose_path () {
+	echo "$1/objects/$(echo $2 | sed -e "s|^..|&/|")"
+}
+
+make_zstd_repo () {
+	git init -q "$1" &&
+	git -C "$1" config core.repositoryformatversion 1 &&
+	git -C "$1" config extensions.objectCompression zstd
+}
+
+test_expect_success 'unknown codecs are refused' '
+	git init -q lz4 &&
+	git -C lz4 config core.repositoryformatversion 1 &&
+	git -C lz4 config extensions.objectCompression lz4 &&
+	test_must_fail git -C lz4 rev-parse --git-dir
+'
+
+test_expect_success !ZSTD 'zstd repositories are refused without zstd support' '
+	make_zstd_repo nozstd &&
+	test_must_fail git -C nozstd rev-parse --git-dir
+'
+
+test_expect_success ZSTD 'setup' '
+	make_zstd_repo src &&
+	for i in 1 2 3 4 5
+	do
+		test_seq $((i * 1000)) >src/file &&
+		git -C src add file &&
+		git -C src commit -q -m "commit $i" || return 1
+	done &&
+	git -C src rev-parse HEAD:file >blob
+'
+
+test_expect_success ZSTD 'loose objects are written with zstd' '
+	echo 28b5 >expect &&
+	magic "$(loose_path src/.git $(cat blob))" >actual &&
+	test_cmp expect actual &&
+	git -C src fsck &&
+	test_seq 5000 >expect &&
+	git -C src cat-file blob $(cat blob) >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success ZSTD 'repack keeps zstd' '
+	git -C src repack -a -d &&
+	git -C src pack-objects --stdout <blob >one.pack &&
+	git -C src pack-objects --compression-codec=zstd --stdout <blob >zstd.pack &&
+	echo 28b5 >expect &&
+	entry_magic zstd.pack >actual &&
+	test_cmp expect actual &&
+	git -C src fsck &&
+	git -C src log -p >/dev/null
+'
+
+test_expect_success ZSTD 'packs sent elsewhere are recompressed with zlib' '
+	entry_magic one.pack >actual &&
+	grep ^78 actual &&
+	git -C src rev-list --objects --all >objects &&
+	git -C src pack-objects --stdout <objects >all.pack &&
+	git init -q zlib &&
+	git -C zlib index-pack --stdin <all.pack &&
+	git -C zlib cat-file blob $(cat blob) >actual &&
+	test_seq 5000 >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success ZSTD 'zstd is only offered when allowed' '
+	make_zstd_repo dst0 &&
+	GIT_TRACE_PACKET="$(pwd)/dst0.trace" \
+		git -C dst0 fetch --no-tags ../src master &&
+	! grep "fetch> want .* zstd" dst0.trace &&
+	git -C src config uploadpack.allowZstd true
+'
+
+test_expect_success ZSTD 'fetch asks for zstd only for zstd repositories' '
+	git init -q plain &&
+	GIT_TRACE_PACKET="$(pwd)/plain.trace" \
+		git -C plain -c fetch.unpackLimit=1 fetch --no-tags ../src master &&
+	! grep "fetch> want .* zstd" plain.trace &&
+	entry_magic plain/.git/objects/pack/pack-*.pack >actual &&
+	grep ^78 actual &&
+	git -C plain fsck &&
+	make_zstd_repo dst &&
+	GIT_TRACE_PACKET="$(pwd)/dst.trace" \
+		git -C dst -c fetch.unpackLimit=1 fetch --no-tags ../src master &&
+	grep "fetch> want .* zstd" dst.trace &&
+	echo 28b5 >expect &&
+	entry_magic dst/.git/objects/pack/pack-*.pack >actual &&
+	test_cmp expect actual &&
+	git -C dst fsck
+'
+
+test_expect_success ZSTD 'fetch asks for zstd over protocol v2' '
+	make_zstd_repo dst2 &&
+	GIT_TRACE_PACKET="$(pwd)/v2.trace" \
+		git -C dst2 -c protocol.version=2 fetch --no-tags ../src master &&
+	grep "fetch> zstd" v2.trace &&
+	git -C dst2 fsck
+'
+
+test_done
@@ -78,6 +78,19 @@ test_expect_success 'push without strict' '
 	test_cmp exp act
 '
 
+test_expect_success 'push without strict, checking connectivity with rev-list' '
+	rm -rf dst &&
+	git init dst &&
+	(
+		cd dst &&
+		git config fetch.fsckobjects false &&
+		git config transfer.fsckobjects false
+	) &&
+	test_must_fail env GIT_TEST_CHECK_CONNECTED_IN_PROCESS=false \
+		git push --porcelain dst master:refs/heads/test >act &&
+	test_cmp exp act
+'
+
 test_expect_success 'push with !receive.fsckobjects' '
 	rm -rf dst &&
 	git init dst &&
@@ -348,4 +361,63 @@ test_expect_success \
 	grep "Cannot demote unterminatedheader" act
 '
 
+# Packs that leave out objects the new tip needs; the connectivity
+# check run within fetch and receive-pack must notice and refuse them.
+test_expect_success 'setup packs missing a blob or a parent commit' '
+	git init incomplete &&
+	(
+		cd incomplete &&
+		echo one >file &&
+		git add file &&
+		git commit -m one &&
+		echo two >file &&
+		git commit -a -m two
+	) &&
+	git -C incomplete rev-parse HEAD^ >no-blob-tip &&
+	git -C incomplete rev-parse HEAD >no-parent-tip &&
+	git -C incomplete rev-parse HEAD^ HEAD^^{tree} |
+	git -C incomplete pack-objects --stdout >no-blob.pack &&
+	git -C incomplete rev-parse HEAD HEAD^{tree} HEAD:file |
+	git -C incomplete pack-objects --stdout >no-parent.pack &&
+	for kind in no-blob no-parent
+	do
+		{
+			echo "# v2 git bundle" &&
+			echo "$(cat $kind-tip) refs/heads/master" &&
+			echo &&
+			cat $kind.pack
+		} >$kind.bundle || return 1
+	done
+'
+
+for kind in no-blob no-parent
+do
+	test_expect_success "fetch rejects a pack with $kind" '
+		rm -rf dst trace &&
+		git init dst &&
+		test_must_fail env GIT_TRACE="$(pwd)/trace" \
+			git -C dst fetch ../$kind.bundle master:refs/heads/test 2>err &&
+		test_i18ngrep "did not send all necessary objects" err &&
+		! grep rev-list trace &&
+		test_must_fail git -C dst rev-parse --verify refs/heads/test
+	'
+
+	test_expect_success "receive-pack rejects a pack with $kind" '
+		rm -rf dst trace &&
+		git init --bare dst &&
+		line="$ZERO_OID $(cat $kind-tip) refs/heads/test" &&
+		{
+			printf "%04x%s\0report-status\n" \
+				$((${#line} + 19)) "$line" &&
+			printf 0000 &&
+			cat $kind.pack
+		} >in &&
+		env GIT_TRACE="$(pwd)/trace" git receive-pack dst <in >out &&
+		test-tool pkt-line unpack <out >actual &&
+		grep "^ng refs/heads/test missing necessary objects" actual &&
+		! grep rev-list trace &&
+		test_must_fail git -C dst rev-parse --verify refs/heads/test
+	'
+done
+
 test_done
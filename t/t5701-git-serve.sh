@@ -194,6 +194,72 @@ test_expect_success 'sending server-options' '
 	test_cmp expect actual
 '
 
+test_expect_success 'several requests in one session' '
+	test-tool pkt-line pack >in <<-EOF &&
+	command=ls-refs
+	0001
+	peel
+	ref-prefix refs/tags/
+	0000
+	command=ls-refs
+	0001
+	peel
+	ref-prefix refs/tags/annotated-tag
+	0000
+	EOF
+
+	git serve --advertise-capabilities >caps &&
+	test-tool pkt-line unpack <caps >expect &&
+	cat >>expect <<-EOF &&
+	$(git rev-parse refs/tags/annotated-tag) refs/tags/annotated-tag peeled:$(git rev-parse refs/tags/annotated-tag^{})
+	$(git rev-parse refs/tags/one) refs/tags/one
+	$(git rev-parse refs/tags/two) refs/tags/two
+	0000
+	$(git rev-parse refs/tags/annotated-tag) refs/tags/annotated-tag peeled:$(git rev-parse refs/tags/annotated-tag^{})
+	0000
+	EOF
+
+	git serve <in >out &&
+	test-tool pkt-line unpack <out >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'several negotiation rounds in one session' '
+	orphan=$(echo orphan | git commit-tree one^{tree}) &&
+	git update-ref refs/heads/orphan $orphan &&
+	test-tool pkt-line pack >in <<-EOF &&
+	command=fetch
+	0001
+	no-progress
+	want $orphan
+	want $(git rev-parse two)
+	have $(git rev-parse one)
+	0000
+	command=fetch
+	0001
+	no-progress
+	want $orphan
+	want $(git rev-parse two)
+	have $(git rev-parse two)
+	0000
+	EOF
+
+	git serve --advertise-capabilities >caps &&
+	test-tool pkt-line unpack <caps >expect &&
+	cat >>expect <<-EOF &&
+	acknowledgments
+	ACK $(git rev-parse one)
+	0000
+	acknowledgments
+	ACK $(git rev-parse two)
+	0000
+	EOF
+
+	git serve <in >out &&
+	test-tool pkt-line unpack <out >actual &&
+	test_cmp expect actual
+'
+
 test_expect_success 'unexpected lines are not allowed in fetch request' '
 	git init server &&
 
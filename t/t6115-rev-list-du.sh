@@ -0,0 +1,75 @@
+#!/bin/sh
+
+test_description='basic tests of rev-list --disk-usage'
+. ./test-lib.sh
+
+# we want a mix of reachable and unreachable, as well as
+# objects in the bitmapped pack and some outside of it
+test_expect_success 'set up repository' '
+	test_commit one &&
+	test_commit two &&
+	git repack -adb &&
+	git reset --hard HEAD^ &&
+	test_commit three &&
+	test_commit four &&
+	git tag -m "annotated" annotated &&
+	git reset --hard HEAD^
+'
+
+# We don't want to hardcode sizes, because they depend on the exact details of
+# packing, zlib, etc. We'll assume that the regular rev-list and cat-file
+# machinery works and compare the --disk-usage output to that.
+disk_usage_slow () {
+	git rev-list "$@" | cut -d" " -f1 |
+	git cat-file --batch-check="%(objectsize:disk)" |
+	perl -lne '$total += $_; END { print $total}'
+}
+
+by_type_slow () {
+	git rev-list "$@" | cut -d" " -f1 |
+	git cat-file --batch-check="%(objecttype) %(objectsize:disk)" |
+	perl -lane '
+		$count{$F[0]}++; $size{$F[0]} += $F[1];
+		END {
+			printf "%s %d %d\n", $_, $count{$_}, $size{$_}
+				for qw(commit tree blob tag);
+		}
+	'
+}
+
+# check behavior with given rev-list options; note that
+# whitespace is not preserved in args
+check_du () {
+	args=$*
+
+	test_expect_success "generate expected size ($args)" "
+		disk_usage_slow $args >expect &&
+		by_type_slow $args >expect.by-type
+	"
+
+	test_expect_success "rev-list --disk-usage without bitmaps ($args)" "
+		git rev-list --disk-usage $args >actual &&
+		test_cmp expect actual &&
+		git rev-list --disk-usage=by-type $args >actual &&
+		test_cmp expect.by-type actual
+	"
+
+	test_expect_success "rev-list --disk-usage with bitmaps ($args)" "
+		git rev-list --disk-usage --use-bitmap-index $args >actual &&
+		test_cmp expect actual &&
+		git rev-list --disk-usage=by-type --use-bitmap-index $args >actual &&
+		test_cmp expect.by-type actual
+	"
+}
+
+check_du HEAD
+check_du --objects HEAD
+check_du --objects HEAD^..HEAD
+check_du --objects annotated
+check_du --objects --all
+
+test_expect_success 'rev-list --disk-usage rejects unknown formats' '
+	test_must_fail git rev-list --disk-usage=bogus HEAD
+'
+
+test_done
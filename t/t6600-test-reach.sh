@@ -269,6 +269,72 @@ test_expect_success 'commit_contains:miss' '
 	test_three_modes commit_contains --tag
 '
 
+test_expect_success 'commit_contains_many' '
+	cat >input <<-\EOF &&
+	X:commit-7-7
+	X:commit-6-5
+	X:commit-9-3
+	X:commit-2-10
+	X:commit-5-5
+	X:commit-10-1
+	Y:commit-6-6
+	Y:commit-8-2
+	Y:commit-9-9
+	EOF
+	echo "commit_contains_many(_,X,Y,_):101000" >expect &&
+	test_three_modes commit_contains_many &&
+	test_three_modes commit_contains_many --tag
+'
+
+test_expect_success 'commit_contains_many:none' '
+	cat >input <<-\EOF &&
+	X:commit-7-7
+	X:commit-6-5
+	X:commit-1-10
+	Y:commit-8-8
+	Y:commit-9-1
+	EOF
+	echo "commit_contains_many(_,X,Y,_):000" >expect &&
+	test_three_modes commit_contains_many &&
+	test_three_modes commit_contains_many --tag
+'
+
+test_expect_success 'branch --contains and --merged' '
+	git branch --contains commit-8-8 >expect &&
+	test_line_count = 10 expect &&
+	run_three_modes git branch --contains commit-8-8 &&
+	git branch --no-contains commit-3-3 --contains commit-2-2 >expect &&
+	run_three_modes git branch --no-contains commit-3-3 --contains commit-2-2 &&
+	git branch --merged commit-5-4 >expect &&
+	test_line_count = 20 expect &&
+	run_three_modes git branch --merged commit-5-4 &&
+	git branch --no-merged commit-5-4 >expect &&
+	run_three_modes git branch --no-merged commit-5-4
+'
+
+test_expect_success 'tag --contains and --merged' '
+	git tag --contains commit-8-8 >expect &&
+	test_line_count = 9 expect &&
+	run_three_modes git tag --contains commit-8-8 &&
+	git tag --merged commit-5-4 >expect &&
+	run_three_modes git tag --merged commit-5-4
+'
+
+test_expect_success 'rev-list --count' '
+	echo 100 >expect &&
+	run_three_modes git rev-list --count commit-10-10 &&
+	echo 19 >expect &&
+	run_three_modes git rev-list --count --first-parent commit-10-10 &&
+	echo 7 >expect &&
+	run_three_modes git rev-list --count --first-parent commit-5-10 ^commit-6-3 &&
+	echo 54 >expect &&
+	run_three_modes git rev-list --count commit-9-9 ^commit-3-6 ^commit-6-3 &&
+	echo 20 >expect &&
+	run_three_modes git rev-list --count commit-6-6...commit-8-4 &&
+	echo 10 >expect &&
+	run_three_modes git rev-list --count --max-count=10 tag-7-7
+'
+
 test_expect_success 'rev-list: basic topo-order' '
 	git rev-parse \
 		commit-6-6 commit-5-6 commit-4-6 commit-3-6 commit-2-6 commit-1-6 \
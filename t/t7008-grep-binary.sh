@@ -246,4 +246,22 @@ test_expect_success 'grep --textconv blob honors textconv' '
 	test_cmp expect actual
 '
 
+test_expect_success 'grep --textconv in a revision with threads' '
+	mkdir conv &&
+	for i in $(test_seq 40)
+	do
+		printf "line\000$i\000Qfile\n" >conv/file$i || return 1
+	done &&
+	echo "conv/* diff=foo" >>.gitattributes &&
+	git add conv .gitattributes &&
+	git commit -q -m conv &&
+	git grep --threads=1 --textconv QQfile HEAD >expect &&
+	test_line_count = 40 expect &&
+	git grep --threads=8 --textconv QQfile HEAD >actual &&
+	test_cmp expect actual &&
+	git grep --threads=8 --textconv --cached QQfile >actual &&
+	sed -e "s/^HEAD://" expect >expect.cached &&
+	test_cmp expect.cached actual
+'
+
 test_done
@@ -0,0 +1,70 @@
+#!/bin/sh
+
+test_description='git status re-hashes stat-dirty files while preloading the index'
+
+. ./test-lib.sh
+
+GIT_TEST_PRELOAD_INDEX=true
+export GIT_TEST_PRELOAD_INDEX
+
+# How many files the preload threads found unchanged by hashing them.
+rehashed () {
+	sed -n "s/.*preload index, \([0-9]*\) re-hashed\$/\1/p" perf | head -n 1
+}
+
+test_expect_success 'setup' '
+	for i in 1 2 3 4 5 6 7 8
+	do
+		echo "content $i" >file$i || return 1
+	done &&
+	git add file* &&
+	git commit -m initial
+'
+
+test_expect_success 'status records refreshed stat information' '
+	test-tool chmtime -60 file* &&
+	git diff-files --name-only >actual &&
+	test_line_count = 8 actual &&
+	GIT_TRACE_PERFORMANCE="$(pwd)/perf" git status --porcelain -uno >actual &&
+	test_must_be_empty actual &&
+	test "$(rehashed)" = 8 &&
+	rm perf &&
+	git diff-files --name-only >actual &&
+	test_must_be_empty actual
+'
+
+test_expect_success 'same-sized modification is still noticed' '
+	echo "Content 3" >file3 &&
+	test-tool chmtime -120 file* &&
+	GIT_TRACE_PERFORMANCE="$(pwd)/perf" git status --porcelain -uno >actual &&
+	echo " M file3" >expect &&
+	test_cmp expect actual &&
+	test "$(rehashed)" = 7 &&
+	rm perf &&
+	git diff-files --name-only >actual &&
+	echo file3 >expect &&
+	test_cmp expect actual &&
+	git checkout file3
+'
+
+test_expect_success 'files that need conversion are checked too' '
+	git config filter.rot13.clean "tr a-zA-Z n-za-mN-ZA-M" &&
+	echo "file5 filter=rot13" >.git/info/attributes &&
+	test-tool chmtime -180 file* &&
+	GIT_TRACE_PERFORMANCE="$(pwd)/perf" git status --porcelain -uno >actual &&
+	echo " M file5" >expect &&
+	test_cmp expect actual &&
+	test "$(rehashed)" = 7 &&
+	rm perf
+'
+
+test_expect_success 'nothing is re-hashed in threads without core.preloadIndex' '
+	test-tool chmtime -240 file* &&
+	GIT_TRACE_PERFORMANCE="$(pwd)/perf" GIT_TEST_PRELOAD_INDEX=false \
+		git -c core.preloadIndex=false status --porcelain -uno >actual &&
+	echo " M file5" >expect &&
+	test_cmp expect actual &&
+	! grep "re-hashed" perf
+'
+
+test_done
@@ -0,0 +1,71 @@
+#!/bin/sh
+
+test_description='untracked files are found the same way with and without preloaded directories'
+
+. ./test-lib.sh
+
+GIT_TEST_PRELOAD_INDEX=true
+export GIT_TEST_PRELOAD_INDEX
+
+test_expect_success 'setup' '
+	mkdir -p tracked/sub untracked/deep/er ignored/sub mixed empty/a/b &&
+	for d in tracked tracked/sub mixed
+	do
+		echo tracked >$d/file || return 1
+	done &&
+	git add . &&
+	git commit -m initial &&
+	for d in tracked tracked/sub untracked untracked/deep/er ignored ignored/sub mixed
+	do
+		echo untracked >$d/new || return 1
+	done &&
+	echo "*.o" >mixed/.gitignore &&
+	echo build >mixed/prog.o &&
+	echo /ignored/ >.gitignore &&
+	git init nested &&
+	test_commit -C nested inside
+'
+
+# keep the output out of the working tree we are scanning
+compare () {
+	git -c core.preloadIndex=false "$@" >.git/expect &&
+	git "$@" >.git/actual &&
+	test_cmp .git/expect .git/actual
+}
+
+test_expect_success 'status' '
+	compare status --porcelain &&
+	compare status --porcelain --untracked-files=all &&
+	compare status --porcelain --ignored &&
+	compare status --porcelain --ignored=matching -uall
+'
+
+test_expect_success 'status with pathspec' '
+	compare status --porcelain -uall tracked untracked/deep
+'
+
+test_expect_success 'ls-files' '
+	compare ls-files -o &&
+	compare ls-files -o --directory &&
+	compare ls-files -o -i --exclude-standard &&
+	compare ls-files -k
+'
+
+test_expect_success 'clean' '
+	compare clean -n &&
+	compare clean -nd &&
+	compare clean -ndx &&
+	compare clean -ndX
+'
+
+test_expect_success 'add' '
+	compare add -n . &&
+	git add . &&
+	git ls-files >.git/expect &&
+	git reset -q &&
+	git -c core.preloadIndex=false add . &&
+	git ls-files >.git/actual &&
+	test_cmp .git/expect .git/actual
+'
+
+test_done
@@ -931,6 +931,15 @@ do
 	"
 done
 
+test_expect_success 'grep in revisions and the index with threads' '
+	git grep --threads=1 -e a HEAD HEAD^ >expect &&
+	git grep --threads=4 -e a HEAD HEAD^ >actual &&
+	test_cmp expect actual &&
+	git grep --threads=1 --cached -e a >expect &&
+	git grep --threads=4 --cached -e a >actual &&
+	test_cmp expect actual
+'
+
 test_expect_success !PTHREADS,C_LOCALE_OUTPUT 'grep --threads=N or pack.threads=N warns when no pthreads' '
 	git grep --threads=2 Hello hello_world 2>err &&
 	grep ^warning: err >warnings &&
@@ -1283,6 +1283,7 @@ test -z "$NO_PYTHON" && test_set_prereq PYTHON
 test -n "$USE_LIBPCRE1$USE_LIBPCRE2" && test_set_prereq PCRE
 test -n "$USE_LIBPCRE1" && test_set_prereq LIBPCRE1
 test -n "$USE_LIBPCRE2" && test_set_prereq LIBPCRE2
+test -n "$USE_ZSTD" && test_set_prereq ZSTD
 test -z "$NO_GETTEXT" && test_set_prereq GETTEXT
 
 if test -n "$GIT_TEST_GETTEXT_POISON_ORIG"
@@ -279,6 +279,65 @@ int tmp_objdir_migrate(struct tmp_objdir *t)
 	return ret;
 }
 
+const char *tmp_objdir_path(const struct tmp_objdir *t)
+{
+	return t->path.buf;
+}
+
+#ifdef HAVE_SYNCFS
+int tmp_objdir_sync(const struct tmp_objdir *t)
+{
+	int fd, ret;
+
+	fd = open(t->path.buf, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	ret = syncfs(fd);
+	close(fd);
+	return ret;
+}
+#else
+static int sync_paths(struct strbuf *path)
+{
+	size_t len = path->len;
+	struct string_list paths = STRING_LIST_INIT_DUP;
+	struct stat st;
+	int i, fd, ret = 0;
+
+	if (read_dir_paths(&paths, path->buf) < 0)
+		return -1;
+
+	for (i = 0; !ret && i < paths.nr; i++) {
+		strbuf_addf(path, "/%s", paths.items[i].string);
+		if (stat(path->buf, &st) < 0)
+			ret = -1;
+		else if (S_ISDIR(st.st_mode))
+			ret = sync_paths(path);
+		else if ((fd = open(path->buf, O_RDONLY)) < 0)
+			ret = -1;
+		else {
+			ret = fsync(fd);
+			close(fd);
+		}
+		strbuf_setlen(path, len);
+	}
+
+	string_list_clear(&paths, 0);
+	return ret;
+}
+
+int tmp_objdir_sync(const struct tmp_objdir *t)
+{
+	struct strbuf path = STRBUF_INIT;
+	int ret;
+
+	strbuf_addbuf(&path, &t->path);
+	ret = sync_paths(&path);
+	strbuf_release(&path);
+	return ret;
+}
+#endif
+
 const char **tmp_objdir_env(const struct tmp_objdir *t)
 {
 	if (!t)
@@ -33,6 +33,19 @@ struct tmp_objdir *tmp_objdir_create(void);
  */
 const char **tmp_objdir_env(const struct tmp_objdir *);
 
+/*
+ * Return the path of the temporary object directory.
+ */
+const char *tmp_objdir_path(const struct tmp_objdir *);
+
+/*
+ * Make everything written to the temporary object directory so far
+ * durable, in one go where the platform allows it (syncfs), so that
+ * the objects can be migrated without syncing each one on its own.
+ * Returns 0 on success, -1 with errno set on failure.
+ */
+int tmp_objdir_sync(const struct tmp_objdir *);
+
 /*
  * Finalize a temporary object directory by migrating its objects into the main
  * object database, removing the temporary directory, and freeing any
@@ -5,6 +5,9 @@
 #include "object-store.h"
 #include "tree.h"
 #include "pathspec.h"
+#include "oidmap.h"
+#include "list.h"
+#include "config.h"
 
 static const char *get_mode(const char *str, unsigned int *modep)
 {
@@ -57,6 +60,7 @@ static int init_tree_desc_internal(struct tree_desc *desc, const void *buffer, u
 {
 	desc->buffer = buffer;
 	desc->size = size;
+	desc->decoded = NULL;
 	if (size)
 		return decode_tree_entry(desc, buffer, size, err);
 	return 0;
@@ -80,17 +84,224 @@ int init_tree_desc_gently(struct tree_desc *desc, const void *buffer, unsigned l
 	return result;
 }
 
+/*
+ * The decoded tree cache remembers, for recently walked trees, where
+ * each entry's name and object name start in the tree buffer, and its
+ * mode.  The offsets are relative to the start of the buffer, so that
+ * they can be applied to any copy of the same tree.
+ *
+ * A tree_desc walking a cached tree refers to the cache entry, which
+ * may be evicted (or reused for another tree) behind its back.  Cache
+ * entries are therefore never freed, only their entry arrays are, and
+ * "gen" is bumped whenever that happens; a tree_desc that notices it
+ * simply goes on parsing the buffer.
+ *
+ * Most trees are only walked once or twice (e.g. "log --raw" sees
+ * each tree once as the new and once as the old side of a diff), and
+ * decoding them into the cache would cost more than it saves.  A tree
+ * is therefore only admitted on its third walk, counted in a small
+ * direct-mapped table of recently seen trees.
+ */
+struct decoded_entry {
+	unsigned int path, oid;
+	unsigned int mode;
+};
+
+struct decoded_tree {
+	struct oidmap_entry ent;
+	struct list_head lru;
+	unsigned int gen;
+	unsigned int nr, alloc;
+	unsigned long size;
+	struct decoded_entry *entries;
+};
+
+#define DECODED_TREE_MAX_TREES 4096
+#define DECODED_TREE_MAX_ENTRIES (1 << 18)
+#define DECODED_TREE_ADMIT 3
+
+static struct oidmap decoded_trees = OIDMAP_INIT;
+static LIST_HEAD(decoded_tree_lru);
+static LIST_HEAD(decoded_tree_unused);
+static unsigned int decoded_trees_nr, decoded_entries_nr;
+
+struct seen_tree {
+	struct object_id oid;
+	unsigned int count;
+};
+static struct seen_tree *recently_seen_trees;
+
+/* GIT_TEST_DECODED_TREE_CACHE=<n> caps the cache at n trees, 0 disables it */
+static unsigned long decoded_tree_max_trees(void)
+{
+	static unsigned long max;
+	static int initialized;
+
+	if (!initialized) {
+		max = git_env_ulong("GIT_TEST_DECODED_TREE_CACHE",
+				    DECODED_TREE_MAX_TREES);
+		initialized = 1;
+	}
+	return max;
+}
+
+static void evict_decoded_tree(struct decoded_tree *t)
+{
+	oidmap_remove(&decoded_trees, &t->ent.oid);
+	list_del(&t->lru);
+	list_add_tail(&t->lru, &decoded_tree_unused);
+	decoded_trees_nr--;
+	decoded_entries_nr -= t->nr;
+	FREE_AND_NULL(t->entries);
+	t->nr = t->alloc = 0;
+	t->gen++;
+}
+
+/*
+ * Decode all entries of the tree into "t".  Returns -1 if the tree is
+ * corrupt; such a tree is left to the usual code path, which knows how
+ * to complain about it.
+ */
+static int decode_whole_tree(struct decoded_tree *t, const char *buf,
+			     unsigned long size)
+{
+	const unsigned hashsz = the_hash_algo->rawsz;
+	struct strbuf err = STRBUF_INIT;
+	struct tree_desc desc;
+	unsigned long pos = 0;
+
+	while (pos < size) {
+		struct decoded_entry *e;
+
+		if (decode_tree_entry(&desc, buf + pos, size - pos, &err)) {
+			strbuf_release(&err);
+			return -1;
+		}
+		ALLOC_GROW(t->entries, t->nr + 1, t->alloc);
+		e = &t->entries[t->nr++];
+		e->path = desc.entry.path - buf;
+		e->oid = (const char *)desc.entry.oid - buf;
+		e->mode = desc.entry.mode;
+		pos = e->oid + hashsz;
+	}
+	return 0;
+}
+
+static struct decoded_tree *get_decoded_tree(const struct object_id *oid,
+					     const void *buf,
+					     unsigned long size)
+{
+	struct decoded_tree *t;
+	struct seen_tree *seen;
+
+	if (!decoded_trees.map.cmpfn)
+		oidmap_init(&decoded_trees, 0);
+
+	t = oidmap_get(&decoded_trees, oid);
+	if (t) {
+		if (t->size != size)
+			return NULL;
+		list_del(&t->lru);
+		list_add_tail(&t->lru, &decoded_tree_lru);
+		return t;
+	}
+
+	if (!recently_seen_trees)
+		recently_seen_trees = xcalloc(DECODED_TREE_MAX_TREES,
+					      sizeof(*recently_seen_trees));
+	seen = &recently_seen_trees[sha1hash(oid->hash) % DECODED_TREE_MAX_TREES];
+	if (!oideq(&seen->oid, oid)) {
+		oidcpy(&seen->oid, oid);
+		seen->count = 1;
+		return NULL;
+	}
+	if (++seen->count < DECODED_TREE_ADMIT)
+		return NULL;
+
+	if (!list_empty(&decoded_tree_unused)) {
+		t = list_entry(decoded_tree_unused.next, struct decoded_tree, lru);
+		list_del(&t->lru);
+	} else {
+		t = xcalloc(1, sizeof(*t));
+	}
+	if (decode_whole_tree(t, buf, size)) {
+		FREE_AND_NULL(t->entries);
+		t->nr = t->alloc = 0;
+		list_add_tail(&t->lru, &decoded_tree_unused);
+		return NULL;
+	}
+	oidcpy(&t->ent.oid, oid);
+	t->size = size;
+	oidmap_put(&decoded_trees, t);
+	list_add_tail(&t->lru, &decoded_tree_lru);
+	decoded_trees_nr++;
+	decoded_entries_nr += t->nr;
+
+	while (decoded_trees_nr > decoded_tree_max_trees() ||
+	       decoded_entries_nr > DECODED_TREE_MAX_ENTRIES) {
+		struct decoded_tree *lru = list_entry(decoded_tree_lru.next,
+						      struct decoded_tree, lru);
+		if (lru == t)
+			break;
+		evict_decoded_tree(lru);
+	}
+	return t;
+}
+
+static inline unsigned int decoded_entry_start(const struct decoded_tree *t,
+					       unsigned int pos)
+{
+	return pos ? t->entries[pos - 1].oid + the_hash_algo->rawsz : 0;
+}
+
+/*
+ * Point "desc" at entry number "pos" of its decoded tree, given the
+ * start of the tree buffer.
+ */
+static void set_decoded_entry(struct tree_desc *desc, const char *base,
+			      unsigned int pos)
+{
+	const struct decoded_tree *t = desc->decoded;
+	unsigned int start = decoded_entry_start(t, pos);
+
+	desc->decoded_pos = pos;
+	desc->buffer = base + start;
+	desc->size = t->size - start;
+	if (pos < t->nr) {
+		desc->entry.path = base + t->entries[pos].path;
+		desc->entry.oid = (const struct object_id *)(base + t->entries[pos].oid);
+		desc->entry.mode = t->entries[pos].mode;
+	}
+}
+
+void init_tree_desc_cached(struct tree_desc *desc, const struct object_id *oid,
+			   const void *buf, unsigned long size)
+{
+	struct decoded_tree *t = NULL;
+
+	if (size && oid && decoded_tree_max_trees())
+		t = get_decoded_tree(oid, buf, size);
+	if (!t) {
+		init_tree_desc(desc, buf, size);
+		return;
+	}
+	desc->decoded = t;
+	desc->decoded_gen = t->gen;
+	set_decoded_entry(desc, buf, 0);
+}
+
 void *fill_tree_descriptor(struct tree_desc *desc, const struct object_id *oid)
 {
 	unsigned long size = 0;
 	void *buf = NULL;
+	struct object_id real_oid;
 
 	if (oid) {
-		buf = read_object_with_reference(oid, tree_type, &size, NULL);
+		buf = read_object_with_reference(oid, tree_type, &size, &real_oid);
 		if (!buf)
 			die("unable to read tree %s", oid_to_hex(oid));
 	}
-	init_tree_desc(desc, buf, size);
+	init_tree_desc_cached(desc, oid ? &real_oid : NULL, buf, size);
 	return buf;
 }
 
@@ -111,6 +322,19 @@ static int update_tree_entry_internal(struct tree_desc *desc, struct strbuf *err
 	unsigned long size = desc->size;
 	unsigned long len = end - (const unsigned char *)buf;
 
+	if (desc->decoded) {
+		const struct decoded_tree *t = desc->decoded;
+
+		if (t->gen == desc->decoded_gen && desc->decoded_pos < t->nr) {
+			unsigned int pos = desc->decoded_pos;
+			set_decoded_entry(desc, (const char *)buf -
+					  decoded_entry_start(t, pos), pos + 1);
+			return 0;
+		}
+		/* evicted while we were walking it */
+		desc->decoded = NULL;
+	}
+
 	if (size < len)
 		die(_("too-short tree file"));
 	buf = end;
@@ -549,7 +773,7 @@ int get_tree_entry(const struct object_id *tree_oid, const char *name, struct ob
 		retval = -1;
 	} else {
 		struct tree_desc t;
-		init_tree_desc(&t, tree, size);
+		init_tree_desc_cached(&t, &root, tree, size);
 		retval = find_tree_entry(&t, name, oid, mode);
 	}
 	free(tree);
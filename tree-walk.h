@@ -2,6 +2,7 @@
 #define TREE_WALK_H
 
 struct strbuf;
+struct decoded_tree;
 
 struct name_entry {
 	const struct object_id *oid;
@@ -13,6 +14,14 @@ struct tree_desc {
 	const void *buffer;
 	struct name_entry entry;
 	unsigned int size;
+
+	/*
+	 * Set when the tree was found in the decoded tree cache; the
+	 * entries are then taken from there instead of being parsed out
+	 * of the buffer again (see init_tree_desc_cached()).
+	 */
+	const struct decoded_tree *decoded;
+	unsigned int decoded_gen, decoded_pos;
 };
 
 static inline const struct object_id *tree_entry_extract(struct tree_desc *desc, const char **pathp, unsigned int *modep)
@@ -37,6 +46,15 @@ int update_tree_entry_gently(struct tree_desc *);
 void init_tree_desc(struct tree_desc *desc, const void *buf, unsigned long size);
 int init_tree_desc_gently(struct tree_desc *desc, const void *buf, unsigned long size);
 
+/*
+ * Like init_tree_desc(), for the contents of the tree "oid".  Trees
+ * that are walked often are kept in a bounded LRU cache of decoded
+ * entries, so that walking them again does not parse the buffer.  The
+ * buffer must still be kept around while walking.  Not thread-safe.
+ */
+void init_tree_desc_cached(struct tree_desc *desc, const struct object_id *oid,
+			   const void *buf, unsigned long size);
+
 /*
  * Helper function that does both tree_entry_extract() and update_tree_entry()
  * and returns true for success
@@ -73,7 +73,8 @@ static int read_tree_1(struct tree *tree, struct strbuf *base,
 	if (parse_tree(tree))
 		return -1;
 
-	init_tree_desc(&desc, tree->buffer, tree->size);
+	init_tree_desc_cached(&desc, &tree->object.oid,
+			      tree->buffer, tree->size);
 
 	while (tree_entry(&desc, &entry)) {
 		if (retval != all_entries_interesting) {
@@ -18,6 +18,7 @@
 #include "fsmonitor.h"
 #include "object-store.h"
 #include "fetch-object.h"
+#include "packfile.h"
 
 /*
  * Error messages expected by scripts out of plumbing commands such as
@@ -376,6 +377,31 @@ static void report_collided_checkout(struct index_state *index)
 	string_list_clear(&list, 0);
 }
 
+/* how many index entries to read the blobs ahead for at once */
+#define CHECKOUT_PREFETCH 1024
+
+/*
+ * We check out in path order, which jumps all over the packs; have the
+ * blobs of the next few entries read ahead in pack order instead.
+ * Returns the position of the first entry not covered.
+ */
+static int prefetch_updates(struct index_state *index, int pos)
+{
+	struct oid_array to_read = OID_ARRAY_INIT;
+	int end = pos + CHECKOUT_PREFETCH;
+
+	if (end > index->cache_nr)
+		end = index->cache_nr;
+	for (; pos < end; pos++) {
+		const struct cache_entry *ce = index->cache[pos];
+		if ((ce->ce_flags & CE_UPDATE) && !S_ISGITLINK(ce->ce_mode))
+			oid_array_append(&to_read, &ce->oid);
+	}
+	prefetch_packed_objects(the_repository, to_read.oid, to_read.nr);
+	oid_array_clear(&to_read);
+	return end;
+}
+
 static int check_updates(struct unpack_trees_options *o)
 {
 	unsigned cnt = 0;
@@ -383,7 +409,7 @@ static int check_updates(struct unpack_trees_options *o)
 	struct progress *progress;
 	struct index_state *index = &o->result;
 	struct checkout state = CHECKOUT_INIT;
-	int i;
+	int i, prefetched = 0;
 
 	trace_performance_enter();
 	state.force = 1;
@@ -443,6 +469,8 @@ static int check_updates(struct unpack_trees_options *o)
 	for (i = 0; i < index->cache_nr; i++) {
 		struct cache_entry *ce = index->cache[i];
 
+		if (o->update && !o->dry_run && i >= prefetched)
+			prefetched = prefetch_updates(index, i);
 		if (ce->ce_flags & CE_UPDATE) {
 			if (ce->ce_flags & CE_WT_REMOVE)
 				BUG("both update and delete flags are set on %s",
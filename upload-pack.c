@@ -47,6 +47,7 @@ static int deepen_relative;
 static int multi_ack;
 static int no_done;
 static int use_thin_pack, use_ofs_delta, use_include_tag;
+static int use_zstd, allow_zstd;
 static int no_progress, daemon_mode;
 /* Allow specifying sha1 if it is a ref tip. */
 #define ALLOW_TIP_SHA1	01
@@ -137,6 +138,8 @@ static void create_pack_file(const struct object_array *have_obj,
 		argv_array_push(&pack_objects.args, "--progress");
 	if (use_ofs_delta)
 		argv_array_push(&pack_objects.args, "--delta-base-offset");
+	if (use_zstd)
+		argv_array_push(&pack_objects.args, "--compression-codec=zstd");
 	if (use_include_tag)
 		argv_array_push(&pack_objects.args, "--include-tag");
 	if (filter_options.filter_spec) {
@@ -344,7 +347,7 @@ static int got_oid(const char *hex, struct object_id *oid,
 static int ok_to_give_up(const struct object_array *have_obj,
 			 struct object_array *want_obj)
 {
-	uint32_t min_generation = GENERATION_NUMBER_ZERO;
+	timestamp_t min_generation = GENERATION_NUMBER_ZERO;
 
 	if (!have_obj->nr)
 		return 0;
@@ -880,6 +883,8 @@ static void receive_needs(struct object_array *want_obj)
 			use_thin_pack = 1;
 		if (parse_feature_request(features, "ofs-delta"))
 			use_ofs_delta = 1;
+		if (allow_zstd && parse_feature_request(features, "zstd"))
+			use_zstd = 1;
 		if (parse_feature_request(features, "side-band-64k"))
 			use_sideband = LARGE_PACKET_MAX;
 		else if (parse_feature_request(features, "side-band"))
@@ -979,7 +984,7 @@ static int send_ref(const char *refname, const struct object_id *oid,
 		struct strbuf symref_info = STRBUF_INIT;
 
 		format_symref_info(&symref_info, cb_data);
-		packet_write_fmt(1, "%s %s%c%s%s%s%s%s%s agent=%s\n",
+		packet_write_fmt(1, "%s %s%c%s%s%s%s%s%s%s agent=%s\n",
 			     oid_to_hex(oid), refname_nons,
 			     0, capabilities,
 			     (allow_unadvertised_object_request & ALLOW_TIP_SHA1) ?
@@ -989,6 +994,7 @@ static int send_ref(const char *refname, const struct object_id *oid,
 			     stateless_rpc ? " no-done" : "",
 			     symref_info.buf,
 			     allow_filter ? " filter" : "",
+			     allow_zstd ? " zstd" : "",
 			     git_user_agent_sanitized());
 		strbuf_release(&symref_info);
 	} else {
@@ -1041,6 +1047,9 @@ static int upload_pack_config(const char *var, const char *value, void *unused)
 		allow_filter = git_config_bool(var, value);
 	} else if (!strcmp("uploadpack.allowrefinwant", var)) {
 		allow_ref_in_want = git_config_bool(var, value);
+	} else if (!strcmp("uploadpack.allowzstd", var)) {
+		allow_zstd = git_config_bool(var, value) &&
+			     git_zcodec_supported(GIT_ZCODEC_ZSTD);
 	}
 
 	if (current_config_scope() != CONFIG_SCOPE_REPO) {
@@ -1234,6 +1243,10 @@ static void process_args(struct packet_reader *request,
 			use_ofs_delta = 1;
 			continue;
 		}
+		if (allow_zstd && !strcmp(arg, "zstd")) {
+			use_zstd = 1;
+			continue;
+		}
 		if (!strcmp(arg, "no-progress")) {
 			no_progress = 1;
 			continue;
@@ -1475,6 +1488,7 @@ int upload_pack_v2(struct repository *r, struct argv_array *keys,
 	upload_pack_data_clear(&data);
 	object_array_clear(&have_obj);
 	object_array_clear(&want_obj);
+	object_array_clear(&extra_edge_obj);
 	return 0;
 }
 
@@ -1484,6 +1498,7 @@ int upload_pack_advertise(struct repository *r,
 	if (value) {
 		int allow_filter_value;
 		int allow_ref_in_want;
+		int allow_zstd_value;
 
 		strbuf_addstr(value, "shallow");
 
@@ -1498,6 +1513,12 @@ int upload_pack_advertise(struct repository *r,
 					 &allow_ref_in_want) &&
 		    allow_ref_in_want)
 			strbuf_addstr(value, " ref-in-want");
+
+		if (!repo_config_get_bool(the_repository,
+					 "uploadpack.allowzstd",
+					 &allow_zstd_value) &&
+		    allow_zstd_value && git_zcodec_supported(GIT_ZCODEC_ZSTD))
+			strbuf_addstr(value, " zstd");
 	}
 
 	return 1;
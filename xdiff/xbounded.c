@@ -0,0 +1,257 @@
+/*
+ *  LibXDiff by Davide Libenzi ( File Differential Library )
+ *  Copyright (C) 2003-2016 Davide Libenzi, Johannes E. Schindelin
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Davide Libenzi <davidel@xmailserver.org>
+ *
+ */
+#include "xinclude.h"
+
+/*
+ * The bounded diff is a variant of the patience diff that is meant for
+ * huge inputs (generated lockfiles, data dumps and the like), where the
+ * other algorithms can take quadratic time.
+ *
+ * Like patience, it anchors on lines that are unique in both ranges,
+ * keeps the longest ordered sequence of them and recurses into the
+ * gaps.  Unlike patience, it charges every step against a budget:
+ *
+ *  - scanning a range and finding its unique lines costs the size of
+ *    the range, and sorting out the anchors costs n log n;
+ *
+ *  - a range without unique lines is handed to the Myers algorithm
+ *    only if its worst case (the product of both sides) fits into what
+ *    is left of the budget.
+ *
+ * Once the budget is used up, every range that still needs work is
+ * simply reported as a whole-block replacement.  The result is coarser
+ * than what the other algorithms would produce, but it is still a
+ * valid diff, and both the time and the memory needed (everything is
+ * indexed by the equivalence classes from xdl_classify_record()) stay
+ * linear in the size of the input.
+ */
+
+#define XDL_BOUNDED_COST_MIN (1L << 20)
+#define XDL_BOUNDED_COST_FACTOR 64
+
+typedef struct s_xdbounded {
+	xdfenv_t *env;
+	xpparam_t const *xpp;
+	long budget;
+
+	/*
+	 * Indexed by equivalence class: how often the class occurs in
+	 * the current range on either side, and where it was last seen
+	 * on the second side.  Counts are reset after every use so that
+	 * they can be shared by all recursion levels.
+	 */
+	long *cnt1, *cnt2, *pos2;
+} xdbounded_t;
+
+typedef struct s_xdanchor {
+	long i1, i2;
+} xdanchor_t;
+
+static void mark_changed(xdbounded_t *bd, long off1, long lim1,
+			 long off2, long lim2)
+{
+	if (off1 < lim1)
+		memset(bd->env->xdf1.rchg + off1, 1, lim1 - off1);
+	if (off2 < lim2)
+		memset(bd->env->xdf2.rchg + off2, 1, lim2 - off2);
+}
+
+static int fall_back_to_classic_diff(xdbounded_t *bd, long off1, long lim1,
+				     long off2, long lim2)
+{
+	long n1 = lim1 - off1, n2 = lim2 - off2;
+	xpparam_t xpp;
+
+	if (n1 > bd->budget / n2) {
+		mark_changed(bd, off1, lim1, off2, lim2);
+		bd->budget = 0;
+		return 0;
+	}
+	bd->budget -= n1 * n2;
+
+	memset(&xpp, 0, sizeof(xpp));
+	xpp.flags = bd->xpp->flags & ~XDF_DIFF_ALGORITHM_MASK;
+	return xdl_fall_back_diff(bd->env, &xpp, off1 + 1, n1, off2 + 1, n2);
+}
+
+/*
+ * Find the lines in [off1, lim1) and [off2, lim2) that occur exactly
+ * once on each side and return the longest sequence of them that is
+ * ordered the same way on both sides.  Returns the number of anchors
+ * stored in *anchors, 0 if there are none, or -1 on error.
+ */
+static long find_anchors(xdbounded_t *bd, long off1, long lim1,
+			 long off2, long lim2, xdanchor_t **anchors)
+{
+	xrecord_t **recs1 = bd->env->xdf1.recs, **recs2 = bd->env->xdf2.recs;
+	long i, n = 0, longest = 0, lo, hi, mid;
+	long *line1, *line2, *tails, *prev;
+
+	for (i = off1; i < lim1; i++)
+		bd->cnt1[recs1[i]->ha]++;
+	for (i = off2; i < lim2; i++) {
+		bd->cnt2[recs2[i]->ha]++;
+		bd->pos2[recs2[i]->ha] = i;
+	}
+	for (i = off1; i < lim1; i++) {
+		unsigned long c = recs1[i]->ha;
+		if (bd->cnt1[c] == 1 && bd->cnt2[c] == 1)
+			n++;
+	}
+
+	line1 = NULL;
+	if (n && !(line1 = (long *) xdl_malloc(4 * n * sizeof(long))))
+		n = -1;
+
+	if (n > 0) {
+		line2 = line1 + n;
+		tails = line2 + n;
+		prev = tails + n;
+
+		for (n = 0, i = off1; i < lim1; i++) {
+			unsigned long c = recs1[i]->ha;
+			if (bd->cnt1[c] == 1 && bd->cnt2[c] == 1) {
+				line1[n] = i;
+				line2[n++] = bd->pos2[c];
+			}
+		}
+
+		/*
+		 * Longest increasing subsequence of line2; tails[k] is the
+		 * pair ending the best sequence of length k + 1 found so far.
+		 */
+		for (i = 0; i < n; i++) {
+			for (lo = 0, hi = longest; lo < hi; ) {
+				mid = lo + (hi - lo) / 2;
+				if (line2[tails[mid]] < line2[i])
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			prev[i] = lo ? tails[lo - 1] : -1;
+			tails[lo] = i;
+			if (lo == longest)
+				longest++;
+		}
+		bd->budget -= n * xdl_hashbits((unsigned int) n);
+
+		if (!(*anchors = (xdanchor_t *) xdl_malloc(longest * sizeof(xdanchor_t)))) {
+			n = -1;
+		} else {
+			for (i = tails[longest - 1], mid = longest; mid--; i = prev[i]) {
+				(*anchors)[mid].i1 = line1[i];
+				(*anchors)[mid].i2 = line2[i];
+			}
+			n = longest;
+		}
+	}
+	xdl_free(line1);
+
+	for (i = off1; i < lim1; i++)
+		bd->cnt1[recs1[i]->ha] = 0;
+	for (i = off2; i < lim2; i++)
+		bd->cnt2[recs2[i]->ha] = 0;
+
+	return n;
+}
+
+static int bounded_diff(xdbounded_t *bd, long off1, long lim1,
+			long off2, long lim2)
+{
+	xrecord_t **recs1 = bd->env->xdf1.recs, **recs2 = bd->env->xdf2.recs;
+	xdanchor_t *anchors = NULL;
+	long nr, i;
+	int ret = 0;
+
+	/* grow the common lines around the anchors we were given */
+	while (off1 < lim1 && off2 < lim2 &&
+	       recs1[off1]->ha == recs2[off2]->ha) {
+		off1++;
+		off2++;
+	}
+	while (off1 < lim1 && off2 < lim2 &&
+	       recs1[lim1 - 1]->ha == recs2[lim2 - 1]->ha) {
+		lim1--;
+		lim2--;
+	}
+
+	if (off1 == lim1 || off2 == lim2 || bd->budget <= 0) {
+		mark_changed(bd, off1, lim1, off2, lim2);
+		return 0;
+	}
+	bd->budget -= (lim1 - off1) + (lim2 - off2);
+
+	nr = find_anchors(bd, off1, lim1, off2, lim2, &anchors);
+	if (nr < 0)
+		return -1;
+	if (!nr)
+		return fall_back_to_classic_diff(bd, off1, lim1, off2, lim2);
+
+	for (i = 0; i < nr && !ret; i++) {
+		ret = bounded_diff(bd, off1, anchors[i].i1, off2, anchors[i].i2);
+		off1 = anchors[i].i1 + 1;
+		off2 = anchors[i].i2 + 1;
+	}
+	if (!ret)
+		ret = bounded_diff(bd, off1, lim1, off2, lim2);
+
+	xdl_free(anchors);
+	return ret;
+}
+
+int xdl_do_bounded_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
+			xdfenv_t *env)
+{
+	xdbounded_t bd;
+	long nclass;
+	int ret;
+
+	if (xdl_prepare_env(mf1, mf2, xpp, env) < 0)
+		return -1;
+
+	memset(&bd, 0, sizeof(bd));
+	bd.env = env;
+	bd.xpp = xpp;
+	if (xpp->max_cost > 0)
+		bd.budget = xpp->max_cost;
+	else
+		bd.budget = XDL_MAX(XDL_BOUNDED_COST_MIN,
+				    XDL_BOUNDED_COST_FACTOR *
+				    (env->xdf1.nrec + env->xdf2.nrec));
+
+	/* there cannot be more classes than records */
+	nclass = env->xdf1.nrec + env->xdf2.nrec + 1;
+	if (!(bd.cnt1 = (long *) xdl_malloc(3 * nclass * sizeof(long)))) {
+		xdl_free_env(env);
+		return -1;
+	}
+	memset(bd.cnt1, 0, 2 * nclass * sizeof(long));
+	bd.cnt2 = bd.cnt1 + nclass;
+	bd.pos2 = bd.cnt2 + nclass;
+
+	ret = bounded_diff(&bd, 0, env->xdf1.nrec, 0, env->xdf2.nrec);
+
+	xdl_free(bd.cnt1);
+	if (ret < 0)
+		xdl_free_env(env);
+	return ret;
+}
@@ -43,7 +43,8 @@ extern "C" {
 
 #define XDF_PATIENCE_DIFF (1 << 14)
 #define XDF_HISTOGRAM_DIFF (1 << 15)
-#define XDF_DIFF_ALGORITHM_MASK (XDF_PATIENCE_DIFF | XDF_HISTOGRAM_DIFF)
+#define XDF_BOUNDED_DIFF (1 << 16)
+#define XDF_DIFF_ALGORITHM_MASK (XDF_PATIENCE_DIFF | XDF_HISTOGRAM_DIFF | XDF_BOUNDED_DIFF)
 #define XDF_DIFF_ALG(x) ((x) & XDF_DIFF_ALGORITHM_MASK)
 
 #define XDF_INDENT_HEURISTIC (1 << 23)
@@ -82,6 +83,12 @@ typedef struct s_xpparam {
 	/* See Documentation/diff-options.txt. */
 	char **anchors;
 	size_t anchors_nr;
+
+	/*
+	 * Upper bound on the work (roughly, line comparisons) spent on
+	 * one diff; 0 means unlimited.  See "diff.maxCost".
+	 */
+	long max_cost;
 } xpparam_t;
 
 typedef struct s_xdemitcb {
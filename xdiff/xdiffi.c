@@ -304,6 +304,23 @@ int xdl_recs_cmp(diffdata_t *dd1, long off1, long lim1,
 }
 
 
+/*
+ * With a cost limit in effect, inputs for which the selected algorithm
+ * could do more work than allowed (judging by the worst case, the
+ * product of the estimated line counts) go to the bounded diff instead.
+ */
+static int xdl_exceeds_max_cost(mmfile_t *mf1, mmfile_t *mf2,
+				xpparam_t const *xpp) {
+	long nl1, nl2;
+
+	if (xpp->max_cost <= 0)
+		return 0;
+	nl1 = xdl_guess_lines(mf1, XDL_GUESS_NLINES1);
+	nl2 = xdl_guess_lines(mf2, XDL_GUESS_NLINES1);
+	return nl1 > xpp->max_cost / nl2;
+}
+
+
 int xdl_do_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 		xdfenv_t *xe) {
 	long ndiags;
@@ -311,6 +328,10 @@ int xdl_do_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 	xdalgoenv_t xenv;
 	diffdata_t dd1, dd2;
 
+	if (XDF_DIFF_ALG(xpp->flags) == XDF_BOUNDED_DIFF ||
+	    xdl_exceeds_max_cost(mf1, mf2, xpp))
+		return xdl_do_bounded_diff(mf1, mf2, xpp, xe);
+
 	if (XDF_DIFF_ALG(xpp->flags) == XDF_PATIENCE_DIFF)
 		return xdl_do_patience_diff(mf1, mf2, xpp, xe);
 
@@ -24,6 +24,8 @@
 #define XPREPARE_H
 
 
+#define XDL_GUESS_NLINES1 256
+#define XDL_GUESS_NLINES2 20
 
 int xdl_prepare_env(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 		    xdfenv_t *xe);
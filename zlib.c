@@ -3,6 +3,10 @@
  * at init time.
  */
 #include "cache.h"
+#include "thread-utils.h"
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 static const char *zerr_to_string(int status)
 {
@@ -64,10 +68,268 @@ static void zlib_post_call(git_zstream *s)
 	s->avail_out -= bytes_produced;
 }
 
+enum git_zcodec git_zcodec_from_name(const char *name)
+{
+	if (!strcmp(name, "zlib"))
+		return GIT_ZCODEC_ZLIB;
+	if (!strcmp(name, "zstd"))
+		return GIT_ZCODEC_ZSTD;
+	return GIT_ZCODEC_UNKNOWN;
+}
+
+int git_zcodec_supported(enum git_zcodec codec)
+{
+	switch (codec) {
+	case GIT_ZCODEC_ZLIB:
+		return 1;
+	case GIT_ZCODEC_ZSTD:
+#ifdef USE_ZSTD
+		return 1;
+#else
+		return 0;
+#endif
+	default:
+		return 0;
+	}
+}
+
+#ifdef USE_ZSTD
+/*
+ * Setting up a zstd context costs more than inflating a typical small
+ * object, so finished contexts are kept for the next stream instead of
+ * being freed.  A handful is enough for the threads git runs.
+ */
+#define ZSTD_POOL_MAX 8
+static pthread_mutex_t zstd_pool_mutex;
+static ZSTD_DCtx *dctx_pool[ZSTD_POOL_MAX];
+static int dctx_pool_nr;
+static ZSTD_CCtx *cctx_pool[ZSTD_POOL_MAX];
+static int cctx_pool_nr;
+
+static ZSTD_DCtx *get_dctx(void)
+{
+	ZSTD_DCtx *dctx = NULL;
+
+	pthread_mutex_lock(&zstd_pool_mutex);
+	if (dctx_pool_nr)
+		dctx = dctx_pool[--dctx_pool_nr];
+	pthread_mutex_unlock(&zstd_pool_mutex);
+	if (dctx)
+		ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+	else if (!(dctx = ZSTD_createDCtx()))
+		die("inflate: out of memory");
+	return dctx;
+}
+
+static void put_dctx(ZSTD_DCtx *dctx)
+{
+	pthread_mutex_lock(&zstd_pool_mutex);
+	if (dctx_pool_nr < ZSTD_POOL_MAX) {
+		dctx_pool[dctx_pool_nr++] = dctx;
+		dctx = NULL;
+	}
+	pthread_mutex_unlock(&zstd_pool_mutex);
+	ZSTD_freeDCtx(dctx);
+}
+
+static ZSTD_CCtx *get_cctx(void)
+{
+	ZSTD_CCtx *cctx = NULL;
+
+	pthread_mutex_lock(&zstd_pool_mutex);
+	if (cctx_pool_nr)
+		cctx = cctx_pool[--cctx_pool_nr];
+	pthread_mutex_unlock(&zstd_pool_mutex);
+	if (cctx)
+		ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters);
+	else if (!(cctx = ZSTD_createCCtx()))
+		die("deflate: out of memory");
+	return cctx;
+}
+
+static void put_cctx(ZSTD_CCtx *cctx)
+{
+	pthread_mutex_lock(&zstd_pool_mutex);
+	if (cctx_pool_nr < ZSTD_POOL_MAX) {
+		cctx_pool[cctx_pool_nr++] = cctx;
+		cctx = NULL;
+	}
+	pthread_mutex_unlock(&zstd_pool_mutex);
+	ZSTD_freeCCtx(cctx);
+}
+#endif
+
+void git_zstream_start(void)
+{
+#ifdef USE_ZSTD
+	pthread_mutex_init(&zstd_pool_mutex, NULL);
+#endif
+}
+
+/*
+ * A zstd frame starts with the magic number 0xFD2FB528, stored
+ * little-endian.  Its first two bytes can never start a zlib stream:
+ * 0x28 is a valid CMF byte, but no FLG byte that satisfies the zlib
+ * header check ((CMF * 256 + FLG) % 31 == 0) is 0xB5.  Some callers
+ * (index-pack, unpack-objects) may hand us a single byte on the first
+ * call; nothing git writes starts a zlib stream with 0x28 (that would
+ * mean a 1kB window), so take it as zstd rather than keep state.
+ */
+static int is_zstd_stream(const unsigned char *buf, unsigned long len)
+{
+	return len && buf[0] == 0x28 && (len < 2 || buf[1] == 0xB5);
+}
+
+#ifdef USE_ZSTD
+static void zstd_advance(git_zstream *s, size_t consumed, size_t produced)
+{
+	s->next_in += consumed;
+	s->avail_in -= consumed;
+	s->total_in += consumed;
+	s->next_out += produced;
+	s->avail_out -= produced;
+	s->total_out += produced;
+}
+
+static int zstd_inflate_init(git_zstream *strm)
+{
+	strm->zstd = get_dctx();
+	strm->zstd_done = 0;
+	return Z_OK;
+}
+
+static int zstd_inflate(git_zstream *strm)
+{
+	int progress = 0;
+	size_t ret;
+
+	if (strm->zstd_done)
+		return Z_STREAM_END;
+	for (;;) {
+		ZSTD_inBuffer in = { strm->next_in, zlib_buf_cap(strm->avail_in), 0 };
+		ZSTD_outBuffer out = { strm->next_out, zlib_buf_cap(strm->avail_out), 0 };
+
+		ret = ZSTD_decompressStream(strm->zstd, &out, &in);
+		if (ZSTD_isError(ret)) {
+			error("inflate: %s (zstd)", ZSTD_getErrorName(ret));
+			return Z_DATA_ERROR;
+		}
+		zstd_advance(strm, in.pos, out.pos);
+		if (!ret) {
+			/* the frame is complete; do not read past it */
+			strm->zstd_done = 1;
+			return Z_STREAM_END;
+		}
+		if (!in.pos && !out.pos)
+			break;
+		progress = 1;
+		if (!strm->avail_in || !strm->avail_out)
+			break;
+	}
+	return progress ? Z_OK : Z_BUF_ERROR;
+}
+
+static void zstd_inflate_end(git_zstream *strm)
+{
+	put_dctx(strm->zstd);
+	strm->zstd = NULL;
+}
+
+/*
+ * zlib levels go from 0 (store) to 9; zstd has no "store" and its
+ * useful range goes further, but 1-9 mean roughly the same trade-off.
+ */
+static void zstd_deflate_init(git_zstream *strm, int level)
+{
+	ZSTD_CCtx *cctx = get_cctx();
+
+	if (level == Z_DEFAULT_COMPRESSION)
+		level = ZSTD_CLEVEL_DEFAULT;
+	else if (level < 1)
+		level = 1;
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+	strm->zstd = cctx;
+}
+
+static int zstd_deflate(git_zstream *strm, int flush)
+{
+	int progress = 0;
+	size_t ret;
+
+	for (;;) {
+		ZSTD_inBuffer in = { strm->next_in, zlib_buf_cap(strm->avail_in), 0 };
+		ZSTD_outBuffer out = { strm->next_out, zlib_buf_cap(strm->avail_out), 0 };
+		ZSTD_EndDirective mode;
+
+		/* Never say "end" unless we are feeding everything */
+		if (in.size != strm->avail_in || flush == Z_NO_FLUSH)
+			mode = ZSTD_e_continue;
+		else if (flush == Z_FINISH)
+			mode = ZSTD_e_end;
+		else
+			mode = ZSTD_e_flush;
+
+		ret = ZSTD_compressStream2(strm->zstd, &out, &in, mode);
+		if (ZSTD_isError(ret)) {
+			error("deflate: %s (zstd)", ZSTD_getErrorName(ret));
+			return Z_STREAM_ERROR;
+		}
+		zstd_advance(strm, in.pos, out.pos);
+		if (mode == ZSTD_e_end && !ret)
+			return Z_STREAM_END;
+		if (!in.pos && !out.pos)
+			break;
+		progress = 1;
+		if (!strm->avail_out)
+			break;
+		if (mode == ZSTD_e_continue ? !strm->avail_in : !ret)
+			break;
+	}
+	return progress ? Z_OK : Z_BUF_ERROR;
+}
+
+static void zstd_deflate_end(git_zstream *strm)
+{
+	put_cctx(strm->zstd);
+	strm->zstd = NULL;
+}
+#else
+static int zstd_inflate_init(git_zstream *strm)
+{
+	return error("inflate: zstd-compressed data, but git was built without zstd support");
+}
+
+static int zstd_inflate(git_zstream *strm)
+{
+	BUG("zstd stream without zstd support");
+}
+
+static void zstd_inflate_end(git_zstream *strm)
+{
+}
+
+static void zstd_deflate_init(git_zstream *strm, int level)
+{
+	die("zstd compression requested, but git was built without zstd support");
+}
+
+static int zstd_deflate(git_zstream *strm, int flush)
+{
+	BUG("zstd stream without zstd support");
+}
+
+static void zstd_deflate_end(git_zstream *strm)
+{
+}
+#endif
+
 void git_inflate_init(git_zstream *strm)
 {
 	int status;
 
+	strm->codec = GIT_ZCODEC_UNKNOWN;
+	strm->zstd = NULL;
 	zlib_pre_call(strm);
 	status = inflateInit(&strm->z);
 	zlib_post_call(strm);
@@ -86,6 +348,8 @@ void git_inflate_init_gzip_only(git_zstream *strm)
 	const int windowBits = 15 + 16;
 	int status;
 
+	strm->codec = GIT_ZCODEC_ZLIB;
+	strm->zstd = NULL;
 	zlib_pre_call(strm);
 	status = inflateInit2(&strm->z, windowBits);
 	zlib_post_call(strm);
@@ -99,6 +363,8 @@ void git_inflate_end(git_zstream *strm)
 {
 	int status;
 
+	if (strm->codec == GIT_ZCODEC_ZSTD)
+		zstd_inflate_end(strm);
 	zlib_pre_call(strm);
 	status = inflateEnd(&strm->z);
 	zlib_post_call(strm);
@@ -112,6 +378,19 @@ int git_inflate(git_zstream *strm, int flush)
 {
 	int status;
 
+	if (strm->codec == GIT_ZCODEC_UNKNOWN) {
+		if (!strm->avail_in)
+			return Z_BUF_ERROR;
+		if (!is_zstd_stream(strm->next_in, strm->avail_in))
+			strm->codec = GIT_ZCODEC_ZLIB;
+		else if (zstd_inflate_init(strm))
+			return Z_DATA_ERROR;
+		else
+			strm->codec = GIT_ZCODEC_ZSTD;
+	}
+	if (strm->codec == GIT_ZCODEC_ZSTD)
+		return zstd_inflate(strm);
+
 	for (;;) {
 		zlib_pre_call(strm);
 		/* Never say Z_FINISH unless we are feeding everything */
@@ -152,6 +431,11 @@ int git_inflate(git_zstream *strm, int flush)
 
 unsigned long git_deflate_bound(git_zstream *strm, unsigned long size)
 {
+#ifdef USE_ZSTD
+	/* leave room for the frame header and checksum, too */
+	if (strm->codec == GIT_ZCODEC_ZSTD)
+		return ZSTD_compressBound(size) + 32;
+#endif
 	return deflateBound(&strm->z, size);
 }
 
@@ -203,10 +487,33 @@ void git_deflate_init_raw(git_zstream *strm, int level)
 	do_git_deflate_init(strm, level, -15);
 }
 
+void git_deflate_init_codec(git_zstream *strm, int level, enum git_zcodec codec)
+{
+	if (codec != GIT_ZCODEC_ZSTD) {
+		git_deflate_init(strm, level);
+		return;
+	}
+	memset(strm, 0, sizeof(*strm));
+	strm->codec = GIT_ZCODEC_ZSTD;
+	zstd_deflate_init(strm, level);
+}
+
+void git_deflate_set_size(git_zstream *strm, unsigned long size)
+{
+#ifdef USE_ZSTD
+	if (strm->codec == GIT_ZCODEC_ZSTD)
+		ZSTD_CCtx_setPledgedSrcSize(strm->zstd, size);
+#endif
+}
+
 int git_deflate_abort(git_zstream *strm)
 {
 	int status;
 
+	if (strm->codec == GIT_ZCODEC_ZSTD) {
+		zstd_deflate_end(strm);
+		return Z_OK;
+	}
 	zlib_pre_call(strm);
 	status = deflateEnd(&strm->z);
 	zlib_post_call(strm);
@@ -225,18 +532,16 @@ void git_deflate_end(git_zstream *strm)
 
 int git_deflate_end_gently(git_zstream *strm)
 {
-	int status;
-
-	zlib_pre_call(strm);
-	status = deflateEnd(&strm->z);
-	zlib_post_call(strm);
-	return status;
+	return git_deflate_abort(strm);
 }
 
 int git_deflate(git_zstream *strm, int flush)
 {
 	int status;
 
+	if (strm->codec == GIT_ZCODEC_ZSTD)
+		return zstd_deflate(strm, flush);
+
 	for (;;) {
 		zlib_pre_call(strm);
 